@@ -0,0 +1,223 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace Minesweeper {
+
+	struct AllocCounts {
+		size_t allocations = 0;
+		size_t frees = 0;
+		size_t bytes = 0;
+	};
+
+	enum class AllocPhase : uint8_t { Input, Update, Draw, Count };
+
+	// Counts the heap allocations of the frame thread per frame and per phase of the frame. Needs
+	// the global operator new/delete replacements, which are compiled into the translation unit
+	// that defines MINESWEEPER_ALLOC_TRACKER_IMPL before including this header. Only threads that
+	// called trackThisThread count, so the board pool worker generating the next board in the
+	// background or the task pool doesn't show up in the frame it happens to overlap.
+	class AllocTracker {
+	public:
+		static void trackThisThread() {
+			tracked = true;
+		}
+
+		static void recordAlloc(size_t size) {
+			if (!tracked)
+				return;
+			allocations.fetch_add(1, std::memory_order_relaxed);
+			bytes.fetch_add(size, std::memory_order_relaxed);
+		}
+
+		static void recordFree() {
+			if (tracked)
+				frees.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		// Everything allocated so far
+		static AllocCounts getTotals() {
+			AllocCounts counts;
+			counts.allocations = allocations.load(std::memory_order_relaxed);
+			counts.frees = frees.load(std::memory_order_relaxed);
+			counts.bytes = bytes.load(std::memory_order_relaxed);
+			return counts;
+		}
+
+		// Finishes the running frame and starts the next one
+		void beginFrame() {
+			lastFrame = frame;
+			for (size_t i = 0; i < phaseCount; i++)
+				lastPhases[i] = phases[i];
+			frame = {};
+			for (AllocCounts& phase : phases)
+				phase = {};
+			mark = getTotals();
+		}
+
+		// Everything allocated since the previous phase ended is counted for phase
+		void endPhase(AllocPhase phase) {
+			AllocCounts now = getTotals();
+			AllocCounts& counts = phases[(size_t)phase];
+			counts.allocations += now.allocations - mark.allocations;
+			counts.frees += now.frees - mark.frees;
+			counts.bytes += now.bytes - mark.bytes;
+			frame.allocations += now.allocations - mark.allocations;
+			frame.frees += now.frees - mark.frees;
+			frame.bytes += now.bytes - mark.bytes;
+			mark = now;
+		}
+
+		// Counts of the running frame up to the last endPhase
+		const AllocCounts& getFrame() const { return frame; }
+		const AllocCounts& getPhase(AllocPhase phase) const { return phases[(size_t)phase]; }
+
+		// Counts of the last finished frame
+		const AllocCounts& getLastFrame() const { return lastFrame; }
+		const AllocCounts& getLastPhase(AllocPhase phase) const { return lastPhases[(size_t)phase]; }
+
+	private:
+		static constexpr size_t phaseCount = (size_t)AllocPhase::Count;
+
+		inline static std::atomic<size_t> allocations{ 0 }, frees{ 0 }, bytes{ 0 };
+		inline static thread_local bool tracked = false;
+		AllocCounts mark;
+		AllocCounts frame, lastFrame;
+		AllocCounts phases[phaseCount], lastPhases[phaseCount];
+	};
+}
+
+#ifdef MINESWEEPER_ALLOC_TRACKER_IMPL
+#ifdef _MSC_VER
+#include <malloc.h>
+#define MINESWEEPER_NOINLINE __declspec(noinline)
+#else
+#define MINESWEEPER_NOINLINE __attribute__((noinline))
+#endif
+
+// The frees stay out of line, inlined into a container's delete the compiler pairs them with its
+// new and warns about the mismatch
+namespace Minesweeper::alloc_detail {
+	inline void* allocate(std::size_t size) noexcept {
+		AllocTracker::recordAlloc(size);
+		return std::malloc(size ? size : 1);
+	}
+
+	// aligned_alloc wants the size to be a multiple of the alignment, MSVC has its own pair
+	inline void* allocateAligned(std::size_t size, std::align_val_t alignment) noexcept {
+		AllocTracker::recordAlloc(size);
+		std::size_t align = (std::size_t)alignment;
+#ifdef _MSC_VER
+		return _aligned_malloc(size ? size : 1, align);
+#else
+		return std::aligned_alloc(align, size ? (size + align - 1) / align * align : align);
+#endif
+	}
+
+	MINESWEEPER_NOINLINE inline void release(void* memory) noexcept {
+		if (memory)
+			AllocTracker::recordFree();
+		std::free(memory);
+	}
+
+	MINESWEEPER_NOINLINE inline void releaseAligned(void* memory) noexcept {
+		if (memory)
+			AllocTracker::recordFree();
+#ifdef _MSC_VER
+		_aligned_free(memory);
+#else
+		std::free(memory);
+#endif
+	}
+}
+
+// Every replaceable form is hooked, the array forms too, so no allocation is missed whatever
+// the standard library forwards to what
+void* operator new(std::size_t size) {
+	if (void* memory = Minesweeper::alloc_detail::allocate(size))
+		return memory;
+	throw std::bad_alloc{};
+}
+
+void* operator new[](std::size_t size) {
+	return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+	return Minesweeper::alloc_detail::allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+	return Minesweeper::alloc_detail::allocate(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+	if (void* memory = Minesweeper::alloc_detail::allocateAligned(size, alignment))
+		return memory;
+	throw std::bad_alloc{};
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+	return operator new(size, alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+	return Minesweeper::alloc_detail::allocateAligned(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+	return Minesweeper::alloc_detail::allocateAligned(size, alignment);
+}
+
+void operator delete(void* memory) noexcept {
+	Minesweeper::alloc_detail::release(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+	Minesweeper::alloc_detail::release(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+	Minesweeper::alloc_detail::release(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+	Minesweeper::alloc_detail::release(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept {
+	Minesweeper::alloc_detail::release(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept {
+	Minesweeper::alloc_detail::release(memory);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept {
+	Minesweeper::alloc_detail::releaseAligned(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t) noexcept {
+	Minesweeper::alloc_detail::releaseAligned(memory);
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept {
+	Minesweeper::alloc_detail::releaseAligned(memory);
+}
+
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept {
+	Minesweeper::alloc_detail::releaseAligned(memory);
+}
+
+void operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept {
+	Minesweeper::alloc_detail::releaseAligned(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t, const std::nothrow_t&) noexcept {
+	Minesweeper::alloc_detail::releaseAligned(memory);
+}
+#endif
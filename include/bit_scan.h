@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+#include <intrin.h>
+#endif
+
+namespace Minesweeper {
+
+	// Index of the lowest set bit, word must not be 0. One instruction where the compiler has an
+	// intrinsic for it, a binary search over the halves otherwise.
+	inline int countTrailingZeros(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+		return __builtin_ctzll(word);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+		unsigned long index;
+		_BitScanForward64(&index, word);
+		return (int)index;
+#else
+		int n = 0;
+		for (int half = 32; half > 0; half >>= 1) {
+			if (!(word & ((uint64_t(1) << half) - 1))) {
+				word >>= half;
+				n += half;
+			}
+		}
+		return n;
+#endif
+	}
+}
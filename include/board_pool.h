@@ -0,0 +1,166 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace Minesweeper {
+
+	// Keeps a few ready to play boards for every (rows, cols, mines) setting a game plays, generated
+	// on one background thread that all games share. The boards of all settings together hold at
+	// most tileBudget tiles, a board bigger than what is left of it is not pooled. Boards the games
+	// are done with come back and are generated into again, their buffers are never freed.
+	template<typename BoardType>
+	class BoardPool {
+	public:
+		struct Setting {
+			size_t rows = 0, cols = 0, mines = 0;
+
+			size_t tiles() const { return rows * cols; }
+
+			bool operator==(const Setting& other) const {
+				return rows == other.rows && cols == other.cols && mines == other.mines;
+			}
+		};
+
+		BoardPool(size_t depth = 2, size_t tileBudget = size_t(1) << 26)
+			: maxDepth{ depth }, tileBudget{ tileBudget }, worker{ [this] { run(); } } {}
+
+		~BoardPool() {
+			{
+				std::lock_guard<std::mutex> lock{ mutex };
+				stopping = true;
+			}
+			wake.notify_one();
+			worker.join();
+		}
+
+		BoardPool(const BoardPool&) = delete;
+		BoardPool& operator=(const BoardPool&) = delete;
+
+		// The pool games take their boards from unless they are given another one
+		static BoardPool& shared() {
+			static BoardPool pool;
+			return pool;
+		}
+
+		// A game switches from one setting to another, an empty setting is none. The boards of a
+		// setting are dropped once no game plays it any more.
+		void configure(const Setting& from, const Setting& to) {
+			if (from == to)
+				return;
+			{
+				std::lock_guard<std::mutex> lock{ mutex };
+				if (from.tiles() > 0) {
+					auto entry = find(from);
+					if (entry != entries.end() && --entry->players == 0) {
+						readyTiles -= entry->ready.size() * from.tiles();
+						entries.erase(entry);
+					}
+				}
+				if (to.tiles() > 0) {
+					auto entry = find(to);
+					if (entry == entries.end())
+						entries.push_back({ to, 1, {} });
+					else
+						entry->players++;
+				}
+			}
+			wake.notify_one();
+		}
+
+		// A ready board if there is one, the caller generates it synchronously otherwise
+		std::optional<BoardType> take(const Setting& setting) {
+			std::optional<BoardType> board;
+			{
+				std::lock_guard<std::mutex> lock{ mutex };
+				auto entry = find(setting);
+				if (entry == entries.end() || entry->ready.empty())
+					return board;
+				board.emplace(std::move(entry->ready.front()));
+				entry->ready.pop_front();
+				readyTiles -= setting.tiles();
+			}
+			wake.notify_one();
+			return board;
+		}
+
+		// Hands back the board a game replaced, the next board is generated into its buffers
+		void recycle(BoardType&& board) {
+			size_t tiles = board.getRows() * board.getCols();
+			std::lock_guard<std::mutex> lock{ mutex };
+			if (spent.size() < maxDepth && readyTiles + spentTiles + tiles <= tileBudget) {
+				spent.push_back(std::move(board));
+				spentTiles += tiles;
+			}
+		}
+
+	private:
+		struct Entry {
+			Setting setting;
+			size_t players = 1;
+			std::deque<BoardType> ready;
+		};
+
+		typename std::list<Entry>::iterator find(const Setting& setting) {
+			return std::find_if(entries.begin(), entries.end(), [&setting](const Entry& entry) { return entry.setting == setting; });
+		}
+
+		// The setting with the fewest ready boards that is below its depth and fits the budget
+		Entry* nextToFill() {
+			Entry* next = nullptr;
+			for (Entry& entry : entries) {
+				if (entry.ready.size() >= maxDepth || readyTiles + entry.setting.tiles() > tileBudget)
+					continue;
+				if (!next || entry.ready.size() < next->ready.size())
+					next = &entry;
+			}
+			return next;
+		}
+
+		void run() {
+			std::unique_lock<std::mutex> lock{ mutex };
+			while (true) {
+				wake.wait(lock, [this] { return stopping || nextToFill(); });
+				if (stopping)
+					return;
+
+				Setting setting = nextToFill()->setting;
+				std::optional<BoardType> board;
+				if (!spent.empty()) {
+					board.emplace(std::move(spent.back()));
+					spent.pop_back();
+					spentTiles -= board->getRows() * board->getCols();
+				}
+				lock.unlock();
+				if (board)
+					board->regenerate(setting.rows, setting.cols, setting.mines);
+				else
+					board.emplace(setting.rows, setting.cols, setting.mines);
+				lock.lock();
+				//The last game of the setting moved on while the board was generated
+				auto entry = find(setting);
+				if (entry != entries.end() && entry->ready.size() < maxDepth && readyTiles + setting.tiles() <= tileBudget) {
+					entry->ready.push_back(std::move(*board));
+					readyTiles += setting.tiles();
+				}
+			}
+		}
+
+		size_t maxDepth;
+		size_t tileBudget;
+		size_t readyTiles = 0, spentTiles = 0;
+		bool stopping = false;
+		std::list<Entry> entries;
+		std::vector<BoardType> spent;
+		std::mutex mutex;
+		std::condition_variable wake;
+		std::thread worker;
+	};
+}
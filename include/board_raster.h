@@ -0,0 +1,322 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "raylib.h"
+#include "png_writer.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MINESWEEPER_RASTER_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace Minesweeper {
+
+	// What a tile of a snapshot shows, an open tile is Open plus its hint
+	enum class SnapshotTile : uint8_t {
+		Closed,
+		Flagged,
+		Bomb,
+		Open
+	};
+
+	// Draws boards into PNG files on the CPU, for thumbnails on machines without a window or GPU.
+	// Every kind of tile is composed once per tile size from the game's art into an atlas, a
+	// scanline is then the atlas rows of its tiles copied one after the other. Bands of tile rows
+	// are drawn and deflated on every core and written in order as they finish.
+	class BoardRasterizer {
+	public:
+		static constexpr size_t kindCount = (size_t)SnapshotTile::Open + 9;
+		//Art size at which the game draws a tile
+		static constexpr size_t artTileSize = 30;
+
+		BoardRasterizer() {
+			numberColors.fill({ 0, 0, 0, 255 });
+		}
+
+		// LoadImage needs no window. Tiles whose art is missing are drawn as flat gray.
+		bool loadArt(const std::string& directory) {
+			bool loaded = true;
+			loaded &= loadImage(directory + "/cellup.png", tileUp);
+			loaded &= loadImage(directory + "/celldown.png", tileDown);
+			loaded &= loadImage(directory + "/bomb_1_ps.png", bomb);
+			loaded &= loadImage(directory + "/red_flag_20.png", flag);
+			atlasTileSize = 0;
+			return loaded;
+		}
+
+		void setNumberColor(int hint, Color color) {
+			numberColors[hint] = color;
+			atlasTileSize = 0;
+		}
+
+		// Largest tile size, up to the game's own, that fits the board into maxSide pixels
+		static size_t fitTileSize(size_t rows, size_t cols, size_t maxSide) {
+			size_t longest = std::max<size_t>(1, std::max(rows, cols));
+			return std::clamp<size_t>(maxSide / longest, 1, artTileSize);
+		}
+
+		// kinds holds a SnapshotTile per tile, row by row
+		bool exportPng(const std::string& path, const uint8_t* kinds, size_t rows, size_t cols, size_t tileSize) {
+			if (rows == 0 || cols == 0 || tileSize == 0)
+				return false;
+			if (atlasTileSize != tileSize)
+				buildAtlas(tileSize);
+
+			size_t width = cols * tileSize;
+			size_t height = rows * tileSize;
+			PngWriter png;
+			if (!png.open(path, (uint32_t)width, (uint32_t)height)) {
+				std::cerr << "Snapshot: can't write " << path << std::endl;
+				return false;
+			}
+
+			//About a megabyte of scanlines per band, enough to keep the threads busy between hand offs
+			size_t scanlineBytes = 1 + width * 3;
+			size_t bandRows = std::max<size_t>(1, (size_t(1) << 20) / (scanlineBytes * tileSize));
+			size_t bandCount = (rows + bandRows - 1) / bandRows;
+			std::vector<Band> bands(bandCount);
+			std::atomic<size_t> nextBand{ 0 };
+			std::mutex mutex;
+			std::condition_variable bandReady;
+
+			auto work = [&] {
+				std::vector<uint8_t> scanlines;
+				DeflateBand deflate;
+				for (size_t band = nextBand++; band < bandCount; band = nextBand++) {
+					size_t first = band * bandRows;
+					size_t last = std::min(rows, first + bandRows);
+					size_t bytes = (last - first) * tileSize * scanlineBytes;
+					//Blits write up to 15 bytes past a tile row
+					scanlines.resize(bytes + 16);
+					drawBand(kinds, cols, first, last, scanlines.data());
+					Band& out = bands[band];
+					out.adler = PngWriter::adler32(scanlines.data(), bytes);
+					out.scanlineBytes = bytes;
+					deflate.compress(scanlines.data(), bytes, out.deflated);
+					{
+						std::lock_guard<std::mutex> lock(mutex);
+						out.ready = true;
+					}
+					bandReady.notify_one();
+				}
+			};
+
+			size_t threadCount = std::min<size_t>(bandCount, std::max(1u, std::thread::hardware_concurrency()));
+			std::vector<std::thread> threads;
+			threads.reserve(threadCount);
+			for (size_t i = 0; i < threadCount; i++)
+				threads.emplace_back(work);
+
+			for (Band& band : bands) {
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					bandReady.wait(lock, [&] { return band.ready; });
+				}
+				png.writeBand(band.deflated, band.adler, band.scanlineBytes);
+				std::vector<uint8_t>().swap(band.deflated);
+			}
+			for (std::thread& thread : threads)
+				thread.join();
+
+			if (!png.close()) {
+				std::cerr << "Snapshot: can't write " << path << std::endl;
+				return false;
+			}
+			return true;
+		}
+
+		// The same tiles copied pixel by pixel into RGB rows, without threads, SSE2 or scanline
+		// filter bytes. What the checks compare exportPng against.
+		void drawReference(const uint8_t* kinds, size_t rows, size_t cols, size_t tileSize, std::vector<uint8_t>& rgb) {
+			if (atlasTileSize != tileSize)
+				buildAtlas(tileSize);
+			size_t width = cols * tileSize;
+			rgb.assign(rows * tileSize * width * 3, 0);
+			for (size_t row = 0; row < rows; row++)
+				for (size_t col = 0; col < cols; col++) {
+					const uint8_t* tile = atlas.data() + kinds[row * cols + col] * tileSize * tileBytes;
+					for (size_t py = 0; py < tileSize; py++)
+						for (size_t px = 0; px < tileSize; px++)
+							for (size_t c = 0; c < 3; c++)
+								rgb[((row * tileSize + py) * width + col * tileSize + px) * 3 + c] = tile[(py * tileSize + px) * 3 + c];
+				}
+		}
+
+	private:
+		// Art as 8 bit RGBA
+		struct Art {
+			std::vector<uint8_t> pixels;
+			size_t width = 0, height = 0;
+		};
+
+		struct Band {
+			std::vector<uint8_t> deflated;
+			uint32_t adler = 1;
+			size_t scanlineBytes = 0;
+			bool ready = false;
+		};
+
+		static bool loadImage(const std::string& path, Art& art) {
+			art = Art{};
+			Image image = LoadImage(path.c_str());
+			if (image.data == nullptr) {
+				std::cerr << "Snapshot: failed to load " << path << std::endl;
+				return false;
+			}
+			ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+			art.width = (size_t)image.width;
+			art.height = (size_t)image.height;
+			const uint8_t* data = static_cast<const uint8_t*>(image.data);
+			art.pixels.assign(data, data + art.width * art.height * 4);
+			UnloadImage(image);
+			return true;
+		}
+
+		// Rows of 5 bit wide digits 1 to 8, 7 rows each, top bit on the left
+		static constexpr uint8_t digitFont[8][7] = {
+			{ 0x04, 0x0c, 0x04, 0x04, 0x04, 0x04, 0x0e },
+			{ 0x0e, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1f },
+			{ 0x1f, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0e },
+			{ 0x02, 0x06, 0x0a, 0x12, 0x1f, 0x02, 0x02 },
+			{ 0x1f, 0x10, 0x1e, 0x01, 0x01, 0x11, 0x0e },
+			{ 0x06, 0x08, 0x10, 0x1e, 0x11, 0x11, 0x0e },
+			{ 0x1f, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 },
+			{ 0x0e, 0x11, 0x11, 0x0e, 0x11, 0x11, 0x0e },
+		};
+
+		void buildAtlas(size_t tileSize) {
+			atlasTileSize = tileSize;
+			tileBytes = tileSize * 3;
+			//Blits read up to 15 bytes past the last tile row
+			atlas.assign(kindCount * tileSize * tileBytes + 16, 0);
+			const Color tint{ 230, 230, 230, 255 };
+			const Color white{ 255, 255, 255, 255 };
+			size_t flagSize = std::max<size_t>(1, (tileSize * 20 + artTileSize / 2) / artTileSize);
+
+			for (size_t kind = 0; kind < kindCount; kind++) {
+				uint8_t* tile = atlas.data() + kind * tileSize * tileBytes;
+				for (size_t i = 0; i < tileSize * tileSize; i++) {
+					tile[i * 3 + 0] = 130;
+					tile[i * 3 + 1] = 130;
+					tile[i * 3 + 2] = 130;
+				}
+				switch ((SnapshotTile)std::min<size_t>(kind, (size_t)SnapshotTile::Open)) {
+				case SnapshotTile::Closed:
+					blend(tile, tileSize, tileUp, 0, 0, tileSize, tint);
+					break;
+				case SnapshotTile::Flagged:
+					blend(tile, tileSize, tileUp, 0, 0, tileSize, tint);
+					blend(tile, tileSize, flag, (tileSize - flagSize) / 2, (tileSize - flagSize) / 2, flagSize, white);
+					break;
+				case SnapshotTile::Bomb:
+					blend(tile, tileSize, bomb, 0, 0, tileSize, white);
+					break;
+				case SnapshotTile::Open:
+					blend(tile, tileSize, tileDown, 0, 0, tileSize, tint);
+					drawDigit(tile, tileSize, (int)(kind - (size_t)SnapshotTile::Open));
+					break;
+				}
+			}
+		}
+
+		// Scales art to size pixels with its nearest texels and lays it over the tile at x, y
+		void blend(uint8_t* tile, size_t tileSize, const Art& art, size_t x, size_t y, size_t size, Color tint) const {
+			if (art.pixels.empty())
+				return;
+			for (size_t py = 0; py < size && y + py < tileSize; py++) {
+				size_t sy = std::min(art.height - 1, (py * art.height + art.height / 2) / size);
+				for (size_t px = 0; px < size && x + px < tileSize; px++) {
+					size_t sx = std::min(art.width - 1, (px * art.width + art.width / 2) / size);
+					const uint8_t* source = &art.pixels[(sy * art.width + sx) * 4];
+					uint8_t* target = tile + ((y + py) * tileSize + x + px) * 3;
+					uint32_t alpha = source[3] * tint.a / 255;
+					const uint8_t channels[3] = { tint.r, tint.g, tint.b };
+					for (int c = 0; c < 3; c++) {
+						uint32_t color = source[c] * channels[c] / 255;
+						target[c] = (uint8_t)((color * alpha + target[c] * (255 - alpha) + 127) / 255);
+					}
+				}
+			}
+		}
+
+		// Placed like the game's hint text, a third in and a quarter down. Tiles too small for a
+		// readable digit get a dot in its color.
+		void drawDigit(uint8_t* tile, size_t tileSize, int hint) const {
+			if (hint <= 0)
+				return;
+			Color color = numberColors[hint];
+			auto put = [&](size_t x, size_t y) {
+				if (x >= tileSize || y >= tileSize)
+					return;
+				uint8_t* target = tile + (y * tileSize + x) * 3;
+				target[0] = color.r;
+				target[1] = color.g;
+				target[2] = color.b;
+			};
+			if (tileSize < 9) {
+				size_t dot = std::max<size_t>(1, tileSize / 2);
+				size_t offset = (tileSize - dot) / 2;
+				for (size_t y = 0; y < dot; y++)
+					for (size_t x = 0; x < dot; x++)
+						put(offset + x, offset + y);
+				return;
+			}
+			size_t scale = std::max<size_t>(1, tileSize * 2 / artTileSize);
+			size_t left = tileSize / 3, top = tileSize / 4;
+			for (size_t row = 0; row < 7; row++)
+				for (size_t bit = 0; bit < 5; bit++) {
+					if (!(digitFont[hint - 1][row] & (0x10 >> bit)))
+						continue;
+					for (size_t y = 0; y < scale; y++)
+						for (size_t x = 0; x < scale; x++)
+							put(left + bit * scale + x, top + row * scale + y);
+				}
+		}
+
+		// Scanlines of tile rows first to last, each with filter type 0 in front
+		void drawBand(const uint8_t* kinds, size_t cols, size_t first, size_t last, uint8_t* out) const {
+			size_t tileSize = atlasTileSize;
+			size_t scanlineBytes = 1 + cols * tileBytes;
+			for (size_t row = first; row < last; row++) {
+				const uint8_t* rowKinds = kinds + row * cols;
+				for (size_t py = 0; py < tileSize; py++) {
+					uint8_t* line = out + ((row - first) * tileSize + py) * scanlineBytes;
+					const uint8_t* source = atlas.data() + py * tileBytes;
+					//The blit of the last tile runs into the next scanline, whose filter byte comes after it
+					uint8_t* target = line + 1;
+					for (size_t col = 0; col < cols; col++, target += tileBytes)
+						blit(target, source + rowKinds[col] * atlasTileSize * tileBytes, tileBytes);
+					line[0] = 0;
+				}
+			}
+		}
+
+		// Copies bytes rounded up to 16, the excess is overwritten by the next tile
+		static void blit(uint8_t* target, const uint8_t* source, size_t bytes) {
+#ifdef MINESWEEPER_RASTER_SSE2
+			for (size_t i = 0; i < bytes; i += 16)
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(target + i), _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i)));
+#else
+			std::memcpy(target, source, bytes);
+#endif
+		}
+
+		Art tileUp, tileDown, bomb, flag;
+		std::array<Color, 9> numberColors;
+		std::vector<uint8_t> atlas;
+		size_t atlasTileSize = 0;
+		size_t tileBytes = 0;
+	};
+}
@@ -0,0 +1,446 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "replay.h"
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace Minesweeper {
+
+	// Co-op messages: a type byte, the payload length as a varint and the payload. The host owns
+	// the game, clients only send what they want to do and get back what changed.
+	enum class CoopMessage : uint8_t {
+		Join = 1,		//Host: rows, cols, mines of the game that starts now
+		Layout,			//Host: mine positions as gaps, only sent once the game is over
+		Changes,		//Host: moves of the receiver applied so far, state, clicks, then spans of the tiles now open with their hints, closed and flagged
+		Move,			//Client: row, col, move type
+		Reset,			//Client: play the board again
+		Continue,		//Client: continue after a loss
+	};
+
+	// Hints of opened tiles go as nibbles, two to a byte, an opened mine has this one
+	constexpr uint8_t coopMineHint = 15;
+
+	// A TCP port on the loopback interface, or a Unix socket for "unix:<path>"
+	struct CoopAddress {
+		std::string unixPath;
+		uint16_t port = 0;
+
+		static CoopAddress parse(const std::string& text) {
+			CoopAddress address;
+			if (text.rfind("unix:", 0) == 0)
+				address.unixPath = text.substr(5);
+			else
+				address.port = (uint16_t)std::strtoul(text.c_str(), nullptr, 10);
+			return address;
+		}
+
+		bool isValid() const { return !unixPath.empty() || port != 0; }
+	};
+
+	// Codes a set of tile indices as runs: the run count, then per run the gap to the end of the
+	// previous run and the run length, all varints. The indices are marked in a bitmap that is
+	// scanned from the lowest to the highest one, so a cascade of a million tiles becomes a few
+	// runs per board row without sorting anything.
+	class SpanCoder {
+	public:
+		void encode(std::vector<uint8_t>& out, const std::vector<size_t>& indices, size_t tileCount) {
+			if (marks.size() < (tileCount + 63) / 64)
+				marks.resize((tileCount + 63) / 64, 0);
+			size_t first = SIZE_MAX, last = 0;
+			for (size_t index : indices) {
+				if (index >= tileCount)
+					continue;
+				marks[index >> 6] |= uint64_t(1) << (index & 63);
+				first = std::min(first, index);
+				last = std::max(last, index);
+			}
+			runs.clear();
+			if (first != SIZE_MAX) {
+				size_t start = 0, length = 0;
+				for (size_t word = first >> 6; word <= last >> 6; word++) {
+					uint64_t bits = marks[word];
+					marks[word] = 0;
+					if (bits == ~uint64_t(0) && length > 0 && start + length == word * 64) {
+						length += 64;
+						continue;
+					}
+					for (size_t bit = 0; bits; bit++, bits >>= 1) {
+						if (!(bits & 1))
+							continue;
+						size_t index = word * 64 + bit;
+						if (length > 0 && start + length == index) {
+							length++;
+							continue;
+						}
+						if (length > 0)
+							runs.push_back({ start, length });
+						start = index;
+						length = 1;
+					}
+				}
+				runs.push_back({ start, length });
+			}
+
+			replay_detail::putVarint(out, runs.size());
+			size_t end = 0;
+			for (const std::pair<size_t, size_t>& run : runs) {
+				replay_detail::putVarint(out, run.first - end);
+				replay_detail::putVarint(out, run.second);
+				end = run.first + run.second;
+			}
+		}
+
+		// Runs of the last encode, lowest first
+		const std::vector<std::pair<size_t, size_t>>& getRuns() const { return runs; }
+
+		// Calls emit(start, length) per run, false if the data ends early or leaves the board
+		template<typename Emit>
+		static bool decode(const uint8_t*& in, const uint8_t* end, size_t tileCount, Emit emit) {
+			uint64_t count;
+			if (!replay_detail::getVarint(in, end, count))
+				return false;
+			uint64_t runEnd = 0;
+			for (uint64_t i = 0; i < count; i++) {
+				uint64_t gap, length;
+				if (!replay_detail::getVarint(in, end, gap) || !replay_detail::getVarint(in, end, length))
+					return false;
+				uint64_t start = runEnd + gap;
+				if (start + length > tileCount || start + length < start)
+					return false;
+				emit((size_t)start, (size_t)length);
+				runEnd = start + length;
+			}
+			return true;
+		}
+
+	private:
+		std::vector<uint64_t> marks;
+		std::vector<std::pair<size_t, size_t>> runs;
+	};
+
+	// One end of a co-op link. The socket never blocks: send queues the message and flush writes
+	// as much as the socket takes, receive hands over every message that arrived complete. The
+	// buffers are kept, a game in progress doesn't allocate for its messages.
+	class CoopConnection {
+	public:
+		CoopConnection() = default;
+		explicit CoopConnection(int socket) : fd{ socket } {}
+		~CoopConnection() { close(); }
+
+		CoopConnection(CoopConnection&& other) noexcept { *this = std::move(other); }
+		CoopConnection& operator=(CoopConnection&& other) noexcept {
+			if (this != &other) {
+				close();
+				fd = std::exchange(other.fd, -1);
+				out = std::move(other.out);
+				in = std::move(other.in);
+				outStart = std::exchange(other.outStart, 0);
+				inEnd = std::exchange(other.inEnd, 0);
+				bytesSent = other.bytesSent;
+				bytesReceived = other.bytesReceived;
+			}
+			return *this;
+		}
+
+		// Connects to a host on this machine, the connection is closed if there is none
+		static CoopConnection connect(const CoopAddress& address) {
+#ifndef _WIN32
+			int socket = openSocket(address);
+			if (socket < 0)
+				return {};
+			int result;
+			if (!address.unixPath.empty()) {
+				sockaddr_un name = unixName(address.unixPath);
+				result = ::connect(socket, reinterpret_cast<sockaddr*>(&name), sizeof(name));
+			}
+			else {
+				sockaddr_in name = loopbackName(address.port);
+				result = ::connect(socket, reinterpret_cast<sockaddr*>(&name), sizeof(name));
+			}
+			if (result != 0) {
+				std::cerr << "Co-op: can't connect, " << std::strerror(errno) << std::endl;
+				::close(socket);
+				return {};
+			}
+			CoopConnection connection{ socket };
+			connection.configure(!address.unixPath.empty());
+			return connection;
+#else
+			(void)address;
+			std::cerr << "Co-op needs POSIX sockets" << std::endl;
+			return {};
+#endif
+		}
+
+		// Both ends of a connection inside this process, for checks and benchmarks. Both are closed
+		// if there are no sockets to be had.
+		static std::pair<CoopConnection, CoopConnection> pair() {
+			std::pair<CoopConnection, CoopConnection> ends;
+#ifndef _WIN32
+			int sockets[2];
+			if (::socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0) {
+				std::cerr << "Co-op: can't create a socket pair, " << std::strerror(errno) << std::endl;
+				return ends;
+			}
+			ends.first = CoopConnection{ sockets[0] };
+			ends.second = CoopConnection{ sockets[1] };
+			ends.first.configure(true);
+			ends.second.configure(true);
+#else
+			std::cerr << "Co-op needs POSIX sockets" << std::endl;
+#endif
+			return ends;
+		}
+
+		bool isOpen() const { return fd >= 0; }
+
+		void close() {
+#ifndef _WIN32
+			if (fd >= 0)
+				::close(fd);
+#endif
+			fd = -1;
+			out.clear();
+			outStart = 0;
+			inEnd = 0;
+		}
+
+		// Queues a message, returns its size with type and length
+		size_t send(CoopMessage type, const std::vector<uint8_t>& payload) {
+			return send(type, nullptr, 0, payload.data(), payload.size());
+		}
+
+		// A message made of a per receiver head and a body shared by all receivers
+		size_t send(CoopMessage type, const uint8_t* head, size_t headSize, const uint8_t* body, size_t bodySize) {
+			if (!isOpen())
+				return 0;
+			size_t before = out.size();
+			out.push_back((uint8_t)type);
+			replay_detail::putVarint(out, headSize + bodySize);
+			out.insert(out.end(), head, head + headSize);
+			out.insert(out.end(), body, body + bodySize);
+			return out.size() - before;
+		}
+
+		// Writes what the socket takes, the rest waits for the next flush. False once the peer is gone.
+		bool flush() {
+#ifndef _WIN32
+			while (isOpen() && outStart < out.size()) {
+				ssize_t written = ::send(fd, out.data() + outStart, out.size() - outStart, sendFlags);
+				if (written < 0) {
+					if (errno == EINTR)
+						continue;
+					if (errno == EAGAIN || errno == EWOULDBLOCK)
+						break;
+					close();
+					return false;
+				}
+				outStart += (size_t)written;
+				bytesSent += (uint64_t)written;
+			}
+			if (outStart == out.size()) {
+				out.clear();
+				outStart = 0;
+			}
+#endif
+			return isOpen();
+		}
+
+		// Calls onMessage(type, begin, end) for every complete message. False once the peer is gone.
+		template<typename OnMessage>
+		bool receive(OnMessage onMessage) {
+#ifndef _WIN32
+			while (isOpen()) {
+				if (in.size() - inEnd < readChunk)
+					in.resize(inEnd + readChunk);
+				ssize_t got = ::recv(fd, in.data() + inEnd, in.size() - inEnd, 0);
+				if (got < 0) {
+					if (errno == EINTR)
+						continue;
+					if (errno != EAGAIN && errno != EWOULDBLOCK)
+						close();
+					break;
+				}
+				if (got == 0) {
+					close();
+					break;
+				}
+				inEnd += (size_t)got;
+				bytesReceived += (uint64_t)got;
+			}
+
+			const uint8_t* next = in.data();
+			const uint8_t* end = in.data() + inEnd;
+			while (next < end) {
+				const uint8_t* cursor = next + 1;
+				uint64_t length;
+				if (!replay_detail::getVarint(cursor, end, length) || length > (uint64_t)(end - cursor))
+					break;
+				onMessage((CoopMessage)*next, cursor, cursor + length);
+				next = cursor + length;
+			}
+			//Keep the start of a message that is still arriving
+			size_t used = (size_t)(next - in.data());
+			if (used > 0) {
+				std::memmove(in.data(), in.data() + used, inEnd - used);
+				inEnd -= used;
+			}
+#else
+			(void)onMessage;
+#endif
+			return isOpen();
+		}
+
+		uint64_t getBytesSent() const { return bytesSent; }
+		uint64_t getBytesReceived() const { return bytesReceived; }
+
+	private:
+		friend class CoopListener;
+
+#ifndef _WIN32
+#ifdef MSG_NOSIGNAL
+		static constexpr int sendFlags = MSG_NOSIGNAL;
+#else
+		static constexpr int sendFlags = 0;
+#endif
+
+		static int openSocket(const CoopAddress& address) {
+			int socket = ::socket(address.unixPath.empty() ? AF_INET : AF_UNIX, SOCK_STREAM, 0);
+			if (socket < 0)
+				std::cerr << "Co-op: can't create a socket, " << std::strerror(errno) << std::endl;
+			return socket;
+		}
+
+		static sockaddr_un unixName(const std::string& path) {
+			sockaddr_un name{};
+			name.sun_family = AF_UNIX;
+			std::strncpy(name.sun_path, path.c_str(), sizeof(name.sun_path) - 1);
+			return name;
+		}
+
+		static sockaddr_in loopbackName(uint16_t port) {
+			sockaddr_in name{};
+			name.sin_family = AF_INET;
+			name.sin_port = htons(port);
+			name.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			return name;
+		}
+
+		// Non-blocking, and small messages go out right away instead of waiting for more
+		void configure(bool isUnix) {
+			fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+			if (!isUnix) {
+				int on = 1;
+				setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+			}
+#ifdef SO_NOSIGPIPE
+			int on = 1;
+			setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+		}
+#endif
+
+		static constexpr size_t readChunk = 64 * 1024;
+
+		int fd = -1;
+		std::vector<uint8_t> out, in;
+		size_t outStart = 0, inEnd = 0;
+		uint64_t bytesSent = 0, bytesReceived = 0;
+	};
+
+	// Accepts the clients of a co-op host without blocking
+	class CoopListener {
+	public:
+		CoopListener() = default;
+		~CoopListener() { close(); }
+		CoopListener(const CoopListener&) = delete;
+		CoopListener& operator=(const CoopListener&) = delete;
+
+		bool listen(const CoopAddress& address) {
+			close();
+#ifndef _WIN32
+			fd = CoopConnection::openSocket(address);
+			if (fd < 0)
+				return false;
+			int result;
+			if (!address.unixPath.empty()) {
+				//A socket file left behind by a host that didn't exit cleanly
+				::unlink(address.unixPath.c_str());
+				sockaddr_un name = CoopConnection::unixName(address.unixPath);
+				result = ::bind(fd, reinterpret_cast<sockaddr*>(&name), sizeof(name));
+			}
+			else {
+				int on = 1;
+				setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+				sockaddr_in name = CoopConnection::loopbackName(address.port);
+				result = ::bind(fd, reinterpret_cast<sockaddr*>(&name), sizeof(name));
+			}
+			if (result != 0 || ::listen(fd, 8) != 0) {
+				std::cerr << "Co-op: can't listen, " << std::strerror(errno) << std::endl;
+				close();
+				return false;
+			}
+			fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+			isUnix = !address.unixPath.empty();
+			unixPath = address.unixPath;
+			return true;
+#else
+			(void)address;
+			std::cerr << "Co-op needs POSIX sockets" << std::endl;
+			return false;
+#endif
+		}
+
+		bool isListening() const { return fd >= 0; }
+
+		// A client that connected since the last call, closed if there is none
+		CoopConnection accept() {
+#ifndef _WIN32
+			if (fd < 0)
+				return {};
+			int socket = ::accept(fd, nullptr, nullptr);
+			if (socket < 0)
+				return {};
+			CoopConnection connection{ socket };
+			connection.configure(isUnix);
+			return connection;
+#else
+			return {};
+#endif
+		}
+
+		void close() {
+#ifndef _WIN32
+			if (fd >= 0) {
+				::close(fd);
+				if (isUnix)
+					::unlink(unixPath.c_str());
+			}
+#endif
+			fd = -1;
+		}
+
+	private:
+		int fd = -1;
+		bool isUnix = false;
+		std::string unixPath;
+	};
+}
@@ -0,0 +1,295 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "raylib.h"
+
+namespace Minesweeper {
+
+	enum class DrawKind : uint8_t { Texture, TextureRec, TexturePro, Text, TextEx, Rect, RectRounded, RectLines };
+
+	struct DrawCommand {
+		DrawKind kind;
+		uint8_t layer;
+		Texture2D texture;
+		Rectangle rect;
+		Rectangle source;
+		Color color;
+		const char* text;
+		float fontSize;
+		float spacing;
+	};
+
+	// Draw calls recorded for one frame. On flush they are ordered by layer and then by texture so
+	// that draws sharing a texture end up next to each other, draws inside a layer must not overlap.
+	// Text is not copied, it has to stay alive until the frame is flushed.
+	class DrawList {
+	public:
+		// Batch key of everything drawn with the font and with the shapes texture
+		static constexpr uint32_t textKey = UINT32_MAX;
+		static constexpr uint32_t shapeKey = 0;
+
+		void clear() {
+			commands.clear();
+		}
+
+		void reserve(size_t count) {
+			commands.reserve(count);
+			order.reserve(count);
+		}
+
+		void texture(uint8_t layer, Texture2D tex, int x, int y, Color tint) {
+			push({ DrawKind::Texture, layer, tex, { (float)x, (float)y, (float)tex.width, (float)tex.height }, {}, tint, nullptr, 0, 0 });
+		}
+
+		void textureRec(uint8_t layer, Texture2D tex, Rectangle source, Vector2 position, Color tint) {
+			push({ DrawKind::TextureRec, layer, tex, { position.x, position.y, source.width, source.height }, source, tint, nullptr, 0, 0 });
+		}
+
+		// source of the texture stretched over dest
+		void texturePro(uint8_t layer, Texture2D tex, Rectangle source, Rectangle dest, Color tint) {
+			push({ DrawKind::TexturePro, layer, tex, dest, source, tint, nullptr, 0, 0 });
+		}
+
+		void text(uint8_t layer, const char* text, int x, int y, int fontSize, Color color) {
+			push({ DrawKind::Text, layer, {}, { (float)x, (float)y, 0, 0 }, {}, color, text, (float)fontSize, 0 });
+		}
+
+		void textEx(uint8_t layer, const char* text, Vector2 position, float fontSize, float spacing, Color color) {
+			push({ DrawKind::TextEx, layer, {}, { position.x, position.y, 0, 0 }, {}, color, text, fontSize, spacing });
+		}
+
+		void rect(uint8_t layer, Rectangle rec, Color color) {
+			push({ DrawKind::Rect, layer, {}, rec, {}, color, nullptr, 0, 0 });
+		}
+
+		void rectRounded(uint8_t layer, Rectangle rec, float roundness, Color color) {
+			push({ DrawKind::RectRounded, layer, {}, rec, {}, color, nullptr, 0, roundness });
+		}
+
+		void rectLines(uint8_t layer, Rectangle rec, Color color) {
+			push({ DrawKind::RectLines, layer, {}, rec, {}, color, nullptr, 0, 0 });
+		}
+
+		static uint32_t batchKey(const DrawCommand& command) {
+			switch (command.kind) {
+			case DrawKind::Texture:
+			case DrawKind::TextureRec:
+			case DrawKind::TexturePro:
+				return command.texture.id;
+			case DrawKind::Text:
+			case DrawKind::TextEx:
+				return textKey;
+			default:
+				return shapeKey;
+			}
+		}
+
+		// Commands in submission order. Sorts keys that pack layer, texture and recording order,
+		// so equal keys keep the order they were recorded in and nothing is allocated once warm.
+		template<typename Call>
+		void forEachSorted(Call call) {
+			order.clear();
+			for (size_t i = 0; i < commands.size(); i++) {
+				const DrawCommand& command = commands[i];
+				order.push_back((uint64_t)command.layer << 56 | (uint64_t)batchKey(command) << 24 | i);
+			}
+			std::sort(order.begin(), order.end());
+			for (uint64_t key : order)
+				call(commands[key & indexMask]);
+		}
+
+		size_t size() const {
+			return commands.size();
+		}
+
+	private:
+		static constexpr uint64_t indexMask = (uint64_t(1) << 24) - 1;
+
+		//The sort key has 24 bits for the recording order, a frame with more commands loses the rest
+		void push(const DrawCommand& command) {
+			if (commands.size() <= indexMask) {
+				commands.push_back(command);
+				return;
+			}
+			if (!overflowed)
+				std::cerr << "DrawList: more than " << indexMask + 1 << " commands in a frame, the rest are not drawn" << std::endl;
+			overflowed = true;
+		}
+
+		std::vector<DrawCommand> commands;
+		std::vector<uint64_t> order;
+		bool overflowed = false;
+	};
+
+	// Art the renderer draws with
+	enum class TextureArt : uint8_t { Bomb, Flag, TileUp, TileDown, MenuButton, MenuButtonDown, Count };
+
+	inline const char* texturePath(TextureArt art) {
+		static const char* const paths[] = {
+			"resources/bomb_1_ps.png", "resources/red_flag_20.png", "resources/cellup.png",
+			"resources/celldown.png", "resources/menu_button.png", "resources/menu_button_down.png",
+		};
+		return paths[(size_t)art];
+	}
+
+	// Draws the lists and owns the textures they are drawn with
+	class RenderBackend {
+	public:
+		virtual ~RenderBackend() = default;
+		virtual void submit(DrawList& list) = 0;
+		// Loaded the first time it is asked for
+		virtual Texture2D texture(TextureArt art) = 0;
+		// Textures with pixels the renderer keeps itself, like the minimap
+		virtual Texture2D createTexture(const Image& image) = 0;
+		virtual void updateTexture(Texture2D texture, Rectangle rect, const void* pixels) = 0;
+		virtual void unloadTexture(Texture2D texture) = 0;
+	};
+
+	// Needs a window from the first texture on
+	class RaylibBackend : public RenderBackend {
+	public:
+		~RaylibBackend() override {
+			for (Texture2D loaded : art) {
+				if (loaded.id != 0)
+					UnloadTexture(loaded);
+			}
+		}
+
+		Texture2D texture(TextureArt which) override {
+			size_t index = (size_t)which;
+			if (art[index].id == 0 && !tried[index]) {
+				tried[index] = true;
+				Image image = LoadImage(texturePath(which));
+				ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+				art[index] = LoadTextureFromImage(image);
+				UnloadImage(image);
+				if (art[index].id == 0)
+					std::cerr << "Failed to load " << texturePath(which) << "!" << std::endl;
+			}
+			return art[index];
+		}
+
+		Texture2D createTexture(const Image& image) override {
+			return LoadTextureFromImage(image);
+		}
+
+		void updateTexture(Texture2D texture, Rectangle rect, const void* pixels) override {
+			UpdateTextureRec(texture, rect, pixels);
+		}
+
+		void unloadTexture(Texture2D texture) override {
+			UnloadTexture(texture);
+		}
+
+		void submit(DrawList& list) override {
+			list.forEachSorted([](const DrawCommand& c) {
+				switch (c.kind) {
+				case DrawKind::Texture:
+					DrawTexture(c.texture, (int)c.rect.x, (int)c.rect.y, c.color);
+					break;
+				case DrawKind::TextureRec:
+					DrawTextureRec(c.texture, c.source, { c.rect.x, c.rect.y }, c.color);
+					break;
+				case DrawKind::TexturePro:
+					DrawTexturePro(c.texture, c.source, c.rect, { 0, 0 }, 0.0f, c.color);
+					break;
+				case DrawKind::Text:
+					DrawText(c.text, (int)c.rect.x, (int)c.rect.y, (int)c.fontSize, c.color);
+					break;
+				case DrawKind::TextEx:
+					DrawTextEx(GetFontDefault(), c.text, { c.rect.x, c.rect.y }, c.fontSize, c.spacing, c.color);
+					break;
+				case DrawKind::Rect:
+					DrawRectangleRec(c.rect, c.color);
+					break;
+				case DrawKind::RectRounded:
+					DrawRectangleRounded(c.rect, c.spacing, 0, c.color);
+					break;
+				case DrawKind::RectLines:
+					DrawRectangleLines((int)c.rect.x, (int)c.rect.y, (int)c.rect.width, (int)c.rect.height, c.color);
+					break;
+				}
+				});
+		}
+
+	private:
+		Texture2D art[(size_t)TextureArt::Count]{};
+		bool tried[(size_t)TextureArt::Count]{};
+	};
+
+	// Draws nothing, counts what a GPU backend would have to do. Works without a window, its
+	// textures are ids without pixels, the art is 30 pixels square and the flag 20.
+	class NullBackend : public RenderBackend {
+	public:
+		struct FrameStats {
+			size_t drawCalls = 0;
+			size_t batchBreaks = 0;
+			size_t textureSwitches = 0;
+		};
+
+		void submit(DrawList& list) override {
+			stats = {};
+			bool first = true;
+			uint32_t lastKey = 0, lastTexture = 0;
+			bool hadTexture = false;
+			list.forEachSorted([&](const DrawCommand& c) {
+				stats.drawCalls++;
+				uint32_t key = DrawList::batchKey(c);
+				if (!first && key != lastKey)
+					stats.batchBreaks++;
+				if (key != DrawList::shapeKey) {
+					if (hadTexture && key != lastTexture)
+						stats.textureSwitches++;
+					lastTexture = key;
+					hadTexture = true;
+				}
+				lastKey = key;
+				first = false;
+				if (recording)
+					recorded.push_back(c);
+				});
+		}
+
+		Texture2D texture(TextureArt art) override {
+			int size = art == TextureArt::Flag ? 20 : 30;
+			return { (unsigned)art + 1, size, size, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 };
+		}
+
+		Texture2D createTexture(const Image& image) override {
+			return { nextTexture++, image.width, image.height, 1, image.format };
+		}
+
+		void updateTexture(Texture2D, Rectangle, const void*) override {}
+		void unloadTexture(Texture2D) override {}
+
+		// Ids above the art are the textures the renderer created
+		bool isTexture(uint32_t id) const {
+			return id > 0 && id < nextTexture;
+		}
+
+		const FrameStats& getStats() const {
+			return stats;
+		}
+
+		// Keeps a copy of every submitted command, in submission order
+		void setRecording(bool record) {
+			recording = record;
+			recorded.clear();
+		}
+
+		const std::vector<DrawCommand>& getRecorded() const {
+			return recorded;
+		}
+
+	private:
+		FrameStats stats;
+		bool recording = false;
+		std::vector<DrawCommand> recorded;
+		unsigned nextTexture = (unsigned)TextureArt::Count + 1;
+	};
+}
@@ -0,0 +1,297 @@
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+
+#include "bit_scan.h"
+#include "enums.h"
+
+namespace Minesweeper {
+
+	// Row major bit per tile, every row is followed by one guard bit that is never set. Shifting
+	// by one moves a tile to its left or right neighbor, shifting by Stride to the row above or
+	// below, and the guard bits stop the horizontal shifts from wrapping into the next row.
+	template<size_t Rows, size_t Cols>
+	class Bitboard {
+	public:
+		static constexpr size_t Stride = Cols + 1;
+		static constexpr size_t Bits = Rows * Stride;
+		static constexpr size_t Words = (Bits + 63) / 64;
+
+		static constexpr size_t bit(size_t row, size_t col) {
+			return row * Stride + col;
+		}
+
+		bool test(size_t row, size_t col) const {
+			size_t i = bit(row, col);
+			return words[i >> 6] >> (i & 63) & 1;
+		}
+
+		void set(size_t row, size_t col) {
+			size_t i = bit(row, col);
+			words[i >> 6] |= uint64_t(1) << (i & 63);
+		}
+
+		void reset(size_t row, size_t col) {
+			size_t i = bit(row, col);
+			words[i >> 6] &= ~(uint64_t(1) << (i & 63));
+		}
+
+		void flip(size_t row, size_t col) {
+			size_t i = bit(row, col);
+			words[i >> 6] ^= uint64_t(1) << (i & 63);
+		}
+
+		void clear() {
+			words.fill(0);
+		}
+
+		bool any() const {
+			uint64_t all = 0;
+			for (uint64_t word : words)
+				all |= word;
+			return all != 0;
+		}
+
+		// Calls f(row, col) for every set tile, lowest first
+		template<typename F>
+		void forEach(F f) const {
+			for (size_t i = 0; i < Words; i++) {
+				for (uint64_t word = words[i]; word; word &= word - 1) {
+					size_t bit = i * 64 + (size_t)countTrailingZeros(word);
+					f(bit / Stride, bit % Stride);
+				}
+			}
+		}
+
+		size_t count() const {
+			size_t total = 0;
+			for (uint64_t word : words)
+				total += std::bitset<64>(word).count();
+			return total;
+		}
+
+		// Every tile of the board, the guard bits and the bits past the last row stay clear
+		static const Bitboard& tiles() {
+			static const Bitboard mask = [] {
+				Bitboard b;
+				for (size_t row = 0; row < Rows; row++)
+					for (size_t col = 0; col < Cols; col++)
+						b.set(row, col);
+				return b;
+			}();
+			return mask;
+		}
+
+		// Towards higher tiles, to the right by one or down by Stride
+		Bitboard shiftUp(size_t n) const {
+			Bitboard out;
+			size_t wordShift = n >> 6, bitShift = n & 63;
+			for (size_t i = Words; i-- > wordShift;) {
+				uint64_t word = words[i - wordShift] << bitShift;
+				if (bitShift && i > wordShift)
+					word |= words[i - wordShift - 1] >> (64 - bitShift);
+				out.words[i] = word;
+			}
+			return out & tiles();
+		}
+
+		// Towards lower tiles, to the left by one or up by Stride
+		Bitboard shiftDown(size_t n) const {
+			Bitboard out;
+			size_t wordShift = n >> 6, bitShift = n & 63;
+			for (size_t i = 0; i + wordShift < Words; i++) {
+				uint64_t word = words[i + wordShift] >> bitShift;
+				if (bitShift && i + wordShift + 1 < Words)
+					word |= words[i + wordShift + 1] << (64 - bitShift);
+				out.words[i] = word;
+			}
+			return out & tiles();
+		}
+
+		// The tiles and their eight neighbors
+		Bitboard dilate() const {
+			Bitboard row = *this | shiftUp(1) | shiftDown(1);
+			return row | row.shiftUp(Stride) | row.shiftDown(Stride);
+		}
+
+		Bitboard operator|(const Bitboard& other) const { Bitboard out; for (size_t i = 0; i < Words; i++) out.words[i] = words[i] | other.words[i]; return out; }
+		Bitboard operator&(const Bitboard& other) const { Bitboard out; for (size_t i = 0; i < Words; i++) out.words[i] = words[i] & other.words[i]; return out; }
+		Bitboard operator^(const Bitboard& other) const { Bitboard out; for (size_t i = 0; i < Words; i++) out.words[i] = words[i] ^ other.words[i]; return out; }
+		// Complement inside the board
+		Bitboard operator~() const { Bitboard out; for (size_t i = 0; i < Words; i++) out.words[i] = ~words[i] & tiles().words[i]; return out; }
+		Bitboard& operator|=(const Bitboard& other) { for (size_t i = 0; i < Words; i++) words[i] |= other.words[i]; return *this; }
+		Bitboard& operator&=(const Bitboard& other) { for (size_t i = 0; i < Words; i++) words[i] &= other.words[i]; return *this; }
+		bool operator==(const Bitboard& other) const { return words == other.words; }
+		bool operator!=(const Bitboard& other) const { return words != other.words; }
+
+	private:
+		std::array<uint64_t, Words> words{};
+	};
+
+	// Board of a size known at compile time kept in bitboards: mines, opened and flagged tiles and
+	// the hints as four bit planes. Hints, cascades and the win check work on whole words instead
+	// of single tiles. The grid of bot boards plays the presets on it, the main Game stays on the
+	// dynamic Board, which carries the zero regions, replays, co-op and the heatmap it needs.
+	template<size_t Rows, size_t Cols>
+	class FixedBoard {
+	public:
+		using Bits = Bitboard<Rows, Cols>;
+		static constexpr size_t TileCount = Rows * Cols;
+		static_assert(TileCount <= 65535, "mine placement keeps tile indices in 16 bits");
+
+		FixedBoard(uint32_t seed = std::random_device{}()) : rng{ seed } {}
+
+		void startGame(size_t bombs) {
+			bombTotal = bombs < TileCount ? bombs : TileCount - 1;
+			placeBombs(Bits{});
+			resetGame();
+		}
+
+		// Same mines, every tile closed
+		void resetGame() {
+			opened.clear();
+			flagged.clear();
+			state = GameState::Ongoing;
+			firstMove = true;
+		}
+
+		void setFirstClickSafe(bool safe) { firstClickSafe = safe; }
+
+		void openTile(size_t row, size_t col) {
+			if (state != GameState::Ongoing || opened.test(row, col) || flagged.test(row, col))
+				return;
+			if (firstMove) {
+				firstMove = false;
+				Bits area;
+				area.set(row, col);
+				area = area.dilate();
+				if (firstClickSafe && (bombs & area).any() && TileCount - bombTotal >= 9)
+					placeBombs(area);
+			}
+			Bits seed;
+			seed.set(row, col);
+			reveal(seed);
+		}
+
+		void toggleFlag(size_t row, size_t col) {
+			if (state != GameState::Ongoing || opened.test(row, col))
+				return;
+			flagged.flip(row, col);
+		}
+
+		// Opens the closed neighbors of an open tile once as many flags as its hint surround it
+		void fastOpen(size_t row, size_t col) {
+			if (state != GameState::Ongoing || !opened.test(row, col))
+				return;
+			Bits around;
+			around.set(row, col);
+			around = around.dilate();
+			if ((int)(around & flagged).count() != getValue(row, col))
+				return;
+			reveal(around & ~opened & ~flagged);
+		}
+
+		TileState getTileState(size_t row, size_t col) const {
+			if (opened.test(row, col))
+				return TileState::Open;
+			if (flagged.test(row, col))
+				return TileState::Flagged;
+			return TileState::Closed;
+		}
+
+		GameState getGameState() const { return state; }
+
+		// Mines minus flags, like the counter of Game
+		size_t getBombs() const { return bombTotal - flagged.count(); }
+		size_t getBombTotal() const { return bombTotal; }
+
+		bool isBomb(size_t row, size_t col) const { return bombs.test(row, col); }
+
+		int getValue(size_t row, size_t col) const {
+			return hint[0].test(row, col) | hint[1].test(row, col) << 1 | hint[2].test(row, col) << 2 | hint[3].test(row, col) << 3;
+		}
+
+		const Bits& getOpened() const { return opened; }
+		const Bits& getFlagged() const { return flagged; }
+
+		static constexpr size_t rows() { return Rows; }
+		static constexpr size_t cols() { return Cols; }
+
+	private:
+		// Mines on bombTotal random tiles outside of the excluded ones, partial Fisher-Yates
+		void placeBombs(const Bits& excluded) {
+			std::array<uint16_t, TileCount> candidates;
+			size_t count = 0;
+			for (size_t i = 0; i < TileCount; i++) {
+				if (!excluded.test(i / Cols, i % Cols))
+					candidates[count++] = (uint16_t)i;
+			}
+			bombs.clear();
+			size_t place = bombTotal < count ? bombTotal : count;
+			for (size_t i = 0; i < place; i++) {
+				size_t pick = std::uniform_int_distribution<size_t>{ i, count - 1 }(rng);
+				std::swap(candidates[i], candidates[pick]);
+				bombs.set(candidates[i] / Cols, candidates[i] % Cols);
+			}
+			placeHints();
+		}
+
+		// Adds the eight shifted mine planes into a four bit counter per tile
+		void placeHints() {
+			for (Bits& plane : hint)
+				plane.clear();
+			Bits left = bombs.shiftDown(1), right = bombs.shiftUp(1);
+			Bits neighbors[8] = {
+				left, right,
+				bombs.shiftDown(Bits::Stride), left.shiftDown(Bits::Stride), right.shiftDown(Bits::Stride),
+				bombs.shiftUp(Bits::Stride), left.shiftUp(Bits::Stride), right.shiftUp(Bits::Stride),
+			};
+			for (const Bits& neighbor : neighbors) {
+				Bits carry = neighbor;
+				for (Bits& plane : hint) {
+					Bits sum = plane ^ carry;
+					carry = plane & carry;
+					plane = sum;
+				}
+			}
+			Bits numbered = hint[0] | hint[1] | hint[2] | hint[3];
+			zeros = ~numbered & ~bombs;
+		}
+
+		// Opens the seeds and grows through the zero tiles by dilation until nothing changes
+		void reveal(Bits seeds) {
+			if ((seeds & bombs).any()) {
+				opened |= seeds;
+				state = GameState::Lost;
+				return;
+			}
+			Bits closedSafe = ~opened & ~flagged & ~bombs;
+			Bits region = seeds;
+			while (true) {
+				Bits grown = region | ((region & zeros).dilate() & closedSafe);
+				if (grown == region)
+					break;
+				region = grown;
+			}
+			opened |= region;
+			if ((opened | bombs) == Bits::tiles())
+				state = GameState::Won;
+		}
+
+		std::mt19937 rng;
+		Bits bombs, opened, flagged, zeros;
+		Bits hint[4];
+		size_t bombTotal = 0;
+		GameState state = GameState::Ongoing;
+		bool firstMove = true;
+		bool firstClickSafe = true;
+	};
+
+	using BeginnerBoard = FixedBoard<9, 9>;
+	using IntermediateBoard = FixedBoard<16, 16>;
+	using ExpertBoard = FixedBoard<16, 30>;
+}
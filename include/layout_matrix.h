@@ -0,0 +1,234 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include "matrix_storage.h"
+
+namespace Minesweeper {
+
+	// Plain row by row storage, same order as Matrix. Rows of padPages pages and more are padded
+	// to whole pages, so every row of a mapped board starts on a page boundary and a band of rows
+	// is paged in and dropped without sharing a page with the next one. The padding stays below a
+	// sixteenth of a row, shorter rows share pages and aren't padded.
+	class RowMajorLayout {
+	public:
+		// Rows that are stored together, bands of rows start on a multiple of it
+		static constexpr size_t rowBlock = 1;
+		static constexpr size_t padPages = 16;
+
+		void resize(size_t rows, size_t cols, size_t elementBytes) {
+			this->rows = rows;
+			this->cols = cols;
+			size_t page = storagePageBytes();
+			stride = cols;
+			if (cols * elementBytes >= padPages * page && page % elementBytes == 0)
+				stride = (cols * elementBytes + page - 1) / page * (page / elementBytes);
+		}
+
+		size_t storageSize() const {
+			return rows * stride;
+		}
+
+		size_t index(size_t row, size_t col) const {
+			return row * stride + col;
+		}
+
+		// Storage index of the first tile of row, row is a multiple of rowBlock
+		size_t rowStart(size_t row) const {
+			return row * stride;
+		}
+
+		// Row and column stored at index, false for padding
+		bool position(size_t index, size_t& row, size_t& col) const {
+			row = index / stride;
+			col = index % stride;
+			return col < cols;
+		}
+
+	private:
+		size_t rows = 0, cols = 0;
+		size_t stride = 0;
+	};
+
+	// Square blocks of 2^BlockBits tiles stored one after the other, so the rows above and below a
+	// tile are usually in the same block. Inside a block tiles are row by row, or in Z-order when
+	// Morton is set. The board is padded to whole blocks.
+	template<unsigned BlockBits = 4, bool Morton = false>
+	class BlockedLayout {
+	public:
+		static constexpr size_t blockSide = size_t(1) << BlockBits;
+		static constexpr size_t blockMask = blockSide - 1;
+		static constexpr size_t rowBlock = blockSide;
+
+		void resize(size_t rows, size_t cols, size_t) {
+			this->rows = rows;
+			this->cols = cols;
+			blocksPerRow = (cols + blockMask) >> BlockBits;
+			blockRows = (rows + blockMask) >> BlockBits;
+		}
+
+		size_t storageSize() const {
+			return blocksPerRow * blockRows << (2 * BlockBits);
+		}
+
+		size_t index(size_t row, size_t col) const {
+			size_t block = (row >> BlockBits) * blocksPerRow + (col >> BlockBits);
+			return block << (2 * BlockBits) | inBlock(row & blockMask, col & blockMask);
+		}
+
+		size_t rowStart(size_t row) const {
+			return (row >> BlockBits) * blocksPerRow << (2 * BlockBits);
+		}
+
+		bool position(size_t index, size_t& row, size_t& col) const {
+			size_t block = index >> (2 * BlockBits);
+			size_t offset = index & ((size_t(1) << (2 * BlockBits)) - 1);
+			size_t r, c;
+			if constexpr (Morton) {
+				r = compact(offset >> 1);
+				c = compact(offset);
+			}
+			else {
+				r = offset >> BlockBits;
+				c = offset & blockMask;
+			}
+			row = (block / blocksPerRow) << BlockBits | r;
+			col = (block % blocksPerRow) << BlockBits | c;
+			return row < rows && col < cols;
+		}
+
+	private:
+		static size_t inBlock(size_t r, size_t c) {
+			if constexpr (Morton)
+				return spread(r) << 1 | spread(c);
+			else
+				return r << BlockBits | c;
+		}
+
+		// Moves bit i of x to bit 2i, x has at most 16 bits
+		static size_t spread(size_t x) {
+			x = (x | (x << 8)) & 0x00FF00FF;
+			x = (x | (x << 4)) & 0x0F0F0F0F;
+			x = (x | (x << 2)) & 0x33333333;
+			x = (x | (x << 1)) & 0x55555555;
+			return x;
+		}
+
+		static size_t compact(size_t x) {
+			x &= 0x55555555;
+			x = (x | (x >> 1)) & 0x33333333;
+			x = (x | (x >> 2)) & 0x0F0F0F0F;
+			x = (x | (x >> 4)) & 0x00FF00FF;
+			x = (x | (x >> 8)) & 0x0000FFFF;
+			return x;
+		}
+
+		size_t rows = 0, cols = 0;
+		size_t blocksPerRow = 0, blockRows = 0;
+	};
+
+	template<unsigned BlockBits = 3>
+	using TiledLayout = BlockedLayout<BlockBits, false>;
+
+	template<unsigned BlockBits = 4>
+	using MortonLayout = BlockedLayout<BlockBits, true>;
+
+	// Matrix with the same interface as Matrix<T> whose memory order is picked by the Layout policy
+	// and whose memory comes from the Storage policy
+	template<typename T, typename Layout = RowMajorLayout, typename Storage = HeapStorage<T>>
+	class LayoutMatrix {
+	public:
+		class Row {
+		public:
+			Row(const LayoutMatrix* matrix, size_t row) : matrix{ matrix }, row{ row } {}
+
+			T& operator[](size_t col) const {
+				return const_cast<T&>(matrix->data.get()[matrix->layout.index(row, col)]);
+			}
+
+		private:
+			const LayoutMatrix* matrix;
+			size_t row;
+		};
+
+		LayoutMatrix(size_t rows = 0, size_t cols = 0) {
+			resize(rows, cols);
+		}
+
+		// Every element is reset, heap storage keeps its capacity when the matrix shrinks
+		void resize(size_t rows, size_t cols) {
+			this->rows = rows;
+			this->cols = cols;
+			layout.resize(rows, cols, sizeof(T));
+			data.resize(layout.storageSize());
+		}
+
+		size_t size() const {
+			return rows * cols;
+		}
+
+		size_t size(int dim) const {
+			return dim == 0 ? rows : cols;
+		}
+
+		Row operator[](size_t row) {
+			return Row{ this, row };
+		}
+
+		const Row operator[](size_t row) const {
+			return Row{ this, row };
+		}
+
+		// Walks the tiles in memory order, call(row, col, T&), padding is skipped
+		template<typename Call>
+		void forEach(Call call) {
+			forEachIn(0, data.size(), call);
+		}
+
+		// Same as forEach, but walks the storage in bands of about bandBytes. Every band is prefetched
+		// before it is walked and the band before it is dropped once it is done, so at most two bands
+		// of a mapped matrix are resident. call may read the rows next to the tile it gets.
+		template<typename Call>
+		void forEachBand(size_t bandBytes, Call call) {
+			size_t rowBytes = std::max<size_t>(cols, 1) * sizeof(T);
+			size_t bandRows = std::max<size_t>(bandBytes / rowBytes, 1);
+			bandRows = (bandRows + Layout::rowBlock - 1) / Layout::rowBlock * Layout::rowBlock;
+
+			data.adviseSequential();
+			size_t previous = 0;
+			for (size_t row = 0; row < rows; row += bandRows) {
+				size_t first = layout.rowStart(row);
+				size_t last = row + bandRows < rows ? layout.rowStart(row + bandRows) : data.size();
+				data.willNeed(first, last - first);
+				forEachIn(first, last, call);
+				data.dontNeed(previous, first - previous);
+				previous = first;
+			}
+			data.adviseRandom();
+		}
+
+		// Raw storage in memory order, padding included
+		T* begin() { return data.get(); }
+		T* end() { return data.get() + data.size(); }
+
+		Storage& getStorage() { return data; }
+		const Storage& getStorage() const { return data; }
+
+	private:
+		template<typename Call>
+		void forEachIn(size_t first, size_t last, Call& call) {
+			size_t row, col;
+			T* tiles = data.get();
+			for (size_t i = first; i < last; i++) {
+				if (layout.position(i, row, col))
+					call(row, col, tiles[i]);
+			}
+		}
+
+		size_t rows = 0, cols = 0;
+		Layout layout;
+		Storage data;
+	};
+}
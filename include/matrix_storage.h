@@ -0,0 +1,346 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace Minesweeper {
+
+	// Unit mapped storage is paged in and out by
+	inline size_t storagePageBytes() {
+#if defined(_WIN32)
+		return 4096;
+#else
+		static const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+		return page;
+#endif
+	}
+
+	// Storage backends for LayoutMatrix. The advise calls are hints about the coming access
+	// pattern, they only do something for memory mapped storage.
+	template<typename T>
+	class HeapStorage {
+	public:
+		void resize(size_t count) {
+			data.assign(count, T{});
+		}
+
+		// Frees the memory, resize only ever keeps it
+		void release() {
+			std::vector<T>().swap(data);
+		}
+
+		T* get() { return data.data(); }
+		const T* get() const { return data.data(); }
+		size_t size() const { return data.size(); }
+
+		void adviseSequential() {}
+		void adviseRandom() {}
+		void willNeed(size_t, size_t) {}
+		void dontNeed(size_t, size_t) {}
+
+		size_t residentBytes() const {
+			return data.size() * sizeof(T);
+		}
+
+	private:
+		std::vector<T> data;
+	};
+
+#if defined(_WIN32)
+	//windows.h clashes with raylib (Rectangle, CloseWindow, ...), boards stay on the heap there
+	template<typename T>
+	using MappedStorage = HeapStorage<T>;
+#else
+	// Keeps the elements in a file mapped into memory, so boards larger than RAM are paged in and
+	// out by the OS. Without a path an unlinked temporary file in $TMPDIR or /var/tmp is used.
+	template<typename T>
+	class MappedStorage {
+	public:
+		MappedStorage() = default;
+		explicit MappedStorage(std::string path) : path{ std::move(path) } {}
+
+		~MappedStorage() {
+			release();
+		}
+
+		MappedStorage(const MappedStorage&) = delete;
+		MappedStorage& operator=(const MappedStorage&) = delete;
+
+		MappedStorage(MappedStorage&& other) noexcept {
+			*this = std::move(other);
+		}
+
+		MappedStorage& operator=(MappedStorage&& other) noexcept {
+			if (this != &other) {
+				release();
+				std::swap(path, other.path);
+				std::swap(fd, other.fd);
+				std::swap(mapping, other.mapping);
+				std::swap(bytes, other.bytes);
+				std::swap(count, other.count);
+			}
+			return *this;
+		}
+
+		// Keeps the mapping while the elements fit in it, so a board started again on the same or a
+		// smaller size reuses its file. Only a larger count grows the file and the mapping.
+		void resize(size_t newCount) {
+			if (newCount == 0) {
+				release();
+				return;
+			}
+			destroy();
+			size_t newBytes = roundUp(newCount * sizeof(T));
+			if (!mapping)
+				create(newBytes);
+			else if (newBytes > bytes)
+				grow(newBytes);
+
+			count = newCount;
+			//Constructed in bands like forEachBand so only a few pages stay resident
+			adviseSequential();
+			size_t band = std::max<size_t>(bandBytes / sizeof(T), 1);
+			for (size_t first = 0; first < count; first += band) {
+				size_t last = std::min(first + band, count);
+				for (size_t i = first; i < last; i++)
+					new (mapping + i) T{};
+				dontNeed(first, last - first);
+			}
+			adviseRandom();
+		}
+
+		T* get() { return mapping; }
+		const T* get() const { return mapping; }
+		size_t size() const { return count; }
+
+		void adviseSequential() {
+			advise(0, bytes, MADV_SEQUENTIAL);
+		}
+
+		void adviseRandom() {
+			advise(0, bytes, MADV_RANDOM);
+		}
+
+		// Prefetches the pages holding elements [first, first + n)
+		void willNeed(size_t first, size_t n) {
+			size_t begin = roundDown(first * sizeof(T));
+			advise(begin, roundUp((first + n) * sizeof(T)) - begin, MADV_WILLNEED);
+		}
+
+		// Drops the pages that lie completely inside elements [first, first + n), the data stays in the file.
+		// Anonymous memory would be zeroed, so nothing is dropped without a file.
+		void dontNeed(size_t first, size_t n) {
+			if (fd < 0)
+				return;
+			size_t begin = roundUp(first * sizeof(T));
+			size_t end = roundDown((first + n) * sizeof(T));
+			if (end > begin)
+				advise(begin, end - begin, MADV_DONTNEED);
+		}
+
+		// Bytes of the file currently cached in memory. Dropped pages can stay in the page cache until
+		// the OS needs the memory, so this is an upper bound of what the board holds.
+		size_t residentBytes() const {
+			if (!mapping)
+				return 0;
+			size_t page = pageSize();
+			std::vector<unsigned char> pages((bytes + page - 1) / page);
+			if (mincore(mapping, bytes, pages.data()) != 0)
+				return 0;
+			size_t resident = 0;
+			for (unsigned char p : pages)
+				resident += p & 1;
+			return resident * page;
+		}
+
+	private:
+		static constexpr size_t bandBytes = size_t(4) << 20;
+
+		static size_t pageSize() {
+			return storagePageBytes();
+		}
+
+		static size_t roundUp(size_t n) {
+			return (n + pageSize() - 1) / pageSize() * pageSize();
+		}
+
+		static size_t roundDown(size_t n) {
+			return n / pageSize() * pageSize();
+		}
+
+		void advise(size_t offset, size_t length, int advice) {
+			if (mapping && length > 0)
+				madvise(reinterpret_cast<char*>(mapping) + offset, std::min(length, bytes - offset), advice);
+		}
+
+		void create(size_t newBytes) {
+			bytes = newBytes;
+			if (path.empty()) {
+				const char* dir = std::getenv("TMPDIR");
+				std::string name = std::string{ dir ? dir : "/var/tmp" } + "/minesweeper-XXXXXX";
+				fd = mkstemp(name.data());
+				if (fd >= 0)
+					unlink(name.c_str());
+			}
+			else {
+				fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+			}
+			if (fd < 0 || ftruncate(fd, (off_t)bytes) != 0) {
+				std::cerr << "Failed to create board file, using anonymous memory!" << std::endl;
+				closeFile();
+			}
+			map(mmap(nullptr, bytes, PROT_READ | PROT_WRITE, fd >= 0 ? MAP_SHARED : MAP_PRIVATE | MAP_ANONYMOUS, fd, 0));
+		}
+
+		// The file grows first, the mapping follows it, moved by the kernel where mremap is there
+		void grow(size_t newBytes) {
+			if (fd >= 0 && ftruncate(fd, (off_t)newBytes) != 0) {
+				release();
+				create(newBytes);
+				return;
+			}
+#if defined(__linux__)
+			void* mapped = mremap(mapping, bytes, newBytes, MREMAP_MAYMOVE);
+			if (mapped == MAP_FAILED)
+				munmap(mapping, bytes);
+#else
+			munmap(mapping, bytes);
+			void* mapped = mmap(nullptr, newBytes, PROT_READ | PROT_WRITE, fd >= 0 ? MAP_SHARED : MAP_PRIVATE | MAP_ANONYMOUS, fd, 0);
+#endif
+			bytes = newBytes;
+			map(mapped);
+		}
+
+		void map(void* mapped) {
+			if (mapped == MAP_FAILED) {
+				std::cerr << "Failed to map board memory!" << std::endl;
+				mapping = nullptr;
+				closeFile();
+				bytes = 0;
+				throw std::bad_alloc{};
+			}
+			mapping = static_cast<T*>(mapped);
+		}
+
+		void destroy() {
+			if (mapping) {
+				for (size_t i = 0; i < count; i++)
+					mapping[i].~T();
+			}
+			count = 0;
+		}
+
+		void closeFile() {
+			if (fd >= 0)
+				close(fd);
+			fd = -1;
+		}
+
+		void release() {
+			destroy();
+			if (mapping)
+				munmap(mapping, bytes);
+			closeFile();
+			mapping = nullptr;
+			bytes = 0;
+			count = 0;
+		}
+
+		std::string path;
+		int fd = -1;
+		T* mapping = nullptr;
+		size_t bytes = 0;
+		size_t count = 0;
+	};
+#endif
+
+	// Elements from which AdaptiveStorage maps a file, in bytes per plane
+	inline size_t mappedStorageBytes = size_t(1) << 30;
+
+	// Heap memory for planes below mappedStorageBytes and a mapped file for larger ones, so one build
+	// plays both the presets and boards larger than RAM. get() is cached, access costs the same as heap.
+	template<typename T>
+	class AdaptiveStorage {
+	public:
+		AdaptiveStorage() = default;
+
+		AdaptiveStorage(AdaptiveStorage&& other) noexcept {
+			*this = std::move(other);
+		}
+
+		AdaptiveStorage& operator=(AdaptiveStorage&& other) noexcept {
+			if (this != &other) {
+				heap = std::move(other.heap);
+				mapped = std::move(other.mapped);
+				data = std::exchange(other.data, nullptr);
+				count = std::exchange(other.count, 0);
+				isMapped = std::exchange(other.isMapped, false);
+			}
+			return *this;
+		}
+
+		void resize(size_t newCount) {
+			isMapped = newCount * sizeof(T) >= mappedStorageBytes;
+			if (isMapped) {
+				heap.release();
+				mapped.resize(newCount);
+				data = mapped.get();
+			}
+			else {
+				mapped.resize(0);
+				heap.resize(newCount);
+				data = heap.get();
+			}
+			count = newCount;
+		}
+
+		T* get() { return data; }
+		const T* get() const { return data; }
+		size_t size() const { return count; }
+
+		bool isFileBacked() const { return isMapped; }
+
+		void adviseSequential() {
+			if (isMapped)
+				mapped.adviseSequential();
+		}
+
+		void adviseRandom() {
+			if (isMapped)
+				mapped.adviseRandom();
+		}
+
+		void willNeed(size_t first, size_t n) {
+			if (isMapped)
+				mapped.willNeed(first, n);
+		}
+
+		void dontNeed(size_t first, size_t n) {
+			if (isMapped)
+				mapped.dontNeed(first, n);
+		}
+
+		size_t residentBytes() const {
+			return isMapped ? mapped.residentBytes() : heap.residentBytes();
+		}
+
+	private:
+		HeapStorage<T> heap;
+		MappedStorage<T> mapped;
+		T* data = nullptr;
+		size_t count = 0;
+		bool isMapped = false;
+	};
+}
@@ -0,0 +1,602 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "neighborhood.h"
+
+namespace Minesweeper {
+
+	struct TileProbability {
+		size_t index;
+		float mine;
+	};
+
+	// Exact mine probability of every closed tile on the frontier, computed on a background thread.
+	// The frontier is split into components that share no hint. A component is enumerated again only
+	// when a change lands within two tiles of it, the others keep their solution counts and only the
+	// cheap combination over the remaining mine count is redone. Flags are trusted to be mines.
+	class MineProbability {
+	public:
+		struct Stats {
+			size_t frontierTiles = 0;
+			size_t components = 0;
+			size_t enumerated = 0;
+			size_t unsolved = 0;
+			double latency = 0.0;
+		};
+
+		MineProbability() : worker{ [this] { run(); } } {}
+
+		~MineProbability() {
+			{
+				std::lock_guard<std::mutex> lock{ mutex };
+				stopping = true;
+			}
+			wake.notify_one();
+			worker.join();
+		}
+
+		MineProbability(const MineProbability&) = delete;
+		MineProbability& operator=(const MineProbability&) = delete;
+
+		// Queues a change set with opened, closed, flagged and unflagged tile indices. valueOf(index)
+		// is the hint of an opened tile or -1 for a mine, mines is the total mine count.
+		template<typename Changes, typename ValueOf>
+		void apply(const Changes& changes, size_t rows, size_t cols, size_t mines, ValueOf valueOf) {
+			if (!changes.reset && changes.opened.empty() && changes.closed.empty() && changes.flagged.empty() && changes.unflagged.empty())
+				return;
+			{
+				std::lock_guard<std::mutex> lock{ mutex };
+				if (changes.reset) {
+					pending.clear();
+					if (pending.capacity() < reservedCommands)
+						pending.reserve(reservedCommands);
+					pendingReset = true;
+					resetRows = rows;
+					resetCols = cols;
+					resetMines = mines;
+				}
+				for (size_t index : changes.opened)
+					pending.push_back({ Command::Opened, index, valueOf(index) });
+				for (size_t index : changes.closed)
+					pending.push_back({ Command::Closed, index, 0 });
+				for (size_t index : changes.flagged)
+					pending.push_back({ Command::Flagged, index, 0 });
+				for (size_t index : changes.unflagged)
+					pending.push_back({ Command::Unflagged, index, 0 });
+				if (!requested)
+					requestTime = Clock::now();
+				requested = true;
+			}
+			wake.notify_one();
+		}
+
+		// Nothing is computed while disabled, enabling recomputes the whole frontier once
+		void setEnabled(bool enable) {
+			{
+				std::lock_guard<std::mutex> lock{ mutex };
+				if (enabled == enable)
+					return;
+				enabled = enable;
+				if (enable) {
+					rebuildAll = true;
+					requested = true;
+					requestTime = Clock::now();
+				}
+			}
+			wake.notify_one();
+		}
+
+		bool isEnabled() const {
+			std::lock_guard<std::mutex> lock{ mutex };
+			return enabled;
+		}
+
+		// Picks up the newest finished result, the last one stays visible until then
+		bool poll() {
+			std::lock_guard<std::mutex> lock{ mutex };
+			if (!fresh)
+				return false;
+			std::swap(frontier, published);
+			rest = publishedRest;
+			stats = publishedStats;
+			fresh = false;
+			return true;
+		}
+
+		const std::vector<TileProbability>& getFrontier() const { return frontier; }
+		// Probability of a closed tile away from the frontier
+		float getRestProbability() const { return rest; }
+		const Stats& getStats() const { return stats; }
+
+	private:
+		using Clock = std::chrono::steady_clock;
+		static constexpr uint32_t none = UINT32_MAX;
+		static constexpr int8_t CLOSED = -1, FLAGGED = -2, MINE = -3;
+		// Components above this size or search nodes are given up as too big to enumerate
+		static constexpr size_t maxComponentTiles = 128;
+		static constexpr size_t nodeBudget = size_t(1) << 22;
+		// Above this many stored weights the combination treats the rest as a fixed density
+		static constexpr size_t exactBudget = size_t(1) << 22;
+		// Queue capacity kept on both sides of the swap, so queuing a frame's changes doesn't allocate
+		static constexpr size_t reservedCommands = size_t(1) << 16;
+
+		struct Command {
+			enum Kind : uint8_t { Opened, Closed, Flagged, Unflagged } kind;
+			size_t index;
+			int value;
+		};
+
+		struct Component {
+			bool alive = false;
+			bool solved = false;
+			std::vector<size_t> tiles;
+			// Solutions with k mines, and per tile the solutions with k mines that have a mine there
+			std::vector<double> solutions;
+			std::vector<double> hits;
+		};
+
+		//Result shown by the main thread
+		std::vector<TileProbability> frontier;
+		float rest = 0.0f;
+		Stats stats;
+
+		//Shared with the worker, guarded by mutex
+		mutable std::mutex mutex;
+		std::condition_variable wake;
+		std::vector<Command> pending;
+		bool pendingReset = false;
+		size_t resetRows = 0, resetCols = 0, resetMines = 0;
+		bool enabled = false, rebuildAll = false, requested = false, fresh = false, stopping = false;
+		Clock::time_point requestTime;
+		std::vector<TileProbability> published;
+		float publishedRest = 0.0f;
+		Stats publishedStats;
+
+		//Mirror of the board and the components, only touched by the worker
+		size_t rows = 0, cols = 0, mines = 0;
+		std::vector<int8_t> tiles;
+		std::vector<uint32_t> componentOf;
+		std::vector<uint32_t> localIndex;
+		std::vector<uint32_t> hintStamp;
+		uint32_t stamp = 0;
+		std::vector<Component> components;
+		std::vector<uint32_t> freeComponents;
+		size_t closedCount = 0, flagCount = 0, openedMines = 0;
+		std::vector<size_t> changed;
+		std::vector<size_t> seeds;
+		std::vector<uint32_t> fresher;
+		std::vector<TileProbability> result;
+
+		void run() {
+			std::vector<Command> batch;
+			batch.reserve(reservedCommands);
+			std::unique_lock<std::mutex> lock{ mutex };
+			while (true) {
+				wake.wait(lock, [this] { return stopping || requested; });
+				if (stopping)
+					return;
+				bool reset = pendingReset;
+				size_t newRows = resetRows, newCols = resetCols, newMines = resetMines;
+				bool compute = enabled;
+				bool all = rebuildAll;
+				Clock::time_point started = requestTime;
+				std::swap(batch, pending);
+				pending.clear();
+				pendingReset = rebuildAll = requested = false;
+				lock.unlock();
+
+				if (reset)
+					resetBoard(newRows, newCols, newMines);
+				for (const Command& command : batch)
+					applyCommand(command);
+				batch.clear();
+				if (compute) {
+					Stats newStats;
+					recompute(all || reset, newStats);
+					newStats.latency = std::chrono::duration<double>(Clock::now() - started).count();
+					lock.lock();
+					std::swap(published, result);
+					publishedRest = resultRest;
+					publishedStats = newStats;
+					fresh = true;
+					continue;
+				}
+				changed.clear();
+				lock.lock();
+			}
+		}
+
+		void resetBoard(size_t newRows, size_t newCols, size_t newMines) {
+			rows = newRows;
+			cols = newCols;
+			mines = newMines;
+			tiles.assign(rows * cols, CLOSED);
+			componentOf.assign(rows * cols, none);
+			localIndex.assign(rows * cols, 0);
+			hintStamp.assign(rows * cols, 0);
+			stamp = 0;
+			components.clear();
+			freeComponents.clear();
+			closedCount = rows * cols;
+			flagCount = openedMines = 0;
+			changed.clear();
+		}
+
+		void applyCommand(const Command& command) {
+			if (command.index >= tiles.size())
+				return;
+			int8_t& tile = tiles[command.index];
+			switch (command.kind) {
+			case Command::Opened:
+				if (tile == CLOSED)
+					closedCount--;
+				tile = command.value < 0 ? MINE : (int8_t)command.value;
+				if (tile == MINE)
+					openedMines++;
+				break;
+			case Command::Closed:
+				if (tile == MINE)
+					openedMines--;
+				if (tile != CLOSED)
+					closedCount++;
+				tile = CLOSED;
+				break;
+			case Command::Flagged:
+				if (tile == CLOSED) {
+					closedCount--;
+					flagCount++;
+					tile = FLAGGED;
+				}
+				break;
+			case Command::Unflagged:
+				if (tile == FLAGGED) {
+					closedCount++;
+					flagCount--;
+					tile = CLOSED;
+				}
+				break;
+			}
+			changed.push_back(command.index);
+		}
+
+		template<typename Call>
+		void forEachNeighbor(size_t index, Call call) const {
+			Neighborhood<SquareTopology>::forEach(index / cols, index % cols, rows, cols, [this, &call](size_t row, size_t col) {
+				call(row * cols + col);
+				});
+		}
+
+		bool isFrontier(size_t index) const {
+			if (tiles[index] != CLOSED)
+				return false;
+			bool found = false;
+			forEachNeighbor(index, [&](size_t n) { found |= tiles[n] >= 0; });
+			return found;
+		}
+
+		void dropComponent(uint32_t id) {
+			Component& component = components[id];
+			if (!component.alive)
+				return;
+			for (size_t tile : component.tiles) {
+				componentOf[tile] = none;
+				seeds.push_back(tile);
+			}
+			component.alive = false;
+			freeComponents.push_back(id);
+		}
+
+		// Drops the components within two tiles of a change and builds new ones from their tiles
+		void recompute(bool all, Stats& newStats) {
+			seeds.clear();
+			fresher.clear();
+			if (all) {
+				for (uint32_t id = 0; id < components.size(); id++)
+					dropComponent(id);
+				seeds.clear();
+				for (size_t i = 0; i < tiles.size(); i++)
+					seeds.push_back(i);
+			}
+			else {
+				for (size_t index : changed) {
+					size_t row = index / cols, col = index % cols;
+					for (size_t r = row > 1 ? row - 2 : 0; r <= row + 2 && r < rows; r++)
+						for (size_t c = col > 1 ? col - 2 : 0; c <= col + 2 && c < cols; c++) {
+							size_t near = r * cols + c;
+							seeds.push_back(near);
+							if (componentOf[near] != none)
+								dropComponent(componentOf[near]);
+						}
+				}
+			}
+			changed.clear();
+
+			for (size_t i = 0; i < seeds.size(); i++) {
+				size_t seed = seeds[i];
+				if (componentOf[seed] == none && isFrontier(seed))
+					fresher.push_back(buildComponent(seed));
+			}
+			for (uint32_t id : fresher) {
+				if (components[id].alive)
+					enumerate(components[id]);
+			}
+			newStats.enumerated = fresher.size();
+			combine(newStats);
+		}
+
+		uint32_t buildComponent(size_t seed) {
+			uint32_t id;
+			if (!freeComponents.empty()) {
+				id = freeComponents.back();
+				freeComponents.pop_back();
+			}
+			else {
+				id = (uint32_t)components.size();
+				components.emplace_back();
+			}
+			Component& component = components[id];
+			component.alive = true;
+			component.tiles.clear();
+			component.tiles.push_back(seed);
+			componentOf[seed] = id;
+			//Breadth first through the hints, the order keeps neighboring tiles close for the search
+			for (size_t i = 0; i < component.tiles.size(); i++) {
+				forEachNeighbor(component.tiles[i], [&](size_t hint) {
+					if (tiles[hint] < 0)
+						return;
+					forEachNeighbor(hint, [&](size_t tile) {
+						if (tiles[tile] != CLOSED)
+							return;
+						if (componentOf[tile] != none && componentOf[tile] != id)
+							dropComponent(componentOf[tile]);
+						if (componentOf[tile] == none) {
+							componentOf[tile] = id;
+							components[id].tiles.push_back(tile);
+						}
+						});
+					});
+			}
+			return id;
+		}
+
+		struct Constraint {
+			int need;
+			int mines;
+			int open;
+			std::vector<uint32_t> vars;
+		};
+
+		// Counts the solutions of a component per mine count with a depth first search
+		void enumerate(Component& component) {
+			size_t count = component.tiles.size();
+			component.solved = false;
+			if (count > maxComponentTiles)
+				return;
+			component.solutions.assign(count + 1, 0.0);
+			component.hits.assign(count * (count + 1), 0.0);
+
+			std::vector<Constraint> constraints;
+			std::vector<std::vector<uint32_t>> varConstraints(count);
+			std::vector<size_t> hintTiles;
+			if (++stamp == 0) {
+				std::fill(hintStamp.begin(), hintStamp.end(), 0);
+				stamp = 1;
+			}
+			for (uint32_t v = 0; v < count; v++) {
+				localIndex[component.tiles[v]] = v;
+				forEachNeighbor(component.tiles[v], [&](size_t hint) {
+					if (tiles[hint] >= 0 && hintStamp[hint] != stamp) {
+						hintStamp[hint] = stamp;
+						hintTiles.push_back(hint);
+					}
+					});
+			}
+			for (size_t hint : hintTiles) {
+				Constraint constraint{ tiles[hint], 0, 0, {} };
+				forEachNeighbor(hint, [&](size_t tile) {
+					if (tiles[tile] == FLAGGED || tiles[tile] == MINE)
+						constraint.need--;
+					else if (tiles[tile] == CLOSED)
+						constraint.vars.push_back(localIndex[tile]);
+					});
+				constraint.open = (int)constraint.vars.size();
+				if (constraint.need < 0 || constraint.need > constraint.open)
+					return;
+				for (uint32_t v : constraint.vars)
+					varConstraints[v].push_back((uint32_t)constraints.size());
+				constraints.push_back(std::move(constraint));
+			}
+
+			std::vector<uint8_t> assignment(count, 0);
+			size_t nodes = 0;
+			bool exhausted = false;
+			auto consistent = [&](uint32_t v) {
+				for (uint32_t c : varConstraints[v]) {
+					const Constraint& constraint = constraints[c];
+					if (constraint.mines > constraint.need || constraint.mines + constraint.open < constraint.need)
+						return false;
+				}
+				return true;
+			};
+			auto assign = [&](uint32_t v, int mine) {
+				assignment[v] = (uint8_t)mine;
+				for (uint32_t c : varConstraints[v]) {
+					constraints[c].open--;
+					constraints[c].mines += mine;
+				}
+			};
+			auto unassign = [&](uint32_t v) {
+				for (uint32_t c : varConstraints[v]) {
+					constraints[c].open++;
+					constraints[c].mines -= assignment[v];
+				}
+			};
+			auto search = [&](auto& self, uint32_t v, size_t minesSoFar) -> void {
+				if (exhausted)
+					return;
+				if (++nodes > nodeBudget) {
+					exhausted = true;
+					return;
+				}
+				if (v == count) {
+					component.solutions[minesSoFar] += 1.0;
+					for (uint32_t i = 0; i < count; i++)
+						if (assignment[i])
+							component.hits[i * (count + 1) + minesSoFar] += 1.0;
+					return;
+				}
+				for (int mine = 0; mine <= 1; mine++) {
+					assign(v, mine);
+					if (consistent(v))
+						self(self, v + 1, minesSoFar + mine);
+					unassign(v);
+				}
+			};
+			search(search, 0, 0);
+			component.solved = !exhausted;
+		}
+
+		float resultRest = 0.0f;
+
+		static double logChoose(double n, double k) {
+			if (k < 0 || k > n)
+				return -INFINITY;
+			return std::lgamma(n + 1) - std::lgamma(k + 1) - std::lgamma(n - k + 1);
+		}
+
+		// Weighs every component's mine counts by the ways to place the remaining mines on the
+		// closed tiles off the frontier, forward over the components and backward over the rest
+		void combine(Stats& newStats) {
+			result.clear();
+			std::vector<const Component*> solved;
+			size_t frontierTiles = 0, degree = 0;
+			for (const Component& component : components) {
+				if (!component.alive)
+					continue;
+				newStats.components++;
+				if (!component.solved) {
+					newStats.unsolved++;
+					continue;
+				}
+				solved.push_back(&component);
+				frontierTiles += component.tiles.size();
+				degree += component.tiles.size();
+			}
+			newStats.frontierTiles = frontierTiles;
+
+			double restTiles = (double)closedCount - (double)frontierTiles;
+			double minesLeft = (double)mines - (double)flagCount - (double)openedMines;
+			//Mine count of the rest for t mines on the frontier, relative to the largest one
+			std::vector<double> weight(degree + 1);
+			double best = -INFINITY;
+			for (size_t t = 0; t <= degree; t++)
+				best = std::max(best, logChoose(restTiles, minesLeft - (double)t));
+			for (size_t t = 0; t <= degree; t++)
+				weight[t] = std::isfinite(best) ? std::exp(logChoose(restTiles, minesLeft - (double)t) - best) : 0.0;
+
+			size_t n = solved.size();
+			size_t stored = 0, before = 0;
+			for (const Component* component : solved) {
+				before += component->tiles.size();
+				stored += before + 1;
+			}
+			bool exact = stored <= exactBudget;
+
+			//backward[i](t): weight of the components after i and the rest, t mines before i + 1
+			std::vector<size_t> offset(n + 1, 0);
+			std::vector<double> backward;
+			if (exact) {
+				std::vector<size_t> prefix(n + 1, 0);
+				for (size_t i = 0; i < n; i++)
+					prefix[i + 1] = prefix[i] + solved[i]->tiles.size();
+				for (size_t i = 0; i < n; i++)
+					offset[i + 1] = offset[i] + prefix[i + 1] + 1;
+				backward.assign(offset[n], 0.0);
+				for (size_t i = n; i-- > 0;) {
+					double* out = &backward[offset[i]];
+					size_t range = prefix[i + 1];
+					if (i == n - 1) {
+						for (size_t t = 0; t <= range; t++)
+							out[t] = weight[t];
+					}
+					else {
+						const double* next = &backward[offset[i + 1]];
+						const Component& after = *solved[i + 1];
+						double scale = 0.0;
+						for (size_t t = 0; t <= range; t++) {
+							double sum = 0.0;
+							for (size_t k = 0; k < after.solutions.size(); k++)
+								sum += after.solutions[k] * next[t + k];
+							out[t] = sum;
+							scale = std::max(scale, sum);
+						}
+						if (scale > 0.0)
+							for (size_t t = 0; t <= range; t++)
+								out[t] /= scale;
+					}
+				}
+			}
+
+			double expectedFrontier = 0.0;
+			std::vector<double> forward{ 1.0 }, nextForward, share;
+			double density = restTiles + frontierTiles > 0 ? minesLeft / (restTiles + frontierTiles) : 0.0;
+			double ratio = density < 1.0 ? density / (1.0 - density) : 1.0;
+			for (size_t i = 0; i < n; i++) {
+				const Component& component = *solved[i];
+				size_t count = component.tiles.size();
+				share.assign(count + 1, 0.0);
+				for (size_t k = 0; k <= count; k++) {
+					if (exact) {
+						const double* after = &backward[offset[i]];
+						double sum = 0.0;
+						for (size_t j = 0; j < forward.size(); j++)
+							sum += forward[j] * after[j + k];
+						share[k] = sum;
+					}
+					else {
+						share[k] = std::pow(ratio, (double)k);
+					}
+				}
+				double total = 0.0, mean = 0.0;
+				for (size_t k = 0; k <= count; k++) {
+					total += component.solutions[k] * share[k];
+					mean += component.solutions[k] * share[k] * k;
+				}
+				if (total <= 0.0)
+					continue;
+				expectedFrontier += mean / total;
+				for (size_t v = 0; v < count; v++) {
+					double hit = 0.0;
+					for (size_t k = 0; k <= count; k++)
+						hit += component.hits[v * (count + 1) + k] * share[k];
+					result.push_back({ component.tiles[v], (float)(hit / total) });
+				}
+				if (exact) {
+					nextForward.assign(forward.size() + count, 0.0);
+					double scale = 0.0;
+					for (size_t j = 0; j < forward.size(); j++)
+						for (size_t k = 0; k <= count; k++)
+							nextForward[j + k] += forward[j] * component.solutions[k];
+					for (double value : nextForward)
+						scale = std::max(scale, value);
+					if (scale > 0.0)
+						for (double& value : nextForward)
+							value /= scale;
+					std::swap(forward, nextForward);
+				}
+			}
+			resultRest = restTiles > 0.0 ? (float)std::clamp((minesLeft - expectedFrontier) / restTiles, 0.0, 1.0) : 0.0f;
+		}
+
+		std::thread worker;
+	};
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "bit_scan.h"
+
+namespace Minesweeper {
+
+	enum class SamplingStrategy : uint8_t { Auto, Floyd, FisherYates, Complement };
+
+	// Draws count distinct tiles out of total, every subset equally likely. Floyd's algorithm
+	// needs only count random numbers and suits sparse boards, a partial Fisher-Yates over an
+	// index buffer suits medium densities and above half the board the safe tiles are drawn
+	// instead. The buffers are kept, so drawing again for the same board size doesn't allocate.
+	class MineSampler {
+	public:
+		// Auto picks by density, the others force one algorithm
+		void setStrategy(SamplingStrategy strategy) { this->strategy = strategy; }
+		SamplingStrategy getStrategy() const { return strategy; }
+
+		// The algorithm Auto uses for count out of total. The index buffer only pays off from about
+		// a fifth of the tiles and while it stays in cache, Floyd's bitmap is 64 times smaller.
+		static SamplingStrategy pick(size_t count, size_t total) {
+			if (count * 2 > total)
+				return SamplingStrategy::Complement;
+			if (count * 5 > total && total <= fisherYatesMaxTiles)
+				return SamplingStrategy::FisherYates;
+			return SamplingStrategy::Floyd;
+		}
+
+		// Calls emit(index) once for each chosen tile, count is clamped to total. Complement emits
+		// in ascending order, the others in random order.
+		template<typename Rng, typename Emit>
+		void sample(size_t count, size_t total, Rng& rng, Emit emit) {
+			count = std::min(count, total);
+			if (count == 0)
+				return;
+			SamplingStrategy use = strategy == SamplingStrategy::Auto ? pick(count, total) : strategy;
+			switch (use) {
+			case SamplingStrategy::FisherYates:
+				fisherYates(count, total, rng, emit);
+				break;
+			case SamplingStrategy::Complement:
+				complement(count, total, rng, emit);
+				break;
+			default:
+				floyd(count, total, rng, emit);
+				break;
+			}
+		}
+
+	private:
+		static constexpr size_t fisherYatesMaxTiles = size_t(1) << 20;
+
+		// For j in [total - count, total) take a random t <= j, or j itself if t was taken already
+		template<typename Rng, typename Emit>
+		void floyd(size_t count, size_t total, Rng& rng, Emit emit) {
+			chosen.clear();
+			chosen.reserve(count);
+			resizeTaken(total);
+			for (size_t j = total - count; j < total; j++) {
+				size_t t = std::uniform_int_distribution<size_t>{ 0, j }(rng);
+				if (isTaken(t))
+					t = j;
+				setTaken(t);
+				chosen.push_back(t);
+				emit(t);
+			}
+			//Only the taken bits are cleared, the bitmap stays zero between draws
+			for (size_t t : chosen)
+				resetTaken(t);
+		}
+
+		template<typename Rng, typename Emit>
+		void fisherYates(size_t count, size_t total, Rng& rng, Emit emit) {
+			indices.resize(total);
+			for (size_t i = 0; i < total; i++)
+				indices[i] = i;
+			for (size_t i = 0; i < count; i++) {
+				size_t pick = std::uniform_int_distribution<size_t>{ i, total - 1 }(rng);
+				std::swap(indices[i], indices[pick]);
+				emit(indices[i]);
+			}
+		}
+
+		// Draws the total - count safe tiles with Floyd and emits every other tile
+		template<typename Rng, typename Emit>
+		void complement(size_t count, size_t total, Rng& rng, Emit emit) {
+			size_t safe = total - count;
+			resizeTaken(total);
+			for (size_t j = total - safe; j < total; j++) {
+				size_t t = std::uniform_int_distribution<size_t>{ 0, j }(rng);
+				setTaken(isTaken(t) ? j : t);
+			}
+			for (size_t word = 0; word * 64 < total; word++) {
+				uint64_t free = ~taken[word];
+				if ((word + 1) * 64 > total)
+					free &= (uint64_t(1) << (total - word * 64)) - 1;
+				while (free) {
+					emit(word * 64 + (size_t)countTrailingZeros(free));
+					free &= free - 1;
+				}
+			}
+			//Every word was read anyway, clearing all of them is as cheap
+			std::fill(taken.begin(), taken.begin() + (total + 63) / 64, 0);
+		}
+
+		void resizeTaken(size_t total) {
+			if (taken.size() < (total + 63) / 64)
+				taken.resize((total + 63) / 64, 0);
+		}
+
+		bool isTaken(size_t i) const { return taken[i >> 6] >> (i & 63) & 1; }
+		void setTaken(size_t i) { taken[i >> 6] |= uint64_t(1) << (i & 63); }
+		void resetTaken(size_t i) { taken[i >> 6] &= ~(uint64_t(1) << (i & 63)); }
+
+		SamplingStrategy strategy = SamplingStrategy::Auto;
+		std::vector<uint64_t> taken;
+		std::vector<size_t> chosen;
+		std::vector<size_t> indices;
+	};
+}
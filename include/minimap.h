@@ -0,0 +1,233 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MINESWEEPER_MINIMAP_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace Minesweeper {
+
+	// Opened and flagged tiles of one minimap block, the rest of its tiles are closed
+	struct BlockSummary {
+		uint32_t opened = 0;
+		uint32_t flagged = 0;
+	};
+
+	struct MinimapRect {
+		size_t x = 0, y = 0, width = 0, height = 0;
+	};
+
+	// Downsampled RGBA image of the board, each pixel covers a block of tiles and is the mix of the
+	// closed, opened and flagged colors weighted by their counts in the block. Counts are updated
+	// per tile change and only the changed pixels are shaded again. Plain CPU code, no window needed.
+	class Minimap {
+	public:
+		struct Rgba { uint8_t r, g, b, a; };
+
+		Rgba closedColor{ 130, 130, 130, 255 };
+		Rgba openedColor{ 220, 220, 220, 255 };
+		Rgba flaggedColor{ 230, 41, 55, 255 };
+
+		// The image is at most maxWidth x maxHeight, blocks are square and as small as that allows
+		void resize(size_t rows, size_t cols, size_t maxWidth, size_t maxHeight) {
+			this->rows = rows;
+			this->cols = cols;
+			maxWidth = std::max<size_t>(maxWidth, 1);
+			maxHeight = std::max<size_t>(maxHeight, 1);
+			block = 1;
+			while ((cols + block - 1) / block > maxWidth || (rows + block - 1) / block > maxHeight)
+				block++;
+			width = (cols + block - 1) / block;
+			height = (rows + block - 1) / block;
+
+			tileCounts.resize(width * height);
+			for (size_t y = 0; y < height; y++) {
+				size_t blockRows = std::min(block, rows - y * block);
+				for (size_t x = 0; x < width; x++)
+					tileCounts[y * width + x] = (uint32_t)(blockRows * std::min(block, cols - x * block));
+			}
+			summaries.resize(width * height);
+			pixels.resize(width * height * 4);
+			staging.resize(width * height * 4);
+			//A rect left over from a larger image would be shaded past the new one
+			dirty = {};
+			clear();
+		}
+
+		// Every tile closed again
+		void clear() {
+			std::fill(summaries.begin(), summaries.end(), BlockSummary{});
+			markDirty(0, 0, width, height);
+			shadeRect(dirty);
+		}
+
+		// Counts every block from scratch, state(row, col) returns 0 closed, 1 opened or 2 flagged
+		template<typename State>
+		void rebuild(State state) {
+			std::fill(summaries.begin(), summaries.end(), BlockSummary{});
+			for (size_t row = 0; row < rows; row++) {
+				BlockSummary* line = &summaries[row / block * width];
+				for (size_t col = 0; col < cols; col++) {
+					int tileState = state(row, col);
+					if (tileState == 1)
+						line[col / block].opened++;
+					else if (tileState == 2)
+						line[col / block].flagged++;
+				}
+			}
+			markDirty(0, 0, width, height);
+			shadeRect(dirty);
+		}
+
+		// Tile indices are row * cols + col
+		void open(size_t index) { change(index, 1, 0); }
+		void close(size_t index) { change(index, -1, 0); }
+		void flag(size_t index) { change(index, 0, 1); }
+		void unflag(size_t index) { change(index, 0, -1); }
+
+		// Applies a change set with opened, closed, flagged and unflagged tile lists and a reset flag,
+		// then shades the changed pixels once
+		template<typename Changes>
+		void apply(const Changes& changes) {
+			if (changes.reset) {
+				std::fill(summaries.begin(), summaries.end(), BlockSummary{});
+				markDirty(0, 0, width, height);
+			}
+			for (size_t index : changes.opened)
+				open(index);
+			for (size_t index : changes.closed)
+				close(index);
+			for (size_t index : changes.flagged)
+				flag(index);
+			for (size_t index : changes.unflagged)
+				unflag(index);
+			shadeRect(dirty);
+		}
+
+		// Pixels changed since the last call copied row by row into one contiguous buffer, the layout
+		// UpdateTextureRec expects. Returns nullptr if nothing changed.
+		const uint8_t* takeDirty(MinimapRect& rect) {
+			if (dirty.width == 0)
+				return nullptr;
+			rect = dirty;
+			dirty = {};
+			for (size_t y = 0; y < rect.height; y++) {
+				const uint8_t* from = &pixels[((rect.y + y) * width + rect.x) * 4];
+				std::copy(from, from + rect.width * 4, &staging[y * rect.width * 4]);
+			}
+			return staging.data();
+		}
+
+		const uint8_t* getPixels() const { return pixels.data(); }
+		const BlockSummary& getSummary(size_t x, size_t y) const { return summaries[y * width + x]; }
+		size_t getWidth() const { return width; }
+		size_t getHeight() const { return height; }
+		size_t getBlockSize() const { return block; }
+
+		// Shades n pixels from their block summaries, four at a time with SSE2
+		static void shade(const BlockSummary* summary, const uint32_t* tiles, uint8_t* rgba, size_t n,
+			Rgba closed, Rgba opened, Rgba flagged) {
+			size_t i = 0;
+#ifdef MINESWEEPER_MINIMAP_SSE2
+			__m128 one = _mm_set1_ps(1.0f);
+			__m128 closedChannel[4], openedChannel[4], flaggedChannel[4];
+			const uint8_t* c = &closed.r;
+			const uint8_t* o = &opened.r;
+			const uint8_t* f = &flagged.r;
+			for (int ch = 0; ch < 4; ch++) {
+				closedChannel[ch] = _mm_set1_ps(c[ch]);
+				openedChannel[ch] = _mm_set1_ps(o[ch]);
+				flaggedChannel[ch] = _mm_set1_ps(f[ch]);
+			}
+			for (; i + 4 <= n; i += 4) {
+				//BlockSummary is two uint32, split four of them into opened and flagged lanes
+				__m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(summary + i));
+				__m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(summary + i + 2));
+				lo = _mm_shuffle_epi32(lo, _MM_SHUFFLE(3, 1, 2, 0));
+				hi = _mm_shuffle_epi32(hi, _MM_SHUFFLE(3, 1, 2, 0));
+				__m128i openedLanes = _mm_unpacklo_epi64(lo, hi);
+				__m128i flaggedLanes = _mm_unpackhi_epi64(lo, hi);
+				__m128 inverse = _mm_div_ps(one, _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(tiles + i))));
+				__m128 openedShare = _mm_mul_ps(_mm_cvtepi32_ps(openedLanes), inverse);
+				__m128 flaggedShare = _mm_mul_ps(_mm_cvtepi32_ps(flaggedLanes), inverse);
+				__m128 closedShare = _mm_sub_ps(_mm_sub_ps(one, openedShare), flaggedShare);
+
+				__m128i channel[4];
+				for (int ch = 0; ch < 4; ch++) {
+					__m128 value = _mm_add_ps(_mm_add_ps(_mm_mul_ps(closedShare, closedChannel[ch]),
+						_mm_mul_ps(openedShare, openedChannel[ch])), _mm_mul_ps(flaggedShare, flaggedChannel[ch]));
+					channel[ch] = _mm_cvtps_epi32(value);
+				}
+				//r0..r3 g0..g3 and b0..b3 a0..a3 to r0 g0 b0 a0 r1 ...
+				__m128i rg = _mm_packs_epi32(channel[0], channel[1]);
+				__m128i ba = _mm_packs_epi32(channel[2], channel[3]);
+				__m128i rb = _mm_unpacklo_epi16(rg, ba);
+				__m128i ga = _mm_unpackhi_epi16(rg, ba);
+				__m128i first = _mm_unpacklo_epi16(rb, ga);
+				__m128i second = _mm_unpackhi_epi16(rb, ga);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(rgba + i * 4), _mm_packus_epi16(first, second));
+			}
+#endif
+			for (; i < n; i++) {
+				float inverse = 1.0f / (float)tiles[i];
+				float openedShare = (float)summary[i].opened * inverse;
+				float flaggedShare = (float)summary[i].flagged * inverse;
+				float closedShare = 1.0f - openedShare - flaggedShare;
+				const uint8_t* c = &closed.r;
+				const uint8_t* o = &opened.r;
+				const uint8_t* f = &flagged.r;
+				for (int ch = 0; ch < 4; ch++) {
+					float value = closedShare * c[ch] + openedShare * o[ch] + flaggedShare * f[ch];
+					rgba[i * 4 + ch] = (uint8_t)std::clamp(std::lrint(value), 0l, 255l);
+				}
+			}
+		}
+
+	private:
+		void change(size_t index, int opened, int flagged) {
+			size_t x = index % cols / block;
+			size_t y = index / cols / block;
+			BlockSummary& summary = summaries[y * width + x];
+			summary.opened += opened;
+			summary.flagged += flagged;
+			markDirty(x, y, 1, 1);
+		}
+
+		void markDirty(size_t x, size_t y, size_t w, size_t h) {
+			if (w == 0 || h == 0)
+				return;
+			if (dirty.width == 0) {
+				dirty = { x, y, w, h };
+				return;
+			}
+			size_t right = std::max(dirty.x + dirty.width, x + w);
+			size_t bottom = std::max(dirty.y + dirty.height, y + h);
+			dirty.x = std::min(dirty.x, x);
+			dirty.y = std::min(dirty.y, y);
+			dirty.width = right - dirty.x;
+			dirty.height = bottom - dirty.y;
+		}
+
+		void shadeRect(const MinimapRect& rect) {
+			for (size_t y = rect.y; y < rect.y + rect.height; y++) {
+				size_t start = y * width + rect.x;
+				shade(&summaries[start], &tileCounts[start], &pixels[start * 4], rect.width, closedColor, openedColor, flaggedColor);
+			}
+		}
+
+		size_t rows = 0, cols = 0;
+		size_t block = 1;
+		size_t width = 0, height = 0;
+		std::vector<uint32_t> tileCounts;
+		std::vector<BlockSummary> summaries;
+		std::vector<uint8_t> pixels;
+		std::vector<uint8_t> staging;
+		MinimapRect dirty;
+	};
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <utility>
+
+namespace Minesweeper {
+
+	struct Offset {
+		int dRow;
+		int dCol;
+	};
+
+	// Classic 8-neighborhood, neighbors outside the board are dropped.
+	struct SquareTopology {
+		static constexpr std::array<Offset, 8> offsets{ { {-1,-1},{-1, 0},{-1,1},
+														  { 0,-1}        ,{ 0,1},
+														  { 1,-1},{ 1, 0},{ 1,1} } };
+
+		static constexpr bool isInterior(size_t row, size_t col, size_t rows, size_t cols) {
+			return row > 0 && col > 0 && row + 1 < rows && col + 1 < cols;
+		}
+
+		// row and col are at most one step outside the board, size_t(-1) included
+		static constexpr bool contains(size_t row, size_t col, size_t rows, size_t cols) {
+			return row < rows && col < cols;
+		}
+	};
+
+	template<typename Topology>
+	class Neighborhood {
+	public:
+		static constexpr size_t count = Topology::offsets.size();
+
+		template<typename Call>
+		static void forEach(size_t row, size_t col, size_t rows, size_t cols, Call&& call) {
+			if (Topology::isInterior(row, col, rows, cols))
+				forEachInterior(row, col, call);
+			else
+				forEachBorder(row, col, rows, cols, call);
+		}
+
+		// No bounds checks, the caller guarantees every neighbor lies on the board.
+		template<typename Call>
+		static void forEachInterior(size_t row, size_t col, Call&& call) {
+			unroll(row, col, call, std::make_index_sequence<count>{});
+		}
+
+		template<typename Call>
+		static void forEachBorder(size_t row, size_t col, size_t rows, size_t cols, Call&& call) {
+			for (const Offset& o : Topology::offsets) {
+				size_t newRow = row + o.dRow;
+				size_t newCol = col + o.dCol;
+				if (Topology::contains(newRow, newCol, rows, cols))
+					call(newRow, newCol);
+			}
+		}
+
+	private:
+		template<typename Call, size_t... I>
+		static void unroll(size_t row, size_t col, Call& call, std::index_sequence<I...>) {
+			(call(row + Topology::offsets[I].dRow, col + Topology::offsets[I].dCol), ...);
+		}
+	};
+}
@@ -0,0 +1,511 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace Minesweeper {
+
+	// Compresses one band of PNG scanlines into raw deflate blocks that end on a byte boundary
+	// and don't refer back to earlier bands. Bands can be compressed on any thread, written one
+	// after the other they form a single zlib stream. Matches are found LZ4 style with one hash
+	// table slot per 4 byte sequence and coded with the fixed Huffman codes, boards repeat the
+	// same few tiles so that is most of what dynamic codes would win.
+	class DeflateBand {
+	public:
+		void compress(const uint8_t* data, size_t size, std::vector<uint8_t>& out) {
+			out.clear();
+			bitBuffer = 0;
+			bitCount = 0;
+			head.assign(hashSize, -1);
+
+			//Fixed Huffman block, not the last one
+			putBits(0, 1);
+			putBits(1, 2);
+			size_t literalStart = 0;
+			size_t i = 0;
+			while (i + minMatch <= size) {
+				uint32_t sequence = read32(data + i);
+				uint32_t slot = (sequence * 2654435761u) >> (32 - hashBits);
+				int64_t candidate = head[slot];
+				head[slot] = (int64_t)i;
+				if (candidate < 0 || i - (size_t)candidate > maxDistance || read32(data + candidate) != sequence) {
+					i++;
+					continue;
+				}
+				size_t length = minMatch;
+				size_t limit = std::min(maxMatch, size - i);
+				while (length < limit && data[candidate + length] == data[i + length])
+					length++;
+				putLiterals(data, literalStart, i, out);
+				putMatch(length, i - (size_t)candidate, out);
+				i += length;
+				literalStart = i;
+			}
+			putLiterals(data, literalStart, size, out);
+			putCode(256, out);
+
+			//Empty stored block, ends the band on a byte boundary like a zlib sync flush
+			putBits(0, 1);
+			putBits(0, 2);
+			flushBits(out);
+			out.push_back(0x00);
+			out.push_back(0x00);
+			out.push_back(0xff);
+			out.push_back(0xff);
+		}
+
+		// Last block of the stream, empty
+		static void finish(std::vector<uint8_t>& out) {
+			out.push_back(0x03);
+			out.push_back(0x00);
+		}
+
+	private:
+		static constexpr size_t minMatch = 4, maxMatch = 258, maxDistance = 32768;
+		static constexpr int hashBits = 15;
+		static constexpr size_t hashSize = size_t(1) << hashBits;
+
+		struct Code {
+			uint16_t bits;
+			uint8_t length;
+		};
+
+		// Fixed literal and length codes, bit reversed since deflate sends Huffman codes from the top bit
+		struct Tables {
+			std::array<Code, 288> literal{};
+			std::array<Code, 30> distance{};
+
+			Tables() {
+				for (int symbol = 0; symbol < 288; symbol++) {
+					uint16_t code;
+					uint8_t length;
+					if (symbol < 144) { code = (uint16_t)(0x30 + symbol); length = 8; }
+					else if (symbol < 256) { code = (uint16_t)(0x190 + symbol - 144); length = 9; }
+					else if (symbol < 280) { code = (uint16_t)(symbol - 256); length = 7; }
+					else { code = (uint16_t)(0xc0 + symbol - 280); length = 8; }
+					literal[symbol] = { reverse(code, length), length };
+				}
+				for (int symbol = 0; symbol < 30; symbol++)
+					distance[symbol] = { reverse((uint16_t)symbol, 5), 5 };
+			}
+
+			static uint16_t reverse(uint16_t code, int length) {
+				uint16_t reversed = 0;
+				for (int i = 0; i < length; i++)
+					reversed |= (uint16_t)(((code >> i) & 1) << (length - 1 - i));
+				return reversed;
+			}
+		};
+
+		static const Tables& tables() {
+			static const Tables instance;
+			return instance;
+		}
+
+		static uint32_t read32(const uint8_t* p) {
+			uint32_t value;
+			std::memcpy(&value, p, 4);
+			return value;
+		}
+
+		void putBits(uint32_t bits, int count) {
+			bitBuffer |= (uint64_t)bits << bitCount;
+			bitCount += count;
+		}
+
+		void drain(std::vector<uint8_t>& out) {
+			while (bitCount >= 8) {
+				out.push_back((uint8_t)bitBuffer);
+				bitBuffer >>= 8;
+				bitCount -= 8;
+			}
+		}
+
+		void flushBits(std::vector<uint8_t>& out) {
+			drain(out);
+			if (bitCount > 0) {
+				out.push_back((uint8_t)bitBuffer);
+				bitBuffer = 0;
+				bitCount = 0;
+			}
+		}
+
+		void putCode(int symbol, std::vector<uint8_t>& out) {
+			const Code& code = tables().literal[symbol];
+			putBits(code.bits, code.length);
+			drain(out);
+		}
+
+		void putLiterals(const uint8_t* data, size_t from, size_t to, std::vector<uint8_t>& out) {
+			for (size_t i = from; i < to; i++)
+				putCode(data[i], out);
+		}
+
+		void putMatch(size_t length, size_t distance, std::vector<uint8_t>& out) {
+			static constexpr uint16_t lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+				35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+			static constexpr uint8_t lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+				3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+			static constexpr uint16_t distanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+				257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+
+			int lengthSymbol = 28;
+			while (lengthBase[lengthSymbol] > length)
+				lengthSymbol--;
+			putCode(257 + lengthSymbol, out);
+			putBits((uint32_t)(length - lengthBase[lengthSymbol]), lengthExtra[lengthSymbol]);
+
+			int distanceSymbol = 29;
+			while (distanceBase[distanceSymbol] > distance)
+				distanceSymbol--;
+			const Code& code = tables().distance[distanceSymbol];
+			putBits(code.bits, code.length);
+			//Distance codes 0-3 have no extra bits, then two codes per extra bit
+			int extra = distanceSymbol < 4 ? 0 : distanceSymbol / 2 - 1;
+			putBits((uint32_t)(distance - distanceBase[distanceSymbol]), extra);
+			drain(out);
+		}
+
+		uint64_t bitBuffer = 0;
+		int bitCount = 0;
+		std::vector<int64_t> head;
+	};
+
+	// Writes an 8 bit RGB PNG as its rows come in. Every band of rows is one IDAT chunk holding
+	// the band's deflate blocks, the zlib header goes in front of the first and the final block
+	// and the Adler-32 of all scanlines after the last.
+	class PngWriter {
+	public:
+		bool open(const std::string& path, uint32_t width, uint32_t height) {
+			file.open(path, std::ios::binary | std::ios::trunc);
+			if (!file)
+				return false;
+			static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+			file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+			chunk.clear();
+			putBigEndian(chunk, width);
+			putBigEndian(chunk, height);
+			chunk.push_back(8);		//Bits per channel
+			chunk.push_back(2);		//RGB
+			chunk.push_back(0);		//Deflate
+			chunk.push_back(0);		//Adaptive filters
+			chunk.push_back(0);		//Not interlaced
+			writeChunk("IHDR", chunk.data(), chunk.size());
+
+			adler = 1;
+			//zlib header: deflate with a 32K window, no dictionary, fastest level
+			static const uint8_t zlibHeader[2] = { 0x78, 0x01 };
+			writeChunk("IDAT", zlibHeader, sizeof(zlibHeader));
+			return (bool)file;
+		}
+
+		// A band compressed by DeflateBand, with the Adler-32 and size of the scanlines it compressed
+		void writeBand(const std::vector<uint8_t>& deflated, uint32_t bandAdler, size_t scanlineBytes) {
+			adler = combineAdler(adler, bandAdler, scanlineBytes);
+			writeChunk("IDAT", deflated.data(), deflated.size());
+		}
+
+		bool close() {
+			chunk.clear();
+			DeflateBand::finish(chunk);
+			putBigEndian(chunk, adler);
+			writeChunk("IDAT", chunk.data(), chunk.size());
+			writeChunk("IEND", nullptr, 0);
+			file.close();
+			return !file.fail();
+		}
+
+		static uint32_t adler32(const uint8_t* data, size_t size) {
+			uint32_t a = 1, b = 0;
+			while (size > 0) {
+				//The sums stay below 2^32 for 5552 bytes
+				size_t block = std::min<size_t>(size, 5552);
+				for (size_t i = 0; i < block; i++) {
+					a += data[i];
+					b += a;
+				}
+				a %= adlerBase;
+				b %= adlerBase;
+				data += block;
+				size -= block;
+			}
+			return b << 16 | a;
+		}
+
+	private:
+		static constexpr uint32_t adlerBase = 65521;
+
+		// Adler-32 of two pieces from the checksums of both, as zlib's adler32_combine
+		static uint32_t combineAdler(uint32_t first, uint32_t second, size_t secondLength) {
+			uint32_t remainder = (uint32_t)(secondLength % adlerBase);
+			uint32_t sum1 = first & 0xffff;
+			uint32_t sum2 = (uint32_t)(((uint64_t)remainder * sum1) % adlerBase);
+			sum1 += (second & 0xffff) + adlerBase - 1;
+			sum2 += ((first >> 16) & 0xffff) + ((second >> 16) & 0xffff) + adlerBase - remainder;
+			if (sum1 >= adlerBase) sum1 -= adlerBase;
+			if (sum1 >= adlerBase) sum1 -= adlerBase;
+			if (sum2 >= (adlerBase << 1)) sum2 -= (adlerBase << 1);
+			if (sum2 >= adlerBase) sum2 -= adlerBase;
+			return sum1 | (sum2 << 16);
+		}
+
+		static const std::array<uint32_t, 256>& crcTable() {
+			static const std::array<uint32_t, 256> table = [] {
+				std::array<uint32_t, 256> entries{};
+				for (uint32_t n = 0; n < 256; n++) {
+					uint32_t c = n;
+					for (int k = 0; k < 8; k++)
+						c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+					entries[n] = c;
+				}
+				return entries;
+			}();
+			return table;
+		}
+
+		static uint32_t crc(uint32_t c, const uint8_t* data, size_t size) {
+			const std::array<uint32_t, 256>& table = crcTable();
+			for (size_t i = 0; i < size; i++)
+				c = table[(c ^ data[i]) & 0xff] ^ (c >> 8);
+			return c;
+		}
+
+		static void putBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+			out.push_back((uint8_t)(value >> 24));
+			out.push_back((uint8_t)(value >> 16));
+			out.push_back((uint8_t)(value >> 8));
+			out.push_back((uint8_t)value);
+		}
+
+		void writeChunk(const char type[4], const uint8_t* data, size_t size) {
+			uint8_t length[4] = { (uint8_t)(size >> 24), (uint8_t)(size >> 16), (uint8_t)(size >> 8), (uint8_t)size };
+			file.write(reinterpret_cast<const char*>(length), 4);
+			file.write(type, 4);
+			if (size > 0)
+				file.write(reinterpret_cast<const char*>(data), size);
+			uint32_t c = crc(0xffffffffu, reinterpret_cast<const uint8_t*>(type), 4);
+			c = crc(c, data, size) ^ 0xffffffffu;
+			uint8_t sum[4] = { (uint8_t)(c >> 24), (uint8_t)(c >> 16), (uint8_t)(c >> 8), (uint8_t)c };
+			file.write(reinterpret_cast<const char*>(sum), 4);
+		}
+
+		std::ofstream file;
+		std::vector<uint8_t> chunk;
+		uint32_t adler = 1;
+	};
+
+	// Reads back the PNGs PngWriter writes, for the checks. Every chunk CRC, the zlib header and
+	// the Adler-32 are verified. Only what the writer produces is understood: 8 bit RGB, stored and
+	// fixed Huffman blocks and scanlines with filter type 0. Checksums and code tables are worked
+	// out from the specs rather than shared with the writer, so a mistake there doesn't cancel out.
+	class PngReader {
+	public:
+		bool read(const std::string& path) {
+			width = height = 0;
+			pixels.clear();
+			std::ifstream in(path, std::ios::binary);
+			if (!in)
+				return fail("can't open the file");
+			std::vector<uint8_t> file{ std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>() };
+			static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+			if (file.size() < 8 || !std::equal(signature, signature + 8, file.begin()))
+				return fail("no PNG signature");
+
+			std::vector<uint8_t> stream;
+			bool ended = false;
+			for (size_t at = 8; !ended; ) {
+				if (file.size() - at < 12)
+					return fail("truncated chunk");
+				uint32_t length = bigEndian(&file[at]);
+				if (file.size() - at - 12 < length)
+					return fail("truncated chunk");
+				const uint8_t* type = &file[at + 4];
+				const uint8_t* data = type + 4;
+				if (crc(type, 4 + (size_t)length) != bigEndian(data + length))
+					return fail("chunk CRC mismatch");
+				if (std::memcmp(type, "IHDR", 4) == 0) {
+					if (length != 13 || data[8] != 8 || data[9] != 2 || data[10] != 0 || data[11] != 0 || data[12] != 0)
+						return fail("not an 8 bit RGB PNG");
+					width = bigEndian(data);
+					height = bigEndian(data + 4);
+				}
+				else if (std::memcmp(type, "IDAT", 4) == 0)
+					stream.insert(stream.end(), data, data + length);
+				else if (std::memcmp(type, "IEND", 4) == 0)
+					ended = true;
+				at += 12 + (size_t)length;
+			}
+
+			if (stream.size() < 6 || (stream[0] & 0x0f) != 8 || (stream[0] << 8 | stream[1]) % 31 != 0 || (stream[1] & 0x20))
+				return fail("bad zlib header");
+			size_t scanlineBytes = 1 + (size_t)width * 3;
+			std::vector<uint8_t> scanlines;
+			scanlines.reserve(scanlineBytes * height);
+			if (!inflate(stream.data() + 2, stream.size() - 6, scanlines))
+				return false;
+			if (adler32(scanlines.data(), scanlines.size()) != bigEndian(&stream[stream.size() - 4]))
+				return fail("Adler-32 mismatch");
+			if (scanlines.size() != scanlineBytes * height)
+				return fail("wrong image size");
+			pixels.reserve((size_t)width * height * 3);
+			for (size_t y = 0; y < height; y++) {
+				const uint8_t* line = &scanlines[y * scanlineBytes];
+				if (line[0] != 0)
+					return fail("unknown filter type");
+				pixels.insert(pixels.end(), line + 1, line + scanlineBytes);
+			}
+			return true;
+		}
+
+		uint32_t getWidth() const { return width; }
+		uint32_t getHeight() const { return height; }
+		// RGB, row by row
+		const std::vector<uint8_t>& getPixels() const { return pixels; }
+		const std::string& getError() const { return error; }
+
+	private:
+		static uint32_t bigEndian(const uint8_t* p) {
+			return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+		}
+
+		static uint32_t crc(const uint8_t* data, size_t size) {
+			uint32_t c = 0xffffffffu;
+			for (size_t i = 0; i < size; i++) {
+				c ^= data[i];
+				for (int k = 0; k < 8; k++)
+					c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+			}
+			return c ^ 0xffffffffu;
+		}
+
+		static uint32_t adler32(const uint8_t* data, size_t size) {
+			uint32_t a = 1, b = 0;
+			for (size_t i = 0; i < size; i++) {
+				a = (a + data[i]) % 65521;
+				b = (b + a) % 65521;
+			}
+			return b << 16 | a;
+		}
+
+		bool fail(const char* what) {
+			error = what;
+			return false;
+		}
+
+		// Length and distance bases and extra bits as RFC 1951 lays them out
+		struct Tables {
+			uint16_t lengthBase[29], distanceBase[30];
+			uint8_t lengthExtra[29], distanceExtra[30];
+
+			Tables() {
+				uint16_t base = 3;
+				for (int i = 0; i < 28; i++) {
+					lengthExtra[i] = (uint8_t)(i < 8 ? 0 : i / 4 - 1);
+					lengthBase[i] = base;
+					base += (uint16_t)(1 << lengthExtra[i]);
+				}
+				lengthExtra[28] = 0;
+				lengthBase[28] = 258;
+				base = 1;
+				for (int i = 0; i < 30; i++) {
+					distanceExtra[i] = (uint8_t)(i < 2 ? 0 : i / 2 - 1);
+					distanceBase[i] = base;
+					base += (uint16_t)(1 << distanceExtra[i]);
+				}
+			}
+		};
+
+		bool inflate(const uint8_t* data, size_t size, std::vector<uint8_t>& out) {
+			static const Tables tables;
+			size_t bit = 0, end = size * 8;
+			bool overrun = false;
+			auto bits = [&](int count) {
+				uint32_t value = 0;
+				for (int i = 0; i < count; i++, bit++) {
+					if (bit >= end) {
+						overrun = true;
+						return value;
+					}
+					value |= (uint32_t)(data[bit / 8] >> (bit % 8) & 1) << i;
+				}
+				return value;
+			};
+			//Huffman codes come top bit first, read one bit at a time until a fixed code matches
+			auto literal = [&]() {
+				uint32_t code = 0;
+				for (int length = 1; length <= 9 && !overrun; length++) {
+					code = code << 1 | bits(1);
+					if (length == 7 && code <= 0x17)
+						return (int)(256 + code);
+					if (length == 8 && code >= 0x30 && code <= 0xbf)
+						return (int)(code - 0x30);
+					if (length == 8 && code >= 0xc0 && code <= 0xc7)
+						return (int)(280 + code - 0xc0);
+					if (length == 9 && code >= 0x190)
+						return (int)(144 + code - 0x190);
+				}
+				return -1;
+			};
+
+			bool last = false;
+			while (!last) {
+				last = bits(1);
+				uint32_t type = bits(2);
+				if (overrun)
+					return fail("truncated deflate stream");
+				if (type == 0) {
+					bit = (bit + 7) / 8 * 8;
+					if (end - bit < 32)
+						return fail("truncated stored block");
+					const uint8_t* header = data + bit / 8;
+					size_t length = header[0] | header[1] << 8;
+					if ((length ^ (header[2] | header[3] << 8)) != 0xffff)
+						return fail("stored block length mismatch");
+					bit += 32;
+					if ((end - bit) / 8 < length)
+						return fail("truncated stored block");
+					out.insert(out.end(), data + bit / 8, data + bit / 8 + length);
+					bit += length * 8;
+					continue;
+				}
+				if (type != 1)
+					return fail("not a fixed Huffman block");
+				while (true) {
+					int symbol = literal();
+					if (symbol < 0 || symbol > 285 || overrun)
+						return fail("bad literal code");
+					if (symbol < 256) {
+						out.push_back((uint8_t)symbol);
+						continue;
+					}
+					if (symbol == 256)
+						break;
+					size_t length = tables.lengthBase[symbol - 257] + bits(tables.lengthExtra[symbol - 257]);
+					int distanceSymbol = 0;
+					for (int i = 0; i < 5; i++)
+						distanceSymbol = distanceSymbol << 1 | (int)bits(1);
+					if (distanceSymbol >= 30)
+						return fail("bad distance code");
+					size_t distance = tables.distanceBase[distanceSymbol] + bits(tables.distanceExtra[distanceSymbol]);
+					if (overrun || distance > out.size())
+						return fail("distance before the start of the stream");
+					for (size_t i = 0; i < length; i++)
+						out.push_back(out[out.size() - distance]);
+				}
+			}
+			return true;
+		}
+
+		uint32_t width = 0, height = 0;
+		std::vector<uint8_t> pixels;
+		std::string error;
+	};
+}
@@ -0,0 +1,415 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Minesweeper {
+
+	// A won game as the records log stores it. Records have a fixed size, so a write torn by a
+	// crash is cut off by the file length alone and a damaged record is skipped by its checksum
+	// without losing the ones after it.
+	struct GameRecord {
+		static constexpr uint8_t customDifficulty = 0xff;
+
+		uint32_t rows = 0, cols = 0, mines = 0;
+		uint32_t seed = 0;
+		uint32_t millis = 0;		//Time to win
+		uint32_t bbbv = 0;
+		uint32_t clicks = 0;
+		uint32_t finishedAt = 0;	//Unix time in seconds
+		uint8_t difficulty = customDifficulty;
+		uint8_t unused[3] = {};
+		uint32_t checksum = 0;
+	};
+	static_assert(sizeof(GameRecord) == 40, "records are stored as they are in memory");
+
+	// Games compete with games of the same size and mine count
+	struct RecordConfig {
+		uint32_t rows, cols, mines;
+
+		bool operator==(const RecordConfig& other) const {
+			return rows == other.rows && cols == other.cols && mines == other.mines;
+		}
+	};
+
+	struct RecordConfigHash {
+		size_t operator()(const RecordConfig& config) const {
+			uint64_t key = (uint64_t)config.rows << 42 ^ (uint64_t)config.cols << 21 ^ config.mines;
+			return std::hash<uint64_t>{}(key);
+		}
+	};
+
+	// Local leaderboard: every win is appended to a log and the fastest topCount of each
+	// configuration are kept in memory. Next to the log a snapshot holds the kept lists as they
+	// were after a given number of log records, opening reads the lists from it as they are and
+	// only runs the records the log got since through the index. A game slower than the slowest
+	// one kept costs a hash lookup and a compare. Once most of the log is games that can never
+	// rank again it is rewritten with only the kept ones.
+	class RecordStore {
+	public:
+		static constexpr size_t topCount = 100;
+		//Compacting waits for this many records on top of twice the kept ones
+		static constexpr size_t compactSlack = 65536;
+		//The snapshot is written again once the log has this many records it doesn't cover
+		static constexpr size_t snapshotSlack = 4096;
+
+		~RecordStore() { close(); }
+
+		// Loads the log at path, a missing one is started. The snapshot is path + ".top".
+		bool open(const std::string& path) {
+			close();
+			this->path = path;
+			if (!load(loadSnapshot()))
+				return false;
+			if (shouldCompact())
+				return compact();
+			if (logRecords - snapshotRecords >= snapshotSlack)
+				writeSnapshot();
+			return openForAppend();
+		}
+
+		void close() {
+			file.close();
+			index.clear();
+			lastTop = nullptr;
+			logRecords = 0;
+			keptRecords = 0;
+			snapshotRecords = 0;
+		}
+
+		bool isOpen() const { return file.is_open(); }
+
+		// Appends a win, its rank in its configuration from 1 or 0 if it isn't among the best
+		size_t add(GameRecord record) {
+			if (!file.is_open())
+				return 0;
+			record.checksum = checksum(record);
+			file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+			file.flush();
+			if (!file)
+				std::cerr << "Records: failed to write " << path << std::endl;
+			logRecords++;
+			lastLogged = record;
+			size_t rank = insert(record);
+			if (shouldCompact())
+				compact();
+			else if (logRecords - snapshotRecords >= snapshotSlack)
+				writeSnapshot();
+			return rank;
+		}
+
+		// The fastest games of a configuration, best first, at most topCount
+		const std::vector<GameRecord>& best(const RecordConfig& config) const {
+			static const std::vector<GameRecord> none;
+			auto found = index.find(config);
+			return found == index.end() ? none : found->second;
+		}
+
+		// Records in the log, kept or not
+		size_t getLogRecords() const { return logRecords; }
+
+		// FNV-1a over the record's 32 bit words, cheap enough to check millions at startup, public for
+		// tools that write a log without a store
+		static uint32_t checksum(const GameRecord& record) {
+			uint32_t words[sizeof(GameRecord) / 4 - 1];
+			std::memcpy(words, &record, sizeof(words));
+			uint64_t hash = 14695981039346656037ull;
+			for (uint32_t word : words)
+				hash = (hash ^ word) * 1099511628211ull;
+			return (uint32_t)(hash ^ (hash >> 32));
+		}
+
+	private:
+		static constexpr char magic[4] = { 'M', 'S', 'R', 'L' };
+		static constexpr uint32_t version = 1;
+		static constexpr size_t headerSize = 8;
+
+		// Snapshot: magic, version, the number of log records it covers and the last of them as
+		// the log had it, the number of lists, then every list as rows, cols, mines, count and
+		// its records best first
+		static constexpr char snapshotMagic[4] = { 'M', 'S', 'R', 'T' };
+		static constexpr size_t snapshotHeaderSize = 8 + 8 + sizeof(GameRecord) + 8;
+		static constexpr size_t listHeaderSize = 16;
+
+		// Slots the record in after the ones with the same time, those were set first
+		size_t insert(const GameRecord& record) {
+			std::vector<GameRecord>& top = lastTop && lastConfig == RecordConfig{ record.rows, record.cols, record.mines }
+				? *lastTop : index[{ record.rows, record.cols, record.mines }];
+			lastConfig = { record.rows, record.cols, record.mines };
+			lastTop = &top;
+			if (top.size() == topCount && record.millis >= top.back().millis)
+				return 0;
+			if (top.capacity() == 0)
+				top.reserve(topCount);
+			auto position = std::upper_bound(top.begin(), top.end(), record,
+				[](const GameRecord& a, const GameRecord& b) { return a.millis < b.millis; });
+			size_t rank = (size_t)(position - top.begin()) + 1;
+			top.insert(position, record);
+			if (top.size() > topCount)
+				top.pop_back();
+			else
+				keptRecords++;
+			return rank;
+		}
+
+		bool shouldCompact() const {
+			return logRecords > 2 * keptRecords + compactSlack;
+		}
+
+		// Reads the records from first on into the index and cuts off a record torn by a crash. The
+		// snapshot read before covers the ones ahead of first, if the log doesn't end its part with
+		// the record the snapshot saw last the log was replaced and is read from the start.
+		bool load(size_t first) {
+			std::error_code error;
+			uint64_t size = std::filesystem::exists(path, error) ? std::filesystem::file_size(path, error) : 0;
+			if (error) {
+				std::cerr << "Records: can't read " << path << ", " << error.message() << std::endl;
+				return false;
+			}
+			if (size < headerSize) {
+				dropSnapshot();
+				return startLog();
+			}
+
+			size_t count = (size_t)((size - headerSize) / sizeof(GameRecord));
+			size_t damaged = 0;
+			bool read = mapFile(path, (size_t)size, [&](const uint8_t* data) {
+				uint32_t fileVersion;
+				std::memcpy(&fileVersion, data + 4, 4);
+				if (std::memcmp(data, magic, 4) != 0 || fileVersion != version)
+					return false;
+				if (first > count || (first > 0 && std::memcmp(data + headerSize + (first - 1) * sizeof(GameRecord), &lastLogged, sizeof(GameRecord)) != 0))
+					first = dropSnapshot();
+				for (size_t i = first; i < count; i++) {
+					GameRecord record;
+					std::memcpy(&record, data + headerSize + i * sizeof(GameRecord), sizeof(record));
+					if (record.checksum != checksum(record)) {
+						damaged++;
+						continue;
+					}
+					insert(record);
+				}
+				if (count > 0)
+					std::memcpy(&lastLogged, data + headerSize + (count - 1) * sizeof(GameRecord), sizeof(GameRecord));
+				return true;
+			});
+			if (!read) {
+				std::cerr << "Records: " << path << " is not a records log" << std::endl;
+				return false;
+			}
+			if (damaged > 0)
+				std::cerr << "Records: skipped " << damaged << " damaged records in " << path << std::endl;
+			logRecords = count;
+			snapshotRecords = first;
+
+			uint64_t complete = headerSize + (uint64_t)count * sizeof(GameRecord);
+			if (size != complete) {
+				std::filesystem::resize_file(path, complete, error);
+				if (error)
+					std::cerr << "Records: can't cut the torn end off " << path << std::endl;
+			}
+			return true;
+		}
+
+		// The kept lists of the snapshot, the number of log records it covers or 0 without one
+		size_t loadSnapshot() {
+			std::string name = path + ".top";
+			std::error_code error;
+			uint64_t size = std::filesystem::exists(name, error) ? std::filesystem::file_size(name, error) : 0;
+			if (error || size < snapshotHeaderSize)
+				return 0;
+			uint64_t covered = 0;
+			//A damaged record, a list that isn't sorted or one that holds another configuration's
+			//records drops the whole snapshot
+			bool read = mapFile(name, (size_t)size, [&](const uint8_t* data) {
+				uint32_t fileVersion;
+				uint64_t lists;
+				std::memcpy(&fileVersion, data + 4, 4);
+				std::memcpy(&covered, data + 8, 8);
+				std::memcpy(&lastLogged, data + 16, sizeof(GameRecord));
+				std::memcpy(&lists, data + 16 + sizeof(GameRecord), 8);
+				if (std::memcmp(data, snapshotMagic, 4) != 0 || fileVersion != version || covered == 0)
+					return false;
+				const uint8_t* in = data + snapshotHeaderSize;
+				const uint8_t* end = data + size;
+				for (uint64_t list = 0; list < lists; list++) {
+					uint32_t head[4];
+					if ((size_t)(end - in) < listHeaderSize)
+						return false;
+					std::memcpy(head, in, listHeaderSize);
+					in += listHeaderSize;
+					if (head[3] == 0 || head[3] > topCount || (size_t)(end - in) / sizeof(GameRecord) < head[3])
+						return false;
+					std::vector<GameRecord>& top = index[{ head[0], head[1], head[2] }];
+					if (!top.empty())
+						return false;
+					top.reserve(topCount);
+					top.resize(head[3]);
+					std::memcpy(top.data(), in, head[3] * sizeof(GameRecord));
+					in += head[3] * sizeof(GameRecord);
+					for (size_t i = 0; i < top.size(); i++) {
+						const GameRecord& record = top[i];
+						if (record.checksum != checksum(record) || record.rows != head[0] || record.cols != head[1] || record.mines != head[2]
+							|| (i > 0 && record.millis < top[i - 1].millis))
+							return false;
+					}
+					keptRecords += top.size();
+				}
+				return in == end;
+			});
+			if (!read) {
+				std::cerr << "Records: " << name << " doesn't fit, reading the whole log" << std::endl;
+				return dropSnapshot();
+			}
+			return (size_t)covered;
+		}
+
+		// Forgets what loadSnapshot read, the log is read from the start
+		size_t dropSnapshot() {
+			index.clear();
+			lastTop = nullptr;
+			keptRecords = 0;
+			return 0;
+		}
+
+		// The kept lists as they are now, covering every record of the log. Written next to the
+		// snapshot and renamed over it, a crash leaves either the old or the new one.
+		void writeSnapshot() {
+			if (logRecords == 0)
+				return;
+			std::string name = path + ".top";
+			std::string temporary = name + ".tmp";
+			std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+			uint64_t covered = logRecords, lists = index.size();
+			out.write(snapshotMagic, 4);
+			out.write(reinterpret_cast<const char*>(&version), 4);
+			out.write(reinterpret_cast<const char*>(&covered), 8);
+			out.write(reinterpret_cast<const char*>(&lastLogged), sizeof(GameRecord));
+			out.write(reinterpret_cast<const char*>(&lists), 8);
+			for (const auto& [config, top] : index) {
+				uint32_t head[4] = { config.rows, config.cols, config.mines, (uint32_t)top.size() };
+				out.write(reinterpret_cast<const char*>(head), listHeaderSize);
+				out.write(reinterpret_cast<const char*>(top.data()), (std::streamsize)(top.size() * sizeof(GameRecord)));
+			}
+			out.close();
+			std::error_code error;
+			if (out)
+				std::filesystem::rename(temporary, name, error);
+			if (!out || error) {
+				std::cerr << "Records: can't write " << name << std::endl;
+				std::filesystem::remove(temporary, error);
+				return;
+			}
+			snapshotRecords = logRecords;
+		}
+
+		// Runs read on the whole file, mapped where mmap is available
+		template<typename Read>
+		bool mapFile(const std::string& name, size_t size, Read read) {
+#ifndef _WIN32
+			int fd = ::open(name.c_str(), O_RDONLY);
+			if (fd < 0)
+				return false;
+			void* memory = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+			::close(fd);
+			if (memory == MAP_FAILED)
+				return false;
+			madvise(memory, size, MADV_SEQUENTIAL);
+			bool result = read(static_cast<const uint8_t*>(memory));
+			munmap(memory, size);
+			return result;
+#else
+			std::ifstream in(name, std::ios::binary);
+			std::vector<uint8_t> data(size);
+			if (!in.read(reinterpret_cast<char*>(data.data()), (std::streamsize)size))
+				return false;
+			return read(data.data());
+#endif
+		}
+
+		static void writeHeader(std::ofstream& out) {
+			out.write(magic, 4);
+			out.write(reinterpret_cast<const char*>(&version), 4);
+		}
+
+		bool startLog() {
+			std::ofstream out(path, std::ios::binary | std::ios::trunc);
+			writeHeader(out);
+			out.close();
+			if (!out) {
+				std::cerr << "Records: can't create " << path << std::endl;
+				return false;
+			}
+			return true;
+		}
+
+		bool openForAppend() {
+			file.open(path, std::ios::binary | std::ios::app);
+			if (!file) {
+				std::cerr << "Records: can't open " << path << std::endl;
+				return false;
+			}
+			return true;
+		}
+
+		// Rewrites the log with only the kept records, a crash leaves either the old or the new one
+		bool compact() {
+			file.close();
+			std::string temporary = path + ".tmp";
+			std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+			writeHeader(out);
+			GameRecord last = lastLogged;
+			for (const auto& [config, top] : index) {
+				out.write(reinterpret_cast<const char*>(top.data()), (std::streamsize)(top.size() * sizeof(GameRecord)));
+				if (!top.empty())
+					last = top.back();
+			}
+			out.close();
+			std::error_code error;
+			//The snapshot covers the old log, a crash before the new one is written reads the log
+			if (out) {
+				std::filesystem::remove(path + ".top", error);
+				snapshotRecords = 0;
+				std::filesystem::rename(temporary, path, error);
+			}
+			if (!out || error) {
+				std::cerr << "Records: can't compact " << path << std::endl;
+				std::filesystem::remove(temporary, error);
+			}
+			else {
+				logRecords = keptRecords;
+				lastLogged = last;
+				writeSnapshot();
+			}
+			return openForAppend();
+		}
+
+		std::string path;
+		std::ofstream file;
+		std::unordered_map<RecordConfig, std::vector<GameRecord>, RecordConfigHash> index;
+		//Wins come in runs of one configuration, the log mostly hits the same list as the record before
+		std::vector<GameRecord>* lastTop = nullptr;
+		RecordConfig lastConfig{};
+		size_t logRecords = 0;
+		size_t keptRecords = 0;
+		//Log records the snapshot covers and the last record of the log, as it is in the file
+		size_t snapshotRecords = 0;
+		GameRecord lastLogged{};
+	};
+}
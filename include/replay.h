@@ -0,0 +1,502 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace Minesweeper {
+
+	// Replay file: the magic, a header and then records that are only ever appended. Every record is
+	// a type byte, the payload length as a varint, the payload and a FNV-1a checksum of type and
+	// payload. Records are flushed as they are written, a replay cut short by a crash ends at its
+	// last complete record. Keyframes hold the tiles changed since the keyframe before, so a reader
+	// can restore one and replay at most keyframeInterval moves instead of the whole game. Once a
+	// sixteenth of the board changed since the last one, a full keyframe holds every tile as runs.
+	enum class ReplayRecord : uint8_t {
+		Mines = 1,		//Mine layout the moves are played on, written with the first move after it made room
+		Move,			//row, col, move type with the batch bit, milliseconds since the start
+		Reveal,			//Tiles one cascade slice opened
+		Continue,		//Lost game continued
+		Keyframe,		//Moves so far, game state, runs of all tile states or the changed tiles
+		Undo,			//The last batch of moves and its cascade slices were taken back
+	};
+
+	struct ReplayHeader {
+		uint64_t rows = 0, cols = 0, mines = 0;
+		uint32_t seed = 0;
+		uint32_t keyframeInterval = 256;
+		//Cascades opened at once, otherwise in slices that follow as Reveal records
+		bool instantReveal = false;
+	};
+
+	struct ReplayEvent {
+		ReplayRecord type;
+		uint8_t moveType = 0;
+		//Applied in one batch together with the move before
+		bool batched = false;
+		uint64_t row = 0, col = 0;
+		uint32_t millis = 0;
+	};
+
+	struct ReplayKeyframe {
+		uint64_t position;		//Moves applied before it
+		uint64_t event;			//Index of the first event after it
+		uint8_t gameState;
+		//Holds every tile, the others only the tiles changed since the keyframe before
+		bool full;
+		//An undo came before the next move, it takes back a move from before the keyframe that a
+		//game restored from it can't undo. Its changes still count for the keyframes after it.
+		bool restorable = true;
+		uint64_t offset, length;
+	};
+
+	// Tile states as stored in keyframes
+	enum class ReplayTile : uint8_t { Closed, Opened, Flagged };
+
+	namespace replay_detail {
+		inline const char magic[4] = { 'M', 'S', 'R', 'P' };
+		constexpr uint8_t version = 4;
+		//Version 3 only lacks Undo records
+		constexpr uint8_t oldestVersion = 3;
+
+		inline void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+			while (value >= 0x80) {
+				out.push_back((uint8_t)(value | 0x80));
+				value >>= 7;
+			}
+			out.push_back((uint8_t)value);
+		}
+
+		inline bool getVarint(const uint8_t*& in, const uint8_t* end, uint64_t& value) {
+			value = 0;
+			for (int shift = 0; in < end && shift < 64; shift += 7) {
+				uint8_t byte = *in++;
+				value |= uint64_t(byte & 0x7f) << shift;
+				if (!(byte & 0x80))
+					return true;
+			}
+			return false;
+		}
+
+		inline uint32_t checksum(uint8_t type, const uint8_t* data, size_t size) {
+			uint32_t hash = 2166136261u;
+			hash = (hash ^ type) * 16777619u;
+			for (size_t i = 0; i < size; i++)
+				hash = (hash ^ data[i]) * 16777619u;
+			return hash;
+		}
+	}
+
+	class ReplayWriter {
+	public:
+		// Starts a new file, false if it can't be created
+		bool open(const std::string& path, const ReplayHeader& header) {
+			close();
+			file.open(path, std::ios::binary | std::ios::trunc);
+			if (!file)
+				return false;
+			this->path = path;
+			interval = std::max<uint32_t>(header.keyframeInterval, 1);
+			moves = 0;
+			movesSinceKeyframe = 0;
+			//More changed tiles than this and the keyframe is a full one, so the list never grows
+			maxChanged = (size_t)(header.rows * header.cols / 16);
+			changed.clear();
+			changed.reserve(maxChanged);
+			changedAll = false;
+
+			using namespace replay_detail;
+			//A keyframe takes at most a byte per tile, reserved here so recording doesn't allocate
+			payload.clear();
+			payload.reserve((size_t)(header.rows * header.cols) + 32);
+			frame.reserve(16);
+			payload.insert(payload.end(), magic, magic + 4);
+			payload.push_back(version);
+			putVarint(payload, header.rows);
+			putVarint(payload, header.cols);
+			putVarint(payload, header.mines);
+			putVarint(payload, header.seed);
+			putVarint(payload, interval);
+			payload.push_back(header.instantReveal ? 1 : 0);
+			file.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+			file.flush();
+			return (bool)file;
+		}
+
+		void close() {
+			if (file.is_open())
+				file.close();
+			path.clear();
+		}
+
+		// Closes the file but keeps the position, resume appends to it again
+		void suspend() {
+			if (file.is_open())
+				file.close();
+		}
+
+		// Tiles changed while suspended weren't seen, the next keyframe is a full one
+		void resume() {
+			if (!path.empty() && !file.is_open()) {
+				file.open(path, std::ios::binary | std::ios::app);
+				changedAll = true;
+			}
+		}
+
+		bool isOpen() const { return file.is_open(); }
+
+		template<typename Mines>
+		void mines(const Mines& indices) {
+			payload.clear();
+			uint64_t previous = 0;
+			for (uint64_t index : indices) {
+				replay_detail::putVarint(payload, index - previous);
+				previous = index;
+			}
+			writeRecord(ReplayRecord::Mines);
+		}
+
+		void move(uint64_t row, uint64_t col, uint8_t type, bool batched, uint32_t millis) {
+			payload.clear();
+			replay_detail::putVarint(payload, row);
+			replay_detail::putVarint(payload, col);
+			payload.push_back((uint8_t)(type | (batched ? 0x80 : 0)));
+			replay_detail::putVarint(payload, millis);
+			writeRecord(ReplayRecord::Move);
+			moves++;
+			movesSinceKeyframe++;
+		}
+
+		void reveal(uint64_t tiles) {
+			payload.clear();
+			replay_detail::putVarint(payload, tiles);
+			writeRecord(ReplayRecord::Reveal);
+		}
+
+		void continued() {
+			payload.clear();
+			writeRecord(ReplayRecord::Continue);
+		}
+
+		void undo() {
+			payload.clear();
+			writeRecord(ReplayRecord::Undo);
+		}
+
+		// A tile's state changed, it goes into the next keyframe
+		void touched(uint64_t index) {
+			if (changedAll || !isOpen())
+				return;
+			if (changed.size() < maxChanged)
+				changed.push_back(index);
+			else
+				changedAll = true;
+		}
+
+		bool keyframeDue() const {
+			return isOpen() && movesSinceKeyframe >= interval;
+		}
+
+		// stateOf(index) returns the ReplayTile of each of the count tiles. Only the touched tiles
+		// are asked for unless so many changed that all of them are written.
+		template<typename StateOf>
+		void keyframe(uint8_t gameState, size_t count, StateOf stateOf) {
+			using replay_detail::putVarint;
+			payload.clear();
+			putVarint(payload, moves);
+			payload.push_back(gameState);
+			payload.push_back(changedAll ? 1 : 0);
+			if (changedAll) {
+				size_t start = 0;
+				while (start < count) {
+					ReplayTile tile = stateOf(start);
+					size_t end = start + 1;
+					while (end < count && stateOf(end) == tile)
+						end++;
+					putVarint(payload, uint64_t(end - start) << 2 | (uint64_t)tile);
+					start = end;
+				}
+			}
+			else {
+				//Distance to the changed tile before and its state, a tile changed twice is written once
+				std::sort(changed.begin(), changed.end());
+				changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+				uint64_t previous = 0;
+				for (uint64_t index : changed) {
+					putVarint(payload, (index - previous) << 2 | (uint64_t)stateOf((size_t)index));
+					previous = index;
+				}
+			}
+			writeRecord(ReplayRecord::Keyframe);
+			movesSinceKeyframe = 0;
+			changed.clear();
+			changedAll = false;
+		}
+
+		uint64_t getMoveCount() const { return moves; }
+
+	private:
+		void writeRecord(ReplayRecord type) {
+			if (!file.is_open())
+				return;
+			frame.clear();
+			frame.push_back((uint8_t)type);
+			replay_detail::putVarint(frame, payload.size());
+			uint32_t sum = replay_detail::checksum((uint8_t)type, payload.data(), payload.size());
+			file.write(reinterpret_cast<const char*>(frame.data()), frame.size());
+			file.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+			uint8_t sumBytes[4] = { (uint8_t)sum, (uint8_t)(sum >> 8), (uint8_t)(sum >> 16), (uint8_t)(sum >> 24) };
+			file.write(reinterpret_cast<const char*>(sumBytes), 4);
+			file.flush();
+		}
+
+		std::ofstream file;
+		std::string path;
+		uint32_t interval = 256;
+		uint64_t moves = 0, movesSinceKeyframe = 0;
+		std::vector<uint8_t> payload, frame;
+		std::vector<uint64_t> changed;
+		size_t maxChanged = 0;
+		bool changedAll = false;
+	};
+
+	// Reads every record once on open and keeps the events and the keyframe offsets. Keyframe
+	// tiles are only read when one is restored, from the last full keyframe on.
+	class ReplayReader {
+	public:
+		bool open(const std::string& path) {
+			events.clear();
+			moveEvents.clear();
+			keyframes.clear();
+			layout.clear();
+			truncated = false;
+			file.close();
+			file.clear();
+			file.open(path, std::ios::binary);
+			if (!file)
+				return false;
+
+			using namespace replay_detail;
+			std::vector<uint8_t> head(64);
+			file.read(reinterpret_cast<char*>(head.data()), head.size());
+			const uint8_t* in = head.data();
+			const uint8_t* end = in + file.gcount();
+			if (end - in < 5 || !std::equal(magic, magic + 4, in) || in[4] < oldestVersion || in[4] > version) {
+				std::cerr << "Not a replay file: " << path << std::endl;
+				return false;
+			}
+			in += 5;
+			uint64_t seed = 0, interval = 0;
+			if (!getVarint(in, end, header.rows) || !getVarint(in, end, header.cols) || !getVarint(in, end, header.mines)
+				|| !getVarint(in, end, seed) || !getVarint(in, end, interval) || in >= end) {
+				std::cerr << "Damaged replay header: " << path << std::endl;
+				return false;
+			}
+			header.seed = (uint32_t)seed;
+			header.keyframeInterval = (uint32_t)interval;
+			header.instantReveal = *in++ != 0;
+
+			uint64_t offset = in - head.data();
+			file.clear();
+			file.seekg((std::streamoff)offset);
+			std::vector<uint8_t> payload;
+			while (true) {
+				uint8_t prefix[10];
+				size_t prefixSize = 0;
+				if (!file.read(reinterpret_cast<char*>(prefix), 1))
+					break;
+				uint64_t length = 0;
+				const uint8_t* cursor = prefix + 1;
+				for (prefixSize = 1; prefixSize < sizeof(prefix); prefixSize++) {
+					if (!file.read(reinterpret_cast<char*>(prefix + prefixSize), 1))
+						break;
+					if (!(prefix[prefixSize] & 0x80)) {
+						prefixSize++;
+						break;
+					}
+				}
+				if (!getVarint(cursor, prefix + prefixSize, length)) {
+					truncated = true;
+					break;
+				}
+				payload.resize((size_t)length + 4);
+				if (!file.read(reinterpret_cast<char*>(payload.data()), payload.size())) {
+					truncated = true;
+					break;
+				}
+				const uint8_t* sumBytes = payload.data() + length;
+				uint32_t sum = sumBytes[0] | sumBytes[1] << 8 | sumBytes[2] << 16 | (uint32_t)sumBytes[3] << 24;
+				if (sum != checksum(prefix[0], payload.data(), (size_t)length)) {
+					truncated = true;
+					break;
+				}
+				if (!addRecord((ReplayRecord)prefix[0], payload.data(), payload.data() + length, offset + prefixSize)) {
+					truncated = true;
+					break;
+				}
+				offset += prefixSize + length + 4;
+			}
+			file.clear();
+			return true;
+		}
+
+		const ReplayHeader& getHeader() const { return header; }
+		const std::vector<ReplayEvent>& getEvents() const { return events; }
+		// Mines of the Mines record, empty if the first move was never made
+		const std::vector<uint64_t>& getMines() const { return layout; }
+		// The file ended inside a record or a record was damaged, everything before it is kept
+		bool isTruncated() const { return truncated; }
+
+		uint64_t getMoveCount() const { return moveEvents.size(); }
+
+		// Index of the event of move position, the end of the events after the last move
+		uint64_t eventOfMove(uint64_t position) const {
+			return position < moveEvents.size() ? moveEvents[position] : events.size();
+		}
+
+		// Move position was applied in one batch with the move before it
+		bool continuesBatch(uint64_t position) const {
+			return position < moveEvents.size() && events[moveEvents[position]].batched;
+		}
+
+		// The last keyframe at or before position a game can be restored from, nullptr if there is none
+		const ReplayKeyframe* keyframeAtOrBefore(uint64_t position) const {
+			auto after = std::upper_bound(keyframes.begin(), keyframes.end(), position,
+				[](uint64_t p, const ReplayKeyframe& keyframe) { return p < keyframe.position; });
+			while (after != keyframes.begin() && !(after - 1)->restorable)
+				after--;
+			if (after == keyframes.begin())
+				return nullptr;
+			return &*(after - 1);
+		}
+
+		// Calls set(index, ReplayTile) for every tile that isn't closed. The changes of the keyframes
+		// since the last full one are put together in a plane of tile states first.
+		template<typename Set>
+		bool loadKeyframe(const ReplayKeyframe& keyframe, Set set) {
+			size_t last = &keyframe - keyframes.data();
+			size_t first = last;
+			while (first > 0 && !keyframes[first].full)
+				first--;
+			size_t count = (size_t)(header.rows * header.cols);
+			tiles.assign(count, ReplayTile::Closed);
+			//Without a full keyframe before it the first one changed a board that was all closed
+			for (size_t k = first; k <= last; k++) {
+				if (!applyKeyframe(keyframes[k], count))
+					return false;
+			}
+			for (size_t index = 0; index < count; index++) {
+				if (tiles[index] != ReplayTile::Closed)
+					set(index, tiles[index]);
+			}
+			return true;
+		}
+
+	private:
+		bool applyKeyframe(const ReplayKeyframe& keyframe, size_t count) {
+			using replay_detail::getVarint;
+			keyframeBytes.resize((size_t)keyframe.length);
+			file.clear();
+			file.seekg((std::streamoff)keyframe.offset);
+			if (!file.read(reinterpret_cast<char*>(keyframeBytes.data()), keyframeBytes.size()))
+				return false;
+			const uint8_t* in = keyframeBytes.data();
+			const uint8_t* end = in + keyframeBytes.size();
+			uint64_t moves = 0, entry = 0, index = 0;
+			if (!getVarint(in, end, moves) || end - in < 2)
+				return false;
+			in += 2;
+			while (in < end) {
+				if (!getVarint(in, end, entry))
+					return false;
+				ReplayTile tile = (ReplayTile)(entry & 3);
+				if (keyframe.full) {
+					if (index + (entry >> 2) > count)
+						return false;
+					std::fill(tiles.begin() + index, tiles.begin() + index + (entry >> 2), tile);
+					index += entry >> 2;
+					continue;
+				}
+				index += entry >> 2;
+				if (index >= count)
+					return false;
+				tiles[index] = tile;
+			}
+			return true;
+		}
+
+		bool addRecord(ReplayRecord type, const uint8_t* in, const uint8_t* end, uint64_t offset) {
+			using replay_detail::getVarint;
+			const uint8_t* begin = in;
+			ReplayEvent event{ type };
+			switch (type) {
+			case ReplayRecord::Mines: {
+				layout.clear();
+				uint64_t index = 0, delta = 0;
+				while (in < end) {
+					if (!getVarint(in, end, delta))
+						return false;
+					index += delta;
+					layout.push_back(index);
+				}
+				return true;
+			}
+			case ReplayRecord::Move: {
+				uint64_t millis = 0;
+				if (!getVarint(in, end, event.row) || !getVarint(in, end, event.col) || in >= end)
+					return false;
+				event.moveType = *in & 0x7f;
+				event.batched = (*in & 0x80) != 0;
+				in++;
+				if (!getVarint(in, end, millis))
+					return false;
+				event.millis = (uint32_t)millis;
+				moveEvents.push_back(events.size());
+				break;
+			}
+			case ReplayRecord::Reveal:
+				if (!getVarint(in, end, event.row))
+					return false;
+				break;
+			case ReplayRecord::Continue:
+				break;
+			case ReplayRecord::Undo:
+				//A batch that changed nothing wrote the keyframe between the move and its undo
+				if (!keyframes.empty() && keyframes.back().position == moveEvents.size())
+					keyframes.back().restorable = false;
+				break;
+			case ReplayRecord::Keyframe: {
+				ReplayKeyframe keyframe{};
+				if (!getVarint(in, end, keyframe.position) || end - in < 2)
+					return false;
+				keyframe.gameState = in[0];
+				keyframe.full = in[1] != 0;
+				keyframe.event = events.size();
+				keyframe.offset = offset;
+				keyframe.length = (uint64_t)(end - begin);
+				keyframes.push_back(keyframe);
+				return true;
+			}
+			default:
+				//Records of newer versions are skipped
+				return true;
+			}
+			events.push_back(event);
+			return true;
+		}
+
+		std::ifstream file;
+		ReplayHeader header;
+		std::vector<ReplayEvent> events;
+		std::vector<uint64_t> moveEvents;
+		std::vector<ReplayKeyframe> keyframes;
+		std::vector<uint64_t> layout;
+		std::vector<uint8_t> keyframeBytes;
+		std::vector<ReplayTile> tiles;
+		bool truncated = false;
+	};
+}
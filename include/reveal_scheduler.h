@@ -0,0 +1,119 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace Minesweeper {
+
+	// Cascades opened in slices straight from the spans of their zero regions, so a huge region
+	// opens over several frames instead of stalling one and no neighbor is ever looked at. Regions
+	// are opened one after the other in the order they were started, the tiles of a region by
+	// index. A region that was patched has several sorted spans, they are merged, so it opens in the
+	// same order as the region labeled from scratch. Spans have to stay put while a cascade runs.
+	class RevealScheduler {
+	public:
+		RevealScheduler() {
+			pending.reserve(64);
+			cursors.reserve(64);
+		}
+
+		// Forgets every pending cascade
+		void clear() {
+			pending.clear();
+			cursors.clear();
+			head = 0;
+			loaded = false;
+		}
+
+		// Queues the region of an opened zero tile, a region that is queued already stays where it is
+		void start(uint64_t region) {
+			if (!isPending(region))
+				pending.push_back(region);
+		}
+
+		// Every closed tile of a pending region is about to be opened
+		bool isPending(uint64_t region) const {
+			return std::find(pending.begin() + head, pending.end(), region) != pending.end();
+		}
+
+		bool empty() const {
+			return head == pending.size();
+		}
+
+		// open(index) opens the tile if it is still closed and returns true if it did. Stops after
+		// visitBudget span entries, after openBudget opened tiles or as soon as shouldStop(), which is
+		// asked after every entry. Returns the number of tiles opened.
+		template<typename Regions, typename Open, typename ShouldStop>
+		size_t run(const Regions& regions, size_t visitBudget, size_t openBudget, Open open, ShouldStop shouldStop) {
+			size_t visited = 0, opened = 0;
+			uint64_t index;
+			while (visited < visitBudget && opened < openBudget && peek(regions, index)) {
+				cursors[nextCursor].first++;
+				visited++;
+				if (open((size_t)index))
+					opened++;
+				if (shouldStop())
+					break;
+			}
+			return opened;
+		}
+
+		// Moves past the entries isClosed(index) says are not closed any more, so the scheduler runs
+		// empty as soon as every tile of the pending regions is open
+		template<typename Regions, typename IsClosed>
+		void skipOpened(const Regions& regions, IsClosed isClosed) {
+			uint64_t index;
+			while (peek(regions, index) && !isClosed((size_t)index))
+				cursors[nextCursor].first++;
+		}
+
+	private:
+		// Lowest unvisited tile of the current region, the next region is loaded when one runs out
+		template<typename Regions>
+		bool peek(const Regions& regions, uint64_t& index) {
+			while (!empty()) {
+				if (!loaded)
+					load(regions, pending[head]);
+				for (size_t k = 0; k < cursors.size();) {
+					if (cursors[k].first == cursors[k].second) {
+						cursors[k] = cursors.back();
+						cursors.pop_back();
+						continue;
+					}
+					if (k == 0 || *cursors[k].first < index) {
+						index = *cursors[k].first;
+						nextCursor = k;
+					}
+					k++;
+				}
+				if (!cursors.empty())
+					return true;
+				head++;
+				loaded = false;
+			}
+			clear();
+			return false;
+		}
+
+		template<typename Regions>
+		void load(const Regions& regions, uint64_t region) {
+			cursors.clear();
+			typename Regions::Span span;
+			for (size_t k = 0; regions.span(region, k, span); k++) {
+				if (span.size() > 0)
+					cursors.push_back({ span.begin(), span.end() });
+			}
+			loaded = true;
+		}
+
+		std::vector<uint64_t> pending;
+		size_t head = 0;
+		//Unvisited rest of every span of the region at pending[head]
+		std::vector<std::pair<const uint64_t*, const uint64_t*>> cursors;
+		size_t nextCursor = 0;
+		bool loaded = false;
+	};
+}
@@ -0,0 +1,264 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Minesweeper {
+
+	// A move a bot asks for, type is a MoveType
+	struct SharedMove {
+		uint32_t row, col;
+		uint8_t type;
+		uint8_t unused[7];
+	};
+
+	// Start of the segment. The counters are written under the seqlock together with the tiles,
+	// the ring positions belong to one side each and sit on their own cache lines.
+	struct SharedBoardHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint64_t rows, cols;
+		uint32_t moveCapacity;
+		//Set once the game replaced the segment with one of another size
+		std::atomic<uint32_t> retired;
+
+		alignas(64) std::atomic<uint64_t> sequence;
+		std::atomic<uint64_t> gameState;
+		std::atomic<uint64_t> bombsLeft, bombTotal;
+		std::atomic<uint64_t> clicks;
+		//Moves taken from the ring and applied, a bot waits for its own to see their result
+		std::atomic<uint64_t> movesApplied;
+
+		alignas(64) std::atomic<uint64_t> moveHead;	//Written by the bot
+		alignas(64) std::atomic<uint64_t> moveTail;	//Written by the game
+	};
+
+	// The visible board and its counters in POSIX shared memory, for bots in other processes. A
+	// tile is one byte: the render state as a TileState in the high nibble and the hint in the low
+	// one, the hint is only set on open tiles. The game writes under a seqlock, the sequence is odd
+	// while it writes. A bot reads the tiles in place and keeps what it read if the sequence was
+	// the same even number before and after. Moves go the other way through a single producer,
+	// single consumer ring in the same segment.
+	class SharedBoard {
+	public:
+		static constexpr uint32_t magic = 0x4253534d;
+		static constexpr uint32_t version = 1;
+		static constexpr uint32_t moveCapacity = 1024;
+
+		static_assert(std::atomic<uint64_t>::is_always_lock_free, "the segment needs lock free atomics");
+		static_assert((moveCapacity & (moveCapacity - 1)) == 0, "the ring wraps with a mask");
+
+		SharedBoard() = default;
+		~SharedBoard() { close(); }
+		SharedBoard(const SharedBoard&) = delete;
+		SharedBoard& operator=(const SharedBoard&) = delete;
+
+		// The game's side, a segment of the same name is retired and replaced
+		bool create(const std::string& name, size_t rows, size_t cols) {
+			close();
+#ifndef _WIN32
+			retire(name);
+			size_t size = tilesOffset() + rows * cols;
+			int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+			if (fd < 0 || ftruncate(fd, (off_t)size) != 0) {
+				std::cerr << "Shared board: can't create " << name << ", " << std::strerror(errno) << std::endl;
+				if (fd >= 0) {
+					::close(fd);
+					shm_unlink(name.c_str());
+				}
+				return false;
+			}
+			if (!map(fd, size))
+				return false;
+			//ftruncate zeroed the segment, the atomics start out as zero
+			header->rows = rows;
+			header->cols = cols;
+			header->moveCapacity = moveCapacity;
+			header->version = version;
+			std::atomic_thread_fence(std::memory_order_release);
+			header->magic = magic;
+			this->name = name;
+			owner = true;
+			return true;
+#else
+			(void)name; (void)rows; (void)cols;
+			std::cerr << "Shared board needs POSIX shared memory" << std::endl;
+			return false;
+#endif
+		}
+
+		// A bot's side, false if there is no board of that name yet
+		bool open(const std::string& name) {
+			close();
+#ifndef _WIN32
+			int fd = shm_open(name.c_str(), O_RDWR, 0);
+			if (fd < 0)
+				return false;
+			struct stat info;
+			if (fstat(fd, &info) != 0 || (size_t)info.st_size < tilesOffset()) {
+				::close(fd);
+				return false;
+			}
+			if (!map(fd, (size_t)info.st_size))
+				return false;
+			if (header->magic != magic || header->version != version || tilesOffset() + header->rows * header->cols > size) {
+				close();
+				return false;
+			}
+			this->name = name;
+			return true;
+#else
+			(void)name;
+			return false;
+#endif
+		}
+
+		void close() {
+#ifndef _WIN32
+			if (base)
+				munmap(base, size);
+			if (owner)
+				retire(name);
+#endif
+			base = nullptr;
+			header = nullptr;
+			moves = nullptr;
+			tiles = nullptr;
+			size = 0;
+			owner = false;
+		}
+
+		bool isOpen() const { return header != nullptr; }
+
+		// The game replaced the segment, a bot opens the name again for the new board
+		bool isRetired() const { return header && header->retired.load(std::memory_order_acquire) != 0; }
+
+		size_t getRows() const { return (size_t)header->rows; }
+		size_t getCols() const { return (size_t)header->cols; }
+		SharedBoardHeader& getHeader() const { return *header; }
+
+		// Game side: every write between beginWrite and endWrite is seen by readers all at once
+		void beginWrite() {
+			header->sequence.store(header->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+		}
+
+		void endWrite() {
+			header->sequence.store(header->sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		}
+
+		void setTile(size_t index, uint8_t tile) { tiles[index] = tile; }
+
+		// Game side: the oldest move a bot sent
+		bool popMove(SharedMove& move) {
+			uint64_t tail = header->moveTail.load(std::memory_order_relaxed);
+			if (tail == header->moveHead.load(std::memory_order_acquire))
+				return false;
+			move = moves[tail & (moveCapacity - 1)];
+			header->moveTail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Bot side: calls read(board) until it ran on a board that didn't change meanwhile and
+		// returns what it returned. read looks at the tiles in place, it may see a board torn
+		// by a write in progress but its result is only kept if there was none. A retired
+		// segment may have been left in the middle of a write, its result has to be dropped.
+		template<typename Read>
+		auto read(Read reader) const {
+			while (true) {
+				uint64_t before = header->sequence.load(std::memory_order_acquire);
+				if ((before & 1) && !isRetired()) {
+					std::this_thread::yield();
+					continue;
+				}
+				auto result = reader(*this);
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (header->sequence.load(std::memory_order_relaxed) == before || isRetired())
+					return result;
+			}
+		}
+
+		const uint8_t* getTiles() const { return tiles; }
+		uint8_t getTile(size_t row, size_t col) const { return tiles[row * header->cols + col]; }
+
+		// Bot side: the number of moves sent so far with this one, 0 while the ring is full. The
+		// move is applied once movesApplied reaches the number.
+		uint64_t pushMove(uint32_t row, uint32_t col, uint8_t type) {
+			uint64_t head = header->moveHead.load(std::memory_order_relaxed);
+			if (head - header->moveTail.load(std::memory_order_acquire) >= moveCapacity)
+				return 0;
+			SharedMove& move = moves[head & (moveCapacity - 1)];
+			move.row = row;
+			move.col = col;
+			move.type = type;
+			header->moveHead.store(head + 1, std::memory_order_release);
+			return head + 1;
+		}
+
+	private:
+		static constexpr size_t movesOffset() {
+			return (sizeof(SharedBoardHeader) + 63) / 64 * 64;
+		}
+
+		static constexpr size_t tilesOffset() {
+			return movesOffset() + moveCapacity * sizeof(SharedMove);
+		}
+
+#ifndef _WIN32
+		bool map(int fd, size_t bytes) {
+			void* memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			::close(fd);
+			if (memory == MAP_FAILED) {
+				std::cerr << "Shared board: can't map, " << std::strerror(errno) << std::endl;
+				return false;
+			}
+			base = static_cast<uint8_t*>(memory);
+			size = bytes;
+			header = reinterpret_cast<SharedBoardHeader*>(base);
+			moves = reinterpret_cast<SharedMove*>(base + movesOffset());
+			tiles = base + tilesOffset();
+			return true;
+		}
+
+		// Tells the bots still mapping the old segment and removes its name
+		static void retire(const std::string& name) {
+			if (name.empty())
+				return;
+			int fd = shm_open(name.c_str(), O_RDWR, 0);
+			if (fd >= 0) {
+				struct stat info;
+				if (fstat(fd, &info) == 0 && (size_t)info.st_size >= sizeof(SharedBoardHeader)) {
+					void* memory = mmap(nullptr, sizeof(SharedBoardHeader), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+					if (memory != MAP_FAILED) {
+						static_cast<SharedBoardHeader*>(memory)->retired.store(1, std::memory_order_release);
+						munmap(memory, sizeof(SharedBoardHeader));
+					}
+				}
+				::close(fd);
+			}
+			shm_unlink(name.c_str());
+		}
+#endif
+
+		std::string name;
+		bool owner = false;
+		uint8_t* base = nullptr;
+		size_t size = 0;
+		SharedBoardHeader* header = nullptr;
+		SharedMove* moves = nullptr;
+		uint8_t* tiles = nullptr;
+	};
+}
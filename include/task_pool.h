@@ -0,0 +1,116 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace Minesweeper {
+
+	// Worker threads that share the iterations of a loop with the calling thread. Iterations are
+	// handed out one at a time from a counter, so a slow one doesn't hold up the others, and run
+	// returns once all of them finished. The loop body is passed by pointer, nothing is allocated
+	// per run.
+	class TaskPool {
+	public:
+		// By default one worker per core besides the calling thread
+		explicit TaskPool(size_t threads = defaultThreads()) {
+			workers.reserve(threads);
+			for (size_t i = 0; i < threads; i++)
+				workers.emplace_back([this] { workerLoop(); });
+		}
+
+		~TaskPool() {
+			{
+				std::lock_guard<std::mutex> lock{ mutex };
+				stopping = true;
+			}
+			wake.notify_all();
+			for (std::thread& worker : workers)
+				worker.join();
+		}
+
+		TaskPool(const TaskPool&) = delete;
+		TaskPool& operator=(const TaskPool&) = delete;
+
+		// Calls body(i) for every i below count, spread over the workers and this thread
+		template<typename Body>
+		void run(size_t count, Body&& body) {
+			if (workers.empty() || count < 2) {
+				for (size_t i = 0; i < count; i++)
+					body(i);
+				return;
+			}
+			{
+				std::unique_lock<std::mutex> lock{ mutex };
+				//A worker that picked up the last run late may still look at its counter
+				idle.wait(lock, [this] { return active == 0; });
+				job = { [](void* context, size_t i) { (*static_cast<std::remove_reference_t<Body>*>(context))(i); }, &body, count };
+				next.store(0, std::memory_order_relaxed);
+				remaining.store(count, std::memory_order_relaxed);
+				generation++;
+			}
+			wake.notify_all();
+			work(job);
+			std::unique_lock<std::mutex> lock{ mutex };
+			finished.wait(lock, [this] { return remaining.load(std::memory_order_acquire) == 0; });
+		}
+
+		size_t getThreadCount() const { return workers.size() + 1; }
+
+		static size_t defaultThreads() {
+			unsigned cores = std::thread::hardware_concurrency();
+			return cores > 1 ? cores - 1 : 0;
+		}
+
+	private:
+		struct Job {
+			void (*invoke)(void*, size_t) = nullptr;
+			void* context = nullptr;
+			size_t count = 0;
+		};
+
+		void work(const Job& current) {
+			for (size_t i = next.fetch_add(1, std::memory_order_relaxed); i < current.count; i = next.fetch_add(1, std::memory_order_relaxed)) {
+				current.invoke(current.context, i);
+				if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+					std::lock_guard<std::mutex> lock{ mutex };
+					finished.notify_all();
+				}
+			}
+		}
+
+		void workerLoop() {
+			uint64_t seen = 0;
+			std::unique_lock<std::mutex> lock{ mutex };
+			while (true) {
+				wake.wait(lock, [&] { return stopping || generation != seen; });
+				if (stopping)
+					return;
+				seen = generation;
+				Job current = job;
+				active++;
+				lock.unlock();
+				work(current);
+				lock.lock();
+				if (--active == 0)
+					idle.notify_all();
+			}
+		}
+
+		std::vector<std::thread> workers;
+		std::mutex mutex;
+		std::condition_variable wake, finished, idle;
+		Job job;
+		uint64_t generation = 0;
+		size_t active = 0;
+		bool stopping = false;
+		std::atomic<size_t> next{ 0 };
+		std::atomic<size_t> remaining{ 0 };
+	};
+}
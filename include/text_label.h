@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+
+#include "raylib.h"
+
+namespace Minesweeper {
+
+	// Text with cached metrics. The text is measured the first time a metric is asked for and
+	// again only after setText changed it, so drawing a label never measures.
+	class TextLabel {
+	public:
+		static const int MAX_TEXT = 64;
+
+		TextLabel() = default;
+		TextLabel(const char* text, float fontSize, float spacing = 0.0f) : fontSize{ fontSize }, spacing{ spacing } {
+			setText(text);
+		}
+
+		void setText(const char* newText) {
+			if (std::strncmp(text, newText, MAX_TEXT - 1) == 0)
+				return;
+			size_t length = strnlen(newText, MAX_TEXT - 1);
+			std::memcpy(text, newText, length);
+			text[length] = '\0';
+			widthValid = extentValid = false;
+		}
+
+		const char* getText() const {
+			return text;
+		}
+
+		float getFontSize() const {
+			return fontSize;
+		}
+
+		float getSpacing() const {
+			return spacing;
+		}
+
+		// Width as DrawText lays it out
+		int getWidth() const {
+			if (!widthValid) {
+				width = MeasureText(text, (int)fontSize);
+				widthValid = true;
+				measureCalls++;
+			}
+			return width;
+		}
+
+		// Size as DrawTextEx lays it out with the default font and the label's spacing
+		Vector2 getExtent() const {
+			if (!extentValid) {
+				extent = MeasureTextEx(GetFontDefault(), text, fontSize, spacing);
+				extentValid = true;
+				measureCalls++;
+			}
+			return extent;
+		}
+
+		// Text measurements done by all labels, for counting them per frame
+		static size_t getMeasureCalls() {
+			return measureCalls;
+		}
+
+		static void resetMeasureCalls() {
+			measureCalls = 0;
+		}
+
+	private:
+		char text[MAX_TEXT] = "";
+		float fontSize = 20.0f;
+		float spacing = 0.0f;
+		mutable int width = 0;
+		mutable Vector2 extent{ 0.0f, 0.0f };
+		mutable bool widthValid = false;
+		mutable bool extentValid = false;
+		inline static size_t measureCalls = 0;
+	};
+}
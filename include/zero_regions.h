@@ -0,0 +1,365 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "matrix_storage.h"
+#include "neighborhood.h"
+
+namespace Minesweeper {
+
+	// Connected regions of zero tiles plus the numbered tiles bordering them. Every region is
+	// stored as a span of tile indices (row * cols + col), so opening one never walks neighbors.
+	// Every plane comes from the Storage policy, ids are 64 bit so any board size can be labeled.
+	// addZeros patches the regions after a few tiles turned into zeros: new regions get new ids,
+	// merged ones forward their id and keep their span, so a region can have more than one.
+	template<template<typename> class Storage = HeapStorage>
+	class BasicZeroRegions {
+	public:
+		static constexpr uint64_t none = UINT64_MAX;
+
+		struct Span {
+			const uint64_t* first;
+			const uint64_t* last;
+			const uint64_t* begin() const { return first; }
+			const uint64_t* end() const { return last; }
+			size_t size() const { return last - first; }
+		};
+
+		// isZero(row, col) tells if the tile is a safe tile without bombs around it
+		template<typename IsZero>
+		void build(size_t rows, size_t cols, IsZero isZero) {
+			size_t count = rows * cols;
+			fill(parent, count, none);
+			fill(label, count, none);
+			regionCount = 0;
+			baseCount = 0;
+			patches.clear();
+			merged.clear();
+			extraTiles.clear();
+			patches.reserve(maxPatches);
+			merged.reserve(maxPatches);
+			extraTiles.reserve(maxExtraTiles);
+			component.reserve(maxPatches);
+			touching.reserve(maxPatches);
+			if (count == 0) {
+				fill(start, 1, 0);
+				spanTiles.resize(0);
+				return;
+			}
+			uint64_t* parent = this->parent.get();
+			uint64_t* label = this->label.get();
+
+			//Label bands of rows in parallel, unions never leave the band
+			size_t bands = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), rows);
+			if (count < parallelThreshold)
+				bands = 1;
+			size_t bandRows = (rows + bands - 1) / bands;
+			std::vector<std::thread> workers;
+			for (size_t b = 1; b < bands; b++) {
+				size_t r0 = b * bandRows;
+				if (r0 < rows)
+					workers.emplace_back([&, r0] { labelBand(r0, std::min(rows, r0 + bandRows), cols, isZero); });
+			}
+			labelBand(0, std::min(rows, bandRows), cols, isZero);
+			for (auto& worker : workers)
+				worker.join();
+
+			//Stitch the bands together along their first row
+			for (size_t r0 = bandRows; r0 < rows; r0 += bandRows) {
+				for (size_t col = 0; col < cols; col++) {
+					if (parent[r0 * cols + col] == none)
+						continue;
+					for (size_t c = (col == 0 ? 0 : col - 1); c <= col + 1 && c < cols; c++) {
+						if (parent[(r0 - 1) * cols + c] != none)
+							unite(r0 * cols + col, (r0 - 1) * cols + c);
+					}
+				}
+			}
+
+			for (size_t i = 0; i < count; i++) {
+				if (parent[i] == none)
+					continue;
+				size_t root = find(i);
+				if (label[root] == none)
+					label[root] = regionCount++;
+				label[i] = label[root];
+			}
+			buildSpans(rows, cols);
+			baseCount = regionCount;
+		}
+
+		// Zero tiles that were mines or numbers before, nothing else changed. isZero(row, col) tells
+		// the state after the change. Every new zero joins the regions it touches, which merge, or
+		// starts a new one with the other new zeros next to it. Costs O(count) plus the merged
+		// regions. False without changing anything when the patches are used up, build() again then.
+		template<typename IsZero>
+		bool addZeros(size_t rows, size_t cols, const size_t* zeros, size_t count, IsZero isZero, size_t& created, size_t& mergedAway) {
+			created = mergedAway = 0;
+			if (patches.size() + 9 * count > maxPatches || merged.size() + 8 * count > maxPatches || extraTiles.size() + 9 * count > maxExtraTiles)
+				return false;
+			uint64_t* label = this->label.get();
+			auto adjacent = [cols](size_t a, size_t b) {
+				size_t ra = a / cols, ca = a % cols, rb = b / cols, cb = b % cols;
+				return ra + 1 >= rb && ra <= rb + 1 && ca + 1 >= cb && ca <= cb + 1;
+			};
+
+			//New zeros next to each other end up in the same region
+			component.assign(zeros, zeros + count);
+			for (size_t i = 0; i < count; i++) {
+				for (size_t j = 0; j < i; j++) {
+					if (component[j] != component[i] && adjacent(zeros[i], zeros[j])) {
+						size_t from = component[i];
+						std::replace(component.begin(), component.end(), from, component[j]);
+					}
+				}
+			}
+
+			for (size_t i = 0; i < count; i++) {
+				if (component[i] != zeros[i])
+					continue;
+				//The regions this component touches, they merge into the lowest id
+				touching.clear();
+				for (size_t k = 0; k < count; k++) {
+					if (component[k] != zeros[i])
+						continue;
+					Neighborhood<SquareTopology>::forEach(zeros[k] / cols, zeros[k] % cols, rows, cols, [&](size_t r, size_t c) {
+						uint64_t region = resolve(label[r * cols + c]);
+						if (region != none && std::find(touching.begin(), touching.end(), region) == touching.end())
+							touching.push_back(region);
+						});
+				}
+				uint64_t region;
+				if (touching.empty()) {
+					region = regionCount++;
+					created++;
+				}
+				else {
+					region = *std::min_element(touching.begin(), touching.end());
+					for (uint64_t other : touching) {
+						if (other != region)
+							mergeInto(other, region);
+					}
+					mergedAway += touching.size() - 1;
+				}
+
+				//The new zeros and the numbers around them that no zero of the region borders yet
+				size_t first = extraTiles.size();
+				for (size_t k = 0; k < count; k++) {
+					if (component[k] != zeros[i])
+						continue;
+					extraTiles.push_back(zeros[k]);
+					Neighborhood<SquareTopology>::forEach(zeros[k] / cols, zeros[k] % cols, rows, cols, [&](size_t r, size_t c) {
+						if (isZero(r, c))
+							return;
+						size_t index = r * cols + c;
+						bool listed = std::find(extraTiles.begin() + first, extraTiles.end(), index) != extraTiles.end();
+						Neighborhood<SquareTopology>::forEach(r, c, rows, cols, [&](size_t zr, size_t zc) {
+							listed |= resolve(label[zr * cols + zc]) == region;
+							});
+						if (!listed)
+							extraTiles.push_back(index);
+						});
+				}
+				for (size_t k = 0; k < count; k++) {
+					if (component[k] == zeros[i])
+						label[zeros[k]] = region;
+				}
+				//Sorted like every other span, so the tiles of a region can be walked by index
+				std::sort(extraTiles.begin() + first, extraTiles.end());
+				patches.push_back({ region, first, extraTiles.size(), true });
+			}
+			return true;
+		}
+
+		uint64_t regionOf(size_t index) const {
+			return index < label.size() ? resolve(label.get()[index]) : none;
+		}
+
+		// True for a zero tile, cheaper than regionOf
+		bool inRegion(size_t index) const {
+			return index < label.size() && label.get()[index] != none;
+		}
+
+		// Span k of a region, false past the last one. Every span is sorted by tile index. A numbered
+		// tile next to two regions that were merged is listed in both of their spans.
+		bool span(uint64_t region, size_t k, Span& out) const {
+			if (k == 0) {
+				out = baseSpan(region);
+				return true;
+			}
+			for (const Patch& patch : patches) {
+				if (patch.region == region && --k == 0) {
+					out = patchSpan(patch);
+					return true;
+				}
+			}
+			return false;
+		}
+
+		template<typename Call>
+		void forEachSpan(uint64_t region, Call call) const {
+			call(baseSpan(region));
+			for (const Patch& patch : patches) {
+				if (patch.region == region)
+					call(patchSpan(patch));
+			}
+		}
+
+		// Region ids handed out, merged ones included
+		size_t size() const {
+			return regionCount;
+		}
+
+	private:
+		static constexpr size_t parallelThreshold = 1 << 16;
+		static constexpr size_t maxPatches = 256, maxExtraTiles = 2048;
+
+		// A span of a region outside of its own one in spanTiles: the span of a region merged into it
+		// or tiles addZeros added
+		struct Patch {
+			uint64_t region;
+			uint64_t first, last;
+			bool extra;
+		};
+
+		uint64_t resolve(uint64_t region) const {
+			if (merged.empty() || region == none)
+				return region;
+			auto found = std::lower_bound(merged.begin(), merged.end(), std::make_pair(region, uint64_t(0)));
+			return found != merged.end() && found->first == region ? found->second : region;
+		}
+
+		void mergeInto(uint64_t from, uint64_t into) {
+			if (from < baseCount && start.get()[from] != start.get()[from + 1])
+				patches.push_back({ into, start.get()[from], start.get()[from + 1], false });
+			for (Patch& patch : patches) {
+				if (patch.region == from)
+					patch.region = into;
+			}
+			for (auto& forward : merged) {
+				if (forward.second == from)
+					forward.second = into;
+			}
+			merged.insert(std::lower_bound(merged.begin(), merged.end(), std::make_pair(from, uint64_t(0))), { from, into });
+		}
+
+		Span baseSpan(uint64_t region) const {
+			if (region >= baseCount)
+				return { nullptr, nullptr };
+			const uint64_t* tiles = spanTiles.get();
+			return { tiles + start.get()[region], tiles + start.get()[region + 1] };
+		}
+
+		Span patchSpan(const Patch& patch) const {
+			const uint64_t* tiles = patch.extra ? extraTiles.data() : spanTiles.get();
+			return { tiles + patch.first, tiles + patch.last };
+		}
+
+		static void fill(Storage<uint64_t>& plane, size_t count, uint64_t value) {
+			plane.resize(count);
+			std::fill(plane.get(), plane.get() + count, value);
+		}
+
+		template<typename IsZero>
+		void labelBand(size_t r0, size_t r1, size_t cols, IsZero& isZero) {
+			uint64_t* parent = this->parent.get();
+			for (size_t row = r0; row < r1; row++) {
+				for (size_t col = 0; col < cols; col++) {
+					if (!isZero(row, col))
+						continue;
+					size_t index = row * cols + col;
+					parent[index] = index;
+					//Only the already visited neighbors: left and the row above
+					if (col > 0 && parent[index - 1] != none)
+						unite(index, index - 1);
+					if (row == r0)
+						continue;
+					for (size_t c = (col == 0 ? 0 : col - 1); c <= col + 1 && c < cols; c++) {
+						if (parent[(row - 1) * cols + c] != none)
+							unite(index, (row - 1) * cols + c);
+					}
+				}
+			}
+		}
+
+		size_t find(size_t index) {
+			uint64_t* parent = this->parent.get();
+			while (parent[index] != index) {
+				parent[index] = parent[parent[index]];
+				index = parent[index];
+			}
+			return index;
+		}
+
+		void unite(size_t a, size_t b) {
+			size_t rootA = find(a);
+			size_t rootB = find(b);
+			if (rootA < rootB)
+				parent.get()[rootB] = rootA;
+			else if (rootB < rootA)
+				parent.get()[rootA] = rootB;
+		}
+
+		// Counting sort of the tiles by region. A numbered tile is added once to every region it borders.
+		void buildSpans(size_t rows, size_t cols) {
+			//The parent plane is done with, it holds the fill positions now
+			parent.resize(0);
+			fill(start, regionCount + 1, 0);
+			uint64_t* start = this->start.get();
+			forEachMember(rows, cols, [start](size_t, uint64_t region) { start[region + 1]++; });
+			for (size_t k = 0; k < regionCount; k++)
+				start[k + 1] += start[k];
+			spanTiles.resize(start[regionCount]);
+
+			parent.resize(regionCount);
+			uint64_t* next = std::copy(start, start + regionCount, parent.get()) - regionCount;
+			uint64_t* tiles = spanTiles.get();
+			forEachMember(rows, cols, [&](size_t index, uint64_t region) { tiles[next[region]++] = index; });
+			parent.resize(0);
+		}
+
+		template<typename Call>
+		void forEachMember(size_t rows, size_t cols, Call call) {
+			const uint64_t* label = this->label.get();
+			for (size_t row = 0; row < rows; row++) {
+				for (size_t col = 0; col < cols; col++) {
+					size_t index = row * cols + col;
+					if (label[index] != none) {
+						call(index, label[index]);
+						continue;
+					}
+					std::array<uint64_t, 8> seen;
+					size_t seenCount = 0;
+					Neighborhood<SquareTopology>::forEach(row, col, rows, cols, [&](size_t r, size_t c) {
+						uint64_t region = label[r * cols + c];
+						if (region != none && std::find(seen.begin(), seen.begin() + seenCount, region) == seen.begin() + seenCount)
+							seen[seenCount++] = region;
+						});
+					for (size_t k = 0; k < seenCount; k++)
+						call(index, seen[k]);
+				}
+			}
+		}
+
+		Storage<uint64_t> parent;
+		Storage<uint64_t> label;
+		Storage<uint64_t> start;
+		Storage<uint64_t> spanTiles;
+		uint64_t regionCount = 0;
+		uint64_t baseCount = 0;
+		std::vector<Patch> patches;
+		//Merged id and the id it forwards to, sorted
+		std::vector<std::pair<uint64_t, uint64_t>> merged;
+		std::vector<uint64_t> extraTiles;
+		std::vector<size_t> component;
+		std::vector<uint64_t> touching;
+	};
+
+	using ZeroRegions = BasicZeroRegions<>;
+}
@@ -9,11 +9,41 @@
   
 #include <utility> 
 #include <climits>
+#include <cstdint>
 #include <random>
+#include <type_traits>
+#include <algorithm>
+#include <optional>
+#include <memory>
+#include <ctime>
+#include <cmath>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <thread>
 
 #include "myMatrix.h"
 #include "enums.h"
 #include "tile.h"
+#include "neighborhood.h"
+#include "zero_regions.h"
+#include "reveal_scheduler.h"
+#include "board_pool.h"
+#include "text_label.h"
+#include "draw_list.h"
+#include "layout_matrix.h"
+#include "minimap.h"
+#include "mine_probability.h"
+#include "mine_sampler.h"
+#include "replay.h"
+#include "coop.h"
+#include "shared_board.h"
+#include "board_raster.h"
+#include "fixed_board.h"
+#include "records.h"
+#include "task_pool.h"
+#define MINESWEEPER_ALLOC_TRACKER_IMPL
+#include "alloc_tracker.h"
 
 #include "random_iterator.h"
 
@@ -29,101 +59,342 @@ struct SizeConfig {
 	float const boardPadding = 10.f;
 	float boardWidth = ((tileSize + tilePadding) * cols) - tilePadding;
 	float boardHeight = ((tileSize + tilePadding) * rows) - tilePadding;
+	float const buttonWidth = 350.0f;
+	float const buttonHeight = 90.0f;
+	//Bumped on every update so cached layouts know when to recompute
+	unsigned version = 0;
 
 	void update() {
 		boardWidth = ((tileSize + tilePadding) * cols) - tilePadding;
 		boardHeight = ((tileSize + tilePadding) * rows) - tilePadding;
+		++version;
+	}
+
+	// Button centered on the screen horizontally, offsetX moves it sideways
+	Rectangle buttonRect(float y, float offsetX = 0.0f) const {
+		return { (screenWidth - buttonWidth) / 2.0f + offsetX, y, buttonWidth, buttonHeight };
 	}
 };
 
 
 namespace Minesweeper {
 
+	// Memory order of the board tiles. On a 1024x16384 board (--bench layouts) row major generates
+	// hints about 3x faster than TiledLayout<> and 6x faster than MortonLayout<>, floods as fast and
+	// only loses on reading small viewports, so it stays.
+	using BoardLayout = RowMajorLayout;
+	// Every per tile plane of a board, heap for small boards and a mapped file past mappedStorageBytes
+	template<typename T>
+	using BoardStorage = AdaptiveStorage<T>;
+	using TileMatrix = LayoutMatrix<Tile, BoardLayout, BoardStorage<Tile>>;
+	using BoardRegions = BasicZeroRegions<BoardStorage>;
+
+	// Difficulty of a generated board. 3BV is the least number of clicks that solves it without
+	// flags: one per opening and one per numbered tile that no opening reveals.
+	struct BoardMetrics {
+		size_t bbbv = 0;
+		size_t openings = 0;
+		size_t isolatedNumbers = 0;
+	};
+
 	class Board {
 	public:
-		Board(size_t rows = 0, size_t cols = 0, Difficulty diff = Difficulty::Easy) : tiles{ rows, cols }, numOfBombs{} {
+		Board(size_t rows = 0, size_t cols = 0, Difficulty diff = Difficulty::Easy) : tiles{ rows, cols }, numOfBombs{}, rng{ std::random_device{}() } {
+			clearPlanes();
+			reseed();
+			placeBombs(diff);
+			placeHints();
+			labelRegions();
+		}
+
+		// Exactly mines mines, at most every tile
+		Board(size_t rows, size_t cols, size_t mines) : tiles{ rows, cols }, numOfBombs{}, rng{ std::random_device{}() } {
+			clearPlanes();
+			reseed();
+			placeMines(mines);
+			placeHints();
+			labelRegions();
+		}
+
+		// New mines and hints in the existing buffers, used when the board size doesn't change
+		void regenerate(Difficulty diff) {
+			clearTiles();
+			reseed();
 			placeBombs(diff);
 			placeHints();
+			labelRegions();
+		}
+
+		void regenerate(size_t mines) {
+			clearTiles();
+			reseed();
+			placeMines(mines);
+			placeHints();
+			labelRegions();
+		}
+
+		// Another size in the same buffers, they only grow
+		void regenerate(size_t rows, size_t cols, size_t mines) {
+			resize(rows, cols);
+			regenerate(mines);
+		}
+
+		// Every tile empty and closed at the new size, the buffers keep their capacity
+		void resize(size_t rows, size_t cols) {
+			if (rows != tiles.size(0) || cols != tiles.size(1))
+				tiles.resize(rows, cols);
+			clearTiles();
+		}
+
+		size_t getRows() const { return tiles.size(0); }
+		size_t getCols() const { return tiles.size(1); }
+
+		// Same seed, same mines on the next regenerate
+		void seed(uint32_t value) {
+			rng.seed(value);
+		}
+
+		// Seed the random generator was set to right before the mines were placed
+		uint32_t getSeed() const {
+			return boardSeed;
+		}
+
+		// Mines exactly on the given tiles, like a board loaded from a replay
+		template<typename Mines>
+		void setMines(const Mines& layout) {
+			clearTiles();
+			numOfBombs = 0;
+			bombs.reserve(std::size(layout) + movedMineSlack);
+			for (uint64_t index : layout) {
+				if (index >= tiles.size())
+					continue;
+				tiles[(size_t)index / tiles.size(1)][(size_t)index % tiles.size(1)] = { 0, true, TileState::Closed };
+				bombs.push_back((size_t)index);
+				numOfBombs++;
+			}
+			placeHints();
+			labelRegions();
+		}
+
+		void setSamplingStrategy(SamplingStrategy strategy) {
+			sampler.setStrategy(strategy);
+		}
+
+		// Mines for a share of the tiles, any density from 0 to 1
+		static size_t minesFor(size_t tileCount, float density) {
+			density = std::clamp(density, 0.0f, 1.0f);
+			return std::min(tileCount, (size_t)(tileCount * (double)density));
+		}
+
+		static size_t minesFor(size_t tileCount, Difficulty diff) {
+			return minesFor(tileCount, bombPercentage(diff));
+		}
+
+		// Tiles stamped with an older epoch read as closed, which makes closing all of them O(1)
+		TileState getState(size_t row, size_t col) const {
+			if (stateEpoch.get()[row * tiles.size(1) + col] != epoch)
+				return TileState::Closed;
+			return tiles[row][col].getState();
+		}
+
+		void setState(size_t row, size_t col, TileState state) {
+			TileState before = getState(row, col);
+			tiles[row][col].setState(state);
+			stateEpoch.get()[row * tiles.size(1) + col] = epoch;
+			if ((before == TileState::Flagged) != (state == TileState::Flagged))
+				addAdjacentFlags(row, col, state == TileState::Flagged ? 1 : -1);
+		}
+
+		void closeAll() {
+			epoch = (epoch + 1) & epochMask;
+			if (epoch != 0)
+				return;
+			//The epoch wrapped around, stale stamps could look current again
+			for (Tile& tile : tiles)
+				tile.setState(TileState::Closed);
+			std::fill(stateEpoch.get(), stateEpoch.get() + stateEpoch.size(), 0);
+			std::fill(adjacentFlags.get(), adjacentFlags.get() + adjacentFlags.size(), 0);
+		}
+
+		// Flags around the tile, kept up to date by setState and cleared with closeAll
+		int getAdjacentFlags(size_t row, size_t col) const {
+			uint32_t packed = adjacentFlags.get()[row * tiles.size(1) + col];
+			if (packed >> flagCountBits != epoch)
+				return 0;
+			return (int)(packed & flagCountMask);
+		}
+
+		// An open number with as many flags around it as its hint, a chord on it opens the rest
+		bool isSatisfied(size_t row, size_t col) const {
+			const Tile& tile = tiles[row][col];
+			return getState(row, col) == TileState::Open && !tile.isBomb() && tile.getValue() != 0
+				&& getAdjacentFlags(row, col) == tile.getValue();
+		}
+
+		// Recounts the flags around every tile and compares them with the kept counts
+		bool checkAdjacentFlags() const {
+			bool consistent = true;
+			for (size_t row = 0; row < tiles.size(0); row++) {
+				for (size_t col = 0; col < tiles.size(1); col++) {
+					int flags = 0;
+					Neighborhood<SquareTopology>::forEach(row, col, tiles.size(0), tiles.size(1), [this, &flags](size_t newRow, size_t newCol) {
+						if (getState(newRow, newCol) == TileState::Flagged)
+							flags++;
+						});
+					if (flags != getAdjacentFlags(row, col)) {
+						std::cerr << "Adjacent flags of " << row << ", " << col << " are " << getAdjacentFlags(row, col)
+							<< " but recounted " << flags << std::endl;
+						consistent = false;
+					}
+				}
+			}
+			return consistent;
+		}
+
+		// Every tile that held a mine this game. Moved mines leave their old position behind,
+		// so check isBomb() when walking the list.
+		const std::vector<size_t>& getBombPositions() const {
+			return bombs;
 		}
 
 		virtual void placeBombs(Difficulty diff) {
-			numOfBombs =  (int)(tiles.size() * bombPercentage(diff));
+			placeMines(minesFor(tiles.size(), diff));
+		}
 
-			//POTENTIAL ERROR IF BOARD IS size() == 1
-			RandomIterator iterator(numOfBombs, 0, tiles.size()-1);
-			
-			while (iterator.has_next()) {
-				size_t tileIndex = iterator.next();
+		// Mines on mines random tiles, the sampler picks the algorithm for the density
+		void placeMines(size_t mines) {
+			mines = std::min(mines, tiles.size());
+			numOfBombs = mines;
+			bombs.reserve(mines + movedMineSlack);
+			sampler.sample(mines, tiles.size(), rng, [this](size_t tileIndex) {
 				size_t row = tileIndex / tiles.size(1);
 				size_t col = tileIndex % tiles.size(1);
 				tiles[row][col] = { 0, true, TileState::Closed };
-			}
-		
-	
+				bombs.push_back(tileIndex);
+				});
 		}
 
-		template<typename Call>
+		// Calls callOnTiles(row, col) or callOnTiles(Tile&) for every neighbor of the tile
+		template<typename Topology = SquareTopology, typename Call>
 		void loopAdjTiles(size_t row, size_t col, Call callOnTiles) {
-			std::vector<std::pair<int, int>>
-				offsets{ {-1,-1},{-1, 0},{-1,1},
-						 { 0,-1}        ,{ 0,1},
-						 { 1,-1},{ 1, 0},{ 1,1} };
+			Neighborhood<Topology>::forEach(row, col, tiles.size(0), tiles.size(1), [&](size_t newRow, size_t newCol) {
+				if constexpr (std::is_invocable_v<Call&, Tile&>)
+					callOnTiles(tiles[newRow][newCol]);
+				else
+					callOnTiles(newRow, newCol);
+				});
+		}
 
-			for (auto& [dx, dy] : offsets) {
-				size_t newRow = row + dx;
-				size_t newCol = col + dy;
-				if (newRow < tiles.size(0) && newCol < tiles.size(1)) {
-					callOnTiles(newRow,newCol);
-				}
-			}
+		// Streams through the tiles in bands so a mapped board only keeps a few bands in memory
+		virtual void placeHints() {
+			tiles.forEachBand(hintBandBytes, [this](size_t i, size_t j, Tile& current) {
+				if (current.isBomb())
+					return;
+				int bombCount = 0;
+				loopAdjTiles(i, j, [&bombCount](Tile& tile) {
+					if (tile.isBomb())
+						bombCount++;
+					});
+				current = Tile{ bombCount };
+				});
 		}
 
-		template<typename Call>
-		void loopAdjTiles(size_t row, size_t col, Call callOnTiles) {
-			std::vector<std::pair<int, int>>
-				offsets{ {-1,-1},{-1, 0},{-1,1},
-						 { 0,-1}        ,{ 0,1},
-						 { 1,-1},{ 1, 0},{ 1,1} };
+		// Moves every mine in the 3x3 area around (row, col) to a free tile outside of it. Only the
+		// hints around the old and new positions are patched, the board is never regenerated. The
+		// mines go to spare tiles picked when the board was labeled, so nothing is searched for here,
+		// a random free tile is only taken when not enough spares are left. With spares the regions
+		// and metrics are patched around the area too, otherwise they are relabeled on next use.
+		void clearArea(size_t row, size_t col) {
+			size_t areaTiles = 0, areaBombs = 0;
+			forEachInArea(row, col, [&](size_t r, size_t c) {
+				areaTiles++;
+				if (tiles[r][c].isBomb())
+					areaBombs++;
+				});
+			//Free tiles outside the area, if there are none the mines have to stay
+			size_t freeTiles = tiles.size() - numOfBombs - (areaTiles - areaBombs);
+			localClear = false;
+			if (areaBombs == 0 || freeTiles < areaBombs)
+				return;
 
-			for (auto& [dx, dy] : offsets) {
-				size_t newRow = row + dx;
-				size_t newCol = col + dy;
-				if (newRow < tiles.size(0) && newCol < tiles.size(1)) {
-					callOnTiles(tiles[newRow][newCol]);
-				}
+			std::array<size_t, maxSpares> targets;
+			size_t targetCount = takeSpares(row, col, areaBombs, targets);
+			size_t isolatedBefore = countIsolated(row, col, 3);
+			std::uniform_int_distribution<size_t> pick(0, tiles.size() - 1);
+			size_t next = 0;
+			forEachInArea(row, col, [&](size_t r, size_t c) {
+				if (!tiles[r][c].isBomb())
+					return;
+				size_t to, toRow, toCol;
+				do {
+					to = next < targetCount ? targets[next++] : pick(rng);
+					toRow = to / tiles.size(1);
+					toCol = to % tiles.size(1);
+				} while (tiles[toRow][toCol].isBomb() || inArea(row, col, toRow, toCol));
+				moveBomb(r, c, toRow, toCol);
+				});
+			localClear = targetCount == areaBombs && !regionsDirty && patchRegions(row, col);
+			if (!localClear) {
+				regionsDirty = true;
+				return;
 			}
+			//A spare was a number without a zero next to it, the 7x7 area holds every other change
+			metrics.isolatedNumbers += countIsolated(row, col, 3);
+			metrics.isolatedNumbers -= isolatedBefore + targetCount;
+			metrics.bbbv = metrics.openings + metrics.isolatedNumbers;
 		}
-	
 
+		// True if the last clearArea moved its mines to spare tiles only
+		bool wasClearedLocally() const {
+			return localClear;
+		}
 
-		virtual void placeHints() {
-			std::vector<std::pair<int, int>>
-				offsets{ {-1,-1},{-1, 0},{-1,1},
-						 { 0,-1}        ,{ 0,1},
-						 { 1,-1},{ 1, 0},{ 1,1} };
-			for (size_t i = 0; i < tiles.size(0); i++)
-			{
-				for (size_t j = 0; j < tiles.size(1); j++)
-				{
-					if (tiles[i][j].isBomb()) {
-						continue;
-					}
-					int bombCount = 0;
-					for (auto& [dx, dy] : offsets) {
-						size_t newRow = i + dx;
-						size_t newCol = j + dy;
-						if (newRow < tiles.size(0) && newCol < tiles.size(1)) {
-							if (tiles[newRow][newCol].isBomb()) {
-								bombCount++;
-							}
-						}
-						tiles[i][j] = Tile{ bombCount };
-					}
-				}
-			}
+		// Labels the zero regions and counts the board metrics from them
+		void labelRegions() {
+			regions.build(tiles.size(0), tiles.size(1), [this](size_t row, size_t col) {
+				return !tiles[row][col].isBomb() && tiles[row][col].getValue() == 0;
+				});
+			regionsDirty = false;
+
+			metrics = {};
+			metrics.openings = regions.size();
+			tiles.forEachBand(hintBandBytes, [this](size_t row, size_t col, Tile& tile) {
+				if (!tile.isBomb() && tile.getValue() != 0 && !touchesOpening(row, col))
+					metrics.isolatedNumbers++;
+				});
+			metrics.bbbv = metrics.openings + metrics.isolatedNumbers;
+			pickSpares();
+		}
+
+		// True if the tile is next to a zero tile, so opening that zero reveals it
+		bool touchesOpening(size_t row, size_t col) {
+			if (regionsDirty)
+				labelRegions();
+			bool touches = false;
+			loopAdjTiles(row, col, [this, &touches](size_t newRow, size_t newCol) {
+				touches |= regions.inRegion(newRow * tiles.size(1) + newCol);
+				});
+			return touches;
+		}
+
+		// Up to date once getRegions ran after the mines were moved
+		const BoardMetrics& getMetrics() const {
+			return metrics;
+		}
+
+		// The regions as labeled last, stale after a clearArea that getRegions didn't follow yet
+		const BoardRegions& peekRegions() const {
+			return regions;
+		}
+
+		// Relabels lazily after mines were moved by clearArea
+		const BoardRegions& getRegions() {
+			if (regionsDirty)
+				labelRegions();
+			return regions;
 		}
 
-		float bombPercentage(Difficulty difficulty) const {
+		static float bombPercentage(Difficulty difficulty) {
 			float bombPercentage = 0.f; 
 			if (difficulty == Difficulty::Easy)
 				bombPercentage = 0.1f; 
@@ -134,21 +405,187 @@ namespace Minesweeper {
 			return bombPercentage;
 		}
 
-		int getBombs() const {
+		size_t getBombs() const {
 			return numOfBombs;
 		}
 
-		typename Matrix<Tile>::Row operator[](size_t row) {
+		TileMatrix::Row operator[](size_t row) {
 			return tiles[row];
 		}
 
-		const typename Matrix<Tile>::Row operator[](size_t row) const {
+		const TileMatrix::Row operator[](size_t row) const {
 			return tiles[row];
 		}
 
 	protected:
-		Matrix<Tile> tiles;
-		int numOfBombs;
+		static constexpr size_t hintBandBytes = size_t(4) << 20;
+
+		TileMatrix tiles;
+		size_t numOfBombs;
+		std::mt19937 rng;
+		BoardRegions regions;
+		bool regionsDirty = false;
+		BoardMetrics metrics;
+		std::vector<size_t> bombs;
+		MineSampler sampler;
+		uint32_t boardSeed = 0;
+		BoardStorage<uint32_t> stateEpoch;
+		//Epoch in the high bits and the flag count in the low bits, stale counts read as 0
+		BoardStorage<uint32_t> adjacentFlags;
+		uint32_t epoch = 0;
+		static constexpr size_t maxSpares = 16, spareProbes = 4096;
+		//Room in bombs for the mines first clicks move, so moving them never copies the list
+		static constexpr size_t movedMineSlack = 64;
+		std::array<size_t, maxSpares> spares;
+		size_t spareCount = 0;
+		bool localClear = false;
+
+	private:
+		void reseed() {
+			boardSeed = (uint32_t)rng();
+			rng.seed(boardSeed);
+		}
+
+		void clearTiles() {
+			for (Tile& tile : tiles)
+				tile = Tile{};
+			clearPlanes();
+		}
+
+		void clearPlanes() {
+			bombs.clear();
+			stateEpoch.resize(tiles.size());
+			adjacentFlags.resize(tiles.size());
+			epoch = 0;
+		}
+
+		static constexpr uint32_t flagCountBits = 4;
+		static constexpr uint32_t flagCountMask = (1u << flagCountBits) - 1;
+		static constexpr uint32_t epochMask = UINT32_MAX >> flagCountBits;
+
+		void addAdjacentFlags(size_t row, size_t col, int delta) {
+			loopAdjTiles(row, col, [this, delta](size_t newRow, size_t newCol) {
+				uint32_t& packed = adjacentFlags.get()[newRow * tiles.size(1) + newCol];
+				uint32_t count = packed >> flagCountBits == epoch ? packed & flagCountMask : 0;
+				packed = epoch << flagCountBits | (uint32_t)((int)count + delta);
+				});
+		}
+
+		// A safe tile without a zero in its 3x3 area. A mine put there turns no zero into a number,
+		// so the zero regions stay as they are.
+		bool isSpare(size_t index) {
+			size_t row = index / tiles.size(1), col = index % tiles.size(1);
+			if (tiles[row][col].isBomb())
+				return false;
+			bool spare = true;
+			forEachInArea(row, col, [&](size_t r, size_t c) {
+				spare &= tiles[r][c].isBomb() || tiles[r][c].getValue() != 0;
+				});
+			return spare;
+		}
+
+		// Numbered tiles at most radius away from (row, col) without a zero next to them
+		size_t countIsolated(size_t row, size_t col, size_t radius) {
+			size_t isolated = 0;
+			size_t lastRow = std::min(row + radius, tiles.size(0) - 1), lastCol = std::min(col + radius, tiles.size(1) - 1);
+			for (size_t r = row > radius ? row - radius : 0; r <= lastRow; r++) {
+				for (size_t c = col > radius ? col - radius : 0; c <= lastCol; c++) {
+					if (tiles[r][c].isBomb() || tiles[r][c].getValue() == 0)
+						continue;
+					bool touches = false;
+					loopAdjTiles(r, c, [&touches](Tile& tile) {
+						touches |= !tile.isBomb() && tile.getValue() == 0;
+						});
+					isolated += !touches;
+				}
+			}
+			return isolated;
+		}
+
+		// The zeros the cleared area around (row, col) made join the regions, false if the regions
+		// ran out of patches
+		bool patchRegions(size_t row, size_t col) {
+			std::array<size_t, 25> zeros;
+			size_t zeroCount = 0;
+			size_t lastRow = std::min(row + 2, tiles.size(0) - 1), lastCol = std::min(col + 2, tiles.size(1) - 1);
+			for (size_t r = row > 2 ? row - 2 : 0; r <= lastRow; r++) {
+				for (size_t c = col > 2 ? col - 2 : 0; c <= lastCol; c++) {
+					size_t index = r * tiles.size(1) + c;
+					if (!tiles[r][c].isBomb() && tiles[r][c].getValue() == 0 && !regions.inRegion(index))
+						zeros[zeroCount++] = index;
+				}
+			}
+			size_t created, mergedAway;
+			bool patched = regions.addZeros(tiles.size(0), tiles.size(1), zeros.data(), zeroCount, [this](size_t r, size_t c) {
+				return !tiles[r][c].isBomb() && tiles[r][c].getValue() == 0;
+				}, created, mergedAway);
+			if (patched)
+				metrics.openings = metrics.openings + created - mergedAway;
+			return patched;
+		}
+
+		// Random spare tiles for the first click, a few thousand probes at most
+		void pickSpares() {
+			spareCount = 0;
+			if (tiles.size() == 0)
+				return;
+			std::uniform_int_distribution<size_t> pick(0, tiles.size() - 1);
+			for (size_t probe = 0; probe < spareProbes && spareCount < maxSpares; probe++) {
+				size_t index = pick(rng);
+				if (isSpare(index) && std::find(spares.begin(), spares.begin() + spareCount, index) == spares.begin() + spareCount)
+					spares[spareCount++] = index;
+			}
+		}
+
+		// Up to count spares that are still spare and whose area doesn't reach the 7x7 area around
+		// (row, col), so they never border what clearing the 3x3 area changes. Taken ones are removed.
+		size_t takeSpares(size_t row, size_t col, size_t count, std::array<size_t, maxSpares>& out) {
+			size_t taken = 0, kept = 0;
+			for (size_t k = 0; k < spareCount; k++) {
+				size_t index = spares[k];
+				size_t r = index / tiles.size(1), c = index % tiles.size(1);
+				bool far = r + 4 <= row || r >= row + 4 || c + 4 <= col || c >= col + 4;
+				if (taken < count && far && isSpare(index))
+					out[taken++] = index;
+				else
+					spares[kept++] = index;
+			}
+			spareCount = kept;
+			return taken;
+		}
+
+		static bool inArea(size_t row, size_t col, size_t r, size_t c) {
+			return r + 1 >= row && r <= row + 1 && c + 1 >= col && c <= col + 1;
+		}
+
+		template<typename Call>
+		void forEachInArea(size_t row, size_t col, Call call) {
+			call(row, col);
+			loopAdjTiles(row, col, call);
+		}
+
+		void setValue(size_t row, size_t col, int value) {
+			Tile& tile = tiles[row][col];
+			tile = Tile{ value, false, tile.getState() };
+		}
+
+		void moveBomb(size_t fromRow, size_t fromCol, size_t toRow, size_t toCol) {
+			tiles[toRow][toCol] = Tile{ 0, true, tiles[toRow][toCol].getState() };
+			bombs.push_back(toRow * tiles.size(1) + toCol);
+			loopAdjTiles(toRow, toCol, [this](size_t r, size_t c) {
+				if (!tiles[r][c].isBomb())
+					setValue(r, c, tiles[r][c].getValue() + 1);
+				});
+
+			int bombCount = 0;
+			loopAdjTiles(fromRow, fromCol, [&](size_t r, size_t c) {
+				if (tiles[r][c].isBomb())
+					bombCount++;
+				else
+					setValue(r, c, tiles[r][c].getValue() - 1);
+				});
+			setValue(fromRow, fromCol, bombCount);
+		}
 	
 
 	};
@@ -166,6 +603,49 @@ namespace Minesweeper {
 		size_t column;
 	};
 
+	enum class MoveType { Open, Flag, Chord };
+
+	struct Move {
+		size_t row;
+		size_t column;
+		MoveType type;
+	};
+
+	// What a batch of moves changed, tiles are stored as row * cols + col
+	struct ChangeSet {
+		std::vector<size_t> opened;
+		std::vector<size_t> closed;
+		std::vector<size_t> flagged;
+		std::vector<size_t> unflagged;
+		bool reset = false;
+		//Cascades were still opening when the set was taken, their tiles follow in later sets
+		bool revealing = false;
+		GameState stateBefore = GameState::Ongoing;
+		GameState state = GameState::Ongoing;
+
+		void clear() {
+			opened.clear();
+			closed.clear();
+			flagged.clear();
+			unflagged.clear();
+			reset = false;
+			revealing = false;
+		}
+
+		bool empty() const {
+			return !reset && opened.empty() && closed.empty() && flagged.empty() && unflagged.empty();
+		}
+	};
+
+	// Takes the moves of a game that is played on another instance
+	class MoveSink {
+	public:
+		virtual ~MoveSink() = default;
+		virtual void forward(const Move* moves, size_t count) = 0;
+		virtual void requestReset() = 0;
+		virtual void requestContinue() = 0;
+	};
+
 	class NoGuessBoard : public Board {
 	public:
 		NoGuessBoard() :startPos{} {};
@@ -203,10 +683,14 @@ namespace Minesweeper {
 	class Button {
 	public:
 		Button() = default;
-		Button(const char* text, Rectangle rec, GameScreen s, Color tc = DARKGRAY) : text{ text }, rect{ rec }, screen{ s }, heldDown{ false }, textColor {tc}{}
+		Button(const char* text, Rectangle rec, GameScreen s, Color tc = DARKGRAY) : rect{ rec }, screen{ s }, label{ text, 25.0f }, heldDown{ false }, textColor {tc}{}
 
 		const char* getText() const {
-			return text;
+			return label.getText();
+		}
+
+		const TextLabel& getLabel() const {
+			return label;
 		}
 
 		const Rectangle getButtonRect() const {
@@ -230,833 +714,4724 @@ namespace Minesweeper {
 	private:
 		Rectangle rect;
 		GameScreen screen;
-		const char* text;
+		TextLabel label;
 		bool heldDown;
 		Color textColor;
 	};
 
 	class Game {
 	public:
-		Game(SizeConfig& conf) : state{ GameState::Ongoing }, sizeConfig{ conf }, startTime{ GetTime() }, endTime{}, board{}, tiles{ }, bombCount{board.getBombs()} {  
-			tryAgainButton = { (const char*)"Reset Game", { sizeConfig.screenWidth/2 -175.0f, 500.0f, 350.0f, 90.0f }, GameScreen::GAMEPLAY };
-			continueButton = { (const char*)"Continue", { sizeConfig.screenWidth / 2 - 175.0f, 500.0f, 350.0f, 90.0f }, GameScreen::GAMEPLAY };
-			homeButton = { (const char*)"Main Menu", { sizeConfig.screenWidth / 2 - 175.0f, 600.0f, 350.0f, 90.0f }, GameScreen::GAMEPLAY };
+		Game(SizeConfig& conf) : state{ GameState::Ongoing }, sizeConfig{ conf }, startTime{ GetTime() }, endTime{}, board{}, bombCount{ (int64_t)board.getBombs() } {  
+			tryAgainButton = { (const char*)"Reset Game", sizeConfig.buttonRect(500.0f), GameScreen::GAMEPLAY };
+			continueButton = { (const char*)"Continue", sizeConfig.buttonRect(500.0f), GameScreen::GAMEPLAY };
+			homeButton = { (const char*)"Main Menu", sizeConfig.buttonRect(600.0f), GameScreen::GAMEPLAY };
+		}
+
+		~Game() {
+			setBoardPool(nullptr);
+		}
+
+		Game(const Game&) = delete;
+		Game& operator=(const Game&) = delete;
+
+		// Where new boards come from, the pool shared by all games by default. Without a pool every
+		// board is generated when its game starts.
+		void setBoardPool(BoardPool<Board>* pool) {
+			if (boardPool)
+				boardPool->configure(pooled, {});
+			boardPool = pool;
+			pooled = {};
 		}
 
 		void startGame(size_t rows, size_t cols, Difficulty diff){
+			startGame(rows, cols, Board::minesFor(rows * cols, diff));
+		}
+
+		// Exactly mines mines, up to a board without a single safe tile
+		void startGame(size_t rows, size_t cols, size_t mines){
+			moveSink = nullptr;
 			sizeConfig.rows = rows;
 			sizeConfig.cols = cols;
 			sizeConfig.update();
 			startTime = GetTime();
 			
-			board = Board{ rows, cols, diff };
-			bombCount = board.getBombs();
-			tiles = Matrix<Rectangle>{ rows, cols };
+			//Swap in a board generated in the background, the pool refills itself for the next game
+			BoardPool<Board>::Setting setting{ rows, cols, mines };
+			if (boardPool) {
+				boardPool->configure(pooled, setting);
+				pooled = setting;
+			}
+			//The replaced board goes back to the pool, which generates the next one into its buffers
+			if (std::optional<Board> ready = boardPool ? boardPool->take(setting) : std::nullopt) {
+				std::swap(board, *ready);
+				boardPool->recycle(std::move(*ready));
+			}
+			else {
+				board.regenerate(rows, cols, mines);
+			}
 			initTiles();
+			bombCount = board.getBombs();
+			state = GameState::Ongoing;
+			firstMove = true;
+			continued = false;
+			openedSafe = 0;
+			resetLiveMetrics();
+			reveals.clear();
+			undoable = false;
+			pendingChanges.clear();
+			pendingChanges.reset = true;
+			reserveBuffers();
+			beginRecording();
 		}
 		void resetGame() {
-			for (size_t i = 0; i < sizeConfig.rows; i++)
-			{
-				for (size_t j = 0; j < sizeConfig.cols; j++)
-				{
-					if (board[i][j].getState() != TileState::Closed)
-						board[i][j].setState(TileState::Closed);
-				}
+			if (moveSink) {
+				moveSink->requestReset();
+				return;
 			}
+			board.closeAll();
 			startTime = GetTime();
 			bombCount = board.getBombs();
 			state = GameState::Ongoing;
+			firstMove = true;
+			continued = false;
+			openedSafe = 0;
+			resetLiveMetrics();
+			reveals.clear();
+			undoable = false;
+			pendingChanges.clear();
+			pendingChanges.reset = true;
+			beginRecording();
 		}
 		void continueGame() {
-			for (size_t i = 0; i < sizeConfig.rows; i++)
-			{
-				for (size_t j = 0; j < sizeConfig.cols; j++)
-				{
-					if (board[i][j].isBomb() && board[i][j].getState() != TileState::Flagged)
-						board[i][j].setState(TileState::Closed); 
+			if (moveSink) {
+				moveSink->requestContinue();
+				return;
+			}
+			for (size_t index : board.getBombPositions()) {
+				size_t row = index / sizeConfig.cols;
+				size_t col = index % sizeConfig.cols;
+				if (board[row][col].isBomb() && board.getState(row, col) == TileState::Open) {
+					board.setState(row, col, TileState::Closed); 
+					pendingChanges.closed.push_back(index);
+					recorder.touched(index);
 				}
 			}
 			state = GameState::Ongoing;
+			//The cascades the losing move finished may have opened the last safe tiles, a replay
+			//sees the win here too instead of on a later move that changes nothing
+			if (checkWin())
+				state = GameState::Won;
+			continued = true;
+			undoable = false;
+			recorder.continued();
 		}
 
 		void toggleFlag(size_t row, size_t col) {
-			if (getTile(row, col).getState() == TileState::Flagged) {
-				board[row][col].setState(TileState::Closed);
-				++bombCount;
-				return;
-			}
-			if (getTile(row, col).getState() == TileState::Closed) {
-				board[row][col].setState(TileState::Flagged);
-				--bombCount;
-			}
-				
+			Move move{ row, col, MoveType::Flag };
+			applyMoves(&move, 1);
 		}
 		void toggleHeldDown(size_t row, size_t col, bool held) {
 			board[row][col].setHeldDown(held);
 		}
+		// The board is centered on the screen, a tile's rectangle follows from its row and column
 		void initTiles() {	
 			float boardWidth = ((sizeConfig.tileSize + sizeConfig.tilePadding) * sizeConfig.cols) - sizeConfig.tilePadding;
 			float boardHeight = ((sizeConfig.tileSize + sizeConfig.tilePadding) * sizeConfig.rows) - sizeConfig.tilePadding;
 
-			float centerX = (sizeConfig.screenWidth - boardWidth) / 2;
-			float centerY = (sizeConfig.screenHeight - boardHeight) / 2;
-			
-			for (size_t row = 0; row < sizeConfig.rows; row++)
-			{
-				for (size_t col = 0; col < sizeConfig.cols; col++)
-				{
-				tiles[row][col].x = centerX + col * (sizeConfig.tileSize + sizeConfig.tilePadding);
-				tiles[row][col].y = centerY + row * (sizeConfig.tileSize + sizeConfig.tilePadding);
-				tiles[row][col].width = sizeConfig.tileSize;
-				tiles[row][col].height = sizeConfig.tileSize;
-				}
-			}
+			boardOrigin.x = (sizeConfig.screenWidth - boardWidth) / 2;
+			boardOrigin.y = (sizeConfig.screenHeight - boardHeight) / 2;
 		}
 		
 		bool checkWin()  { 
-			for (size_t i = 0; i < sizeConfig.rows; i++){
-				for (size_t j = 0; j < sizeConfig.cols; j++)
-				{
-					Tile t = board[i][j];
-					if (t.getState() != TileState::Open && !t.isBomb()) 
-						return false;
-				}
-			}
+			if (openedSafe != sizeConfig.rows * sizeConfig.cols - board.getBombs())
+				return false;
 			endTime = GetTime();
 			return true;
 		}
 
-		Position findTile(Tile const& t) {
-			for (size_t i = 0; i < sizeConfig.rows; i++) {
-				for (size_t j = 0; j < sizeConfig.cols; j++){
-					if (board[i][j] == t) {
-						return { i,j };
-					}
-				}
+		// Runs one slice of the pending cascades, called once per frame
+		void update() {
+			if (reveals.empty())
+				return;
+			if (state != GameState::Ongoing) {
+				reveals.clear();
+				return;
 			}
+			//A replay runs the slices as they were recorded
+			if (replaying)
+				return;
+			double deadline = GetTime() + revealSecondBudget;
+			size_t opened = reveals.run(board.getRegions(), revealTileBudget > 0 ? revealTileBudget : SIZE_MAX, SIZE_MAX,
+				[this](size_t index) { return openCascadeTile(index); },
+				[this, deadline]() { return revealSecondBudget > 0 && GetTime() > deadline; });
+			if (opened > 0)
+				recorder.reveal(opened);
+			//Stops in front of the next closed tile as runReveal does, so a replay has the same regions pending
+			reveals.skipOpened(board.getRegions(), [this](size_t index) {
+				return board.getState(index / sizeConfig.cols, index % sizeConfig.cols) == TileState::Closed;
+				});
+			if (checkWin())
+				state = GameState::Won;
 		}
-		void openTile(Tile& tile) {
-			
-			tile.setState(TileState::Open); 
 
-			if (tile.isBomb()) { 
-				state = GameState::Lost;
+		// Opens exactly tiles tiles of the pending cascades, one recorded slice of a replay. The
+		// regions of the replay are labeled from scratch, they may list their tiles in another order
+		// than the patched ones of the recording, so only the tiles of whole cascades are the same.
+		void runReveal(size_t tiles) {
+			if (state != GameState::Ongoing) {
+				reveals.clear();
 				return;
 			}
-			if(checkWin())
+			const BoardRegions& regions = board.getRegions();
+			reveals.run(regions, SIZE_MAX, tiles, [this](size_t index) { return openCascadeTile(index); }, []() { return false; });
+			reveals.skipOpened(regions, [this](size_t index) {
+				return board.getState(index / sizeConfig.cols, index % sizeConfig.cols) == TileState::Closed;
+				});
+			if (checkWin())
 				state = GameState::Won;
-			Position p = findTile(tile);
-			revealTiles(p.row, p.column);
 		}
 
-		Rectangle getTileRect(size_t row, size_t col) const { return tiles[row][col]; }
-		Tile& getTile(size_t row, size_t col) const {
-			return board[row][col];
+		// Tiles opened per frame by a cascade and the time they may take, 0 means no limit.
+		// Without any limit cascades open instantly from the precomputed regions.
+		void setRevealBudget(size_t tilesPerFrame, double secondsPerFrame = 0.0) {
+			revealTileBudget = tilesPerFrame;
+			revealSecondBudget = secondsPerFrame;
 		}
-		GameState getGameState() const { return state; }
-		TileState getTileRenderState(size_t row, size_t col) const {
-			const Tile& tile = board[row][col];
 
-			if (tile.getState() == TileState::Open) {
-				if (tile.isBomb()) {
-					return TileState::Bomb;
-				}
-				return TileState::Open;
-			}
-			if (tile.isHeldDown())
-				return TileState::HeldDown;
-			return tile.getState();
-		}
-		size_t getBombs() const { return bombCount; }
-		double getGameTime() const {
-			if(state == GameState::Won || state == GameState::Lost)
-				return endTime - startTime;
-			return 55.0;
-			//std::cerr << "Cant get GameTime because game is not over!";
-		}
-		const Button& getTryAgainButton() const {
-			return tryAgainButton;
-		}
-		const Button& getHomeButton() const {
-			return homeButton;
+		bool isRevealing() const { return !reveals.empty(); }
+
+		// A closed tile of a region a cascade is still opening, zero or number
+		bool isRevealPending(size_t row, size_t col) const {
+			if (reveals.empty() || board.getState(row, col) != TileState::Closed)
+				return false;
+			const BoardRegions& regions = board.peekRegions();
+			uint64_t region = regions.regionOf(row * sizeConfig.cols + col);
+			if (region != BoardRegions::none)
+				return reveals.isPending(region);
+			bool pending = false;
+			Neighborhood<SquareTopology>::forEach(row, col, sizeConfig.rows, sizeConfig.cols, [&](size_t newRow, size_t newCol) {
+				uint64_t next = regions.regionOf(newRow * sizeConfig.cols + newCol);
+				pending |= next != BoardRegions::none && reveals.isPending(next);
+				});
+			return pending;
 		}
-		const Button& getContinueButton() const{
-			return continueButton;
+
+		void openTile(size_t row, size_t col) {
+			Move move{ row, col, MoveType::Open };
+			applyMoves(&move, 1);
 		}
-		
-		void revealTiles(size_t row, size_t col) {
-			if (board[row][col].getValue() != 0 || board[row][col].isBomb())
-				return;
 
-
-			board.loopAdjTiles(row, col, [&](size_t newRow, size_t newCol) {
-				if (board[newRow][newCol].getValue() == 0 && board[newRow][newCol].getState() == TileState::Closed) {
-					board[newRow][newCol].setState(TileState::Open);
-					revealTiles(newRow, newCol);
-				}
-				board[newRow][newCol].setState(TileState::Open);
-				});
-		}
-		void fastOpen(size_t row, size_t col) {
-			int flags = 0;
-			board.loopAdjacentTiles(row, col,[this, &flags](size_t newRow, size_t newCol) {
-				if (board[newRow][newCol].getState() == TileState::Flagged)
-					flags++;
-			});
-		
-			if (flags == board[row][col].getValue()) {
-				board.loopAdjacentTiles(row, col, [this, &flags](size_t newRow, size_t newCol) { 
-					if (board[newRow][newCol].getState() == TileState::Closed)
-						openTile(newRow, newCol);
+		// Applies a batch of moves. The cascades of all moves are merged into one flood and loss and
+		// win are checked once at the end. The returned change set is valid until the next call. With
+		// a reveal budget a cascade only opens its first tile here, revealing is set then and the rest
+		// of the flood comes in through takeChanges as update() opens it.
+		const ChangeSet& applyMoves(const Move* moves, size_t count) {
+			moveChanges.clear();
+			moveChanges.stateBefore = state;
+			if (moveSink) {
+				moveSink->forward(moves, count);
+				moveChanges.state = state;
+				return moveChanges;
+			}
+			recordingMove = true;
+			bool hitBomb = false, batched = false;
+			//Cascades the moves since finished count as done, as they do once a slice ran past them,
+			//a replay gets no slice for them and still has to see them done
+			if (!reveals.empty()) {
+				reveals.skipOpened(board.getRegions(), [this](size_t index) {
+					return board.getState(index / sizeConfig.cols, index % sizeConfig.cols) == TileState::Closed;
 					});
 			}
+			bool cascading = !reveals.empty(), placing = firstMove;
+			size_t clicksBefore = clicks;
+			//Keyframes only between cascades, a pending cascade isn't part of the tile states
+			if (recorder.keyframeDue() && reveals.empty() && state == GameState::Ongoing)
+				writeKeyframe();
+			for (size_t i = 0; i < count && !hitBomb && state == GameState::Ongoing; i++) {
+				const Move& move = moves[i];
+				bool wasFirstMove = firstMove;
+				size_t changesBefore = moveChanges.opened.size() + moveChanges.flagged.size() + moveChanges.unflagged.size();
+				switch (move.type) {
+				case MoveType::Open:
+					hitBomb = openSeed(move.row, move.column);
+					break;
+				case MoveType::Flag:
+					flipFlag(move.row, move.column);
+					break;
+				case MoveType::Chord:
+					hitBomb = chord(move.row, move.column);
+					break;
+				}
+				//A move that changed nothing, like a chord without enough flags, is no click and isn't
+				//recorded, a replay position stays the number of clicks
+				if (moveChanges.opened.size() + moveChanges.flagged.size() + moveChanges.unflagged.size() == changesBefore)
+					continue;
+				clicks++;
+				if (recorder.isOpen()) {
+					if (wasFirstMove && !firstMove)
+						recordMines();
+					recorder.move(move.row, move.column, (uint8_t)move.type, batched, (uint32_t)((GetTime() - startTime) * 1000.0));
+				}
+				batched = true;
+			}
+			openSeedRegions();
+			if (hitBomb) {
+				//The pending cascades open to the end as they would have with instant reveal, right away
+				//instead of on the next update, so a replay opens them at the same point
+				reveals.run(board.getRegions(), SIZE_MAX, SIZE_MAX, [this](size_t index) { return openCascadeTile(index); }, []() { return false; });
+				state = GameState::Lost;
+				endTime = GetTime();
+			}
+			else if (state == GameState::Ongoing && checkWin())
+				state = GameState::Won;
+			recordingMove = false;
+			moveChanges.state = state;
+			moveChanges.revealing = !reveals.empty();
+			//A batch that changed nothing leaves the one before it to undo
+			if (clicks != clicksBefore) {
+				undoable = !cascading && !placing;
+				if (undoable)
+					undoChanges = moveChanges;
+			}
+			return moveChanges;
 		}
-		
-		void hoverAdjacent(size_t row, size_t col, bool pushed) {
-			board.loopAdjTiles(row, col, [&pushed](Tile& tile){
-				if (tile.getState() == TileState::Closed) {
-					tile.setHeldDown(pushed);
+
+		const ChangeSet& applyMoves(const std::vector<Move>& moves) {
+			return applyMoves(moves.data(), moves.size());
+		}
+
+		// Takes back the last batch of moves that changed a tile, the tiles its cascades opened
+		// since included, and a loss with it. The clicks stay counted. There is nothing to undo
+		// after the first move, which placed the mines around it, after a win, on a mirror, or when
+		// the batch came while a cascade of an earlier one was still opening. Returns false then.
+		bool undo() {
+			if (!undoable || moveSink || state == GameState::Won)
+				return false;
+			undoable = false;
+			reveals.clear();
+			for (size_t index : undoChanges.opened) {
+				size_t row = index / sizeConfig.cols;
+				size_t col = index % sizeConfig.cols;
+				board.setState(row, col, TileState::Closed);
+				if (!board[row][col].isBomb()) {
+					openedSafe--;
+					countSolved(row, col, -1);
+				}
+				pendingChanges.closed.push_back(index);
+				recorder.touched(index);
+			}
+			//Every flag move flips a tile, flipping each once more in any order puts them back
+			for (const std::vector<size_t>* flips : { &undoChanges.flagged, &undoChanges.unflagged }) {
+				for (size_t index : *flips) {
+					size_t row = index / sizeConfig.cols;
+					size_t col = index % sizeConfig.cols;
+					if (board.getState(row, col) == TileState::Flagged) {
+						board.setState(row, col, TileState::Closed);
+						++bombCount;
+						pendingChanges.unflagged.push_back(index);
 					}
-				});
+					else {
+						board.setState(row, col, TileState::Flagged);
+						--bombCount;
+						pendingChanges.flagged.push_back(index);
+					}
+					recorder.touched(index);
+				}
+			}
+			state = undoChanges.stateBefore;
+			if (recorder.isOpen())
+				recorder.undo();
+			return true;
 		}
-		
-	private:
-		int bombCount;
-		double startTime, endTime;
-		Board board;
-		GameState state;
-		SizeConfig& sizeConfig;
-		Matrix<Rectangle> tiles;
-		Button tryAgainButton, homeButton, continueButton;
-	};
 
-	class Menu {
-	public:
+		bool canUndo() const {
+			return undoable && !moveSink && state != GameState::Won;
+		}
 
-		Menu(SizeConfig const& conf) : buttons{}, sizeConfig{ conf } {
-			float btnVertPadd = 30.0f;
-			float menuBtnWidth = 350.0f;
-			float menuBtnHeight = 90.0f;
-			const char* menuText[MENU_BUTTONS] = { "Play", "Settings", "How to play" };
-			GameScreen menuScreens[MENU_BUTTONS] = { GameScreen::GAMEPLAY , GameScreen::SETTINGS, GameScreen::HOW_TO };
-			float menuHeight = (MENU_BUTTONS * menuBtnHeight) + (MENU_BUTTONS - 1) * btnVertPadd;
+		// Everything that changed since the last call, cascade slices run by update() included.
+		// The buffers are swapped, so taking every frame into the same set doesn't allocate.
+		void takeChanges(ChangeSet& out) {
+			pendingChanges.revealing = !reveals.empty();
+			std::swap(out, pendingChanges);
+			pendingChanges.clear();
+			reserveChanges(pendingChanges);
+		}
 
-			for (int i = 0; i < MENU_BUTTONS; i++)
-			{
-				float x = (sizeConfig.screenWidth - menuBtnWidth) / 2;
-				float y = (sizeConfig.screenHeight / 2) - (menuHeight / 2) + (i * (btnVertPadd + menuBtnHeight));
-				buttons[i] = Button{ menuText[i], {x, y, menuBtnWidth, menuBtnHeight}, menuScreens[i]};
-			}
+		// The first move is made and the game is not over, from here on a frame must not allocate
+		bool isInProgress() const {
+			return state == GameState::Ongoing && !firstMove;
 		}
 
-		Button& getButton(size_t index)  {
-			return buttons[index];
+		// Capacity every change set needs for one frame. A cascade that opens more than
+		// maxReservedChanges tiles at once grows the lists once, the capacity stays with the game.
+		size_t changeCapacity() const {
+			size_t tileCount = std::min(sizeConfig.rows * sizeConfig.cols, maxReservedChanges);
+			if (revealTileBudget == 0 && revealSecondBudget == 0)
+				return tileCount;
+			return std::min(tileCount, revealTileBudget + 9);
 		}
 
-		Button getButton(size_t index) const {
-			return buttons[index];
+		void setFirstClickSafe(bool safe) { firstClickSafe = safe; }
+		bool isFirstClickSafe() const { return firstClickSafe; }
+
+		// Every game started from here on is recorded to path, an empty path stops recording
+		void setReplayFile(std::string path) {
+			replayPath = std::move(path);
+			if (replayPath.empty())
+				recorder.close();
 		}
 
-		size_t size() const {
-			return MENU_BUTTONS;
+		// Plays back on the mine layout of a replay. Recording pauses and nothing moves on its own,
+		// the replay applies the moves and cascade slices itself.
+		template<typename Mines>
+		void startReplay(size_t rows, size_t cols, const Mines& layout, bool instantReveal) {
+			recorder.suspend();
+			replaying = true;
+			savedFirstClickSafe = firstClickSafe;
+			savedRevealTiles = revealTileBudget;
+			savedRevealSeconds = revealSecondBudget;
+			//The layout already has the first click cleared
+			firstClickSafe = false;
+			setRevealBudget(instantReveal ? 0 : SIZE_MAX);
+			loadLayout(rows, cols, layout, [](auto) {});
+			startTime = GetTime();
 		}
 
-	
-	private:
-		static const int MENU_BUTTONS = 3;
-		std::array<Button, MENU_BUTTONS> buttons;
-		
-		SizeConfig const& sizeConfig;
-	};
+		// Back to normal play on the position the replay was left at, recording goes on
+		void stopReplay() {
+			if (!replaying)
+				return;
+			replaying = false;
+			firstClickSafe = savedFirstClickSafe;
+			setRevealBudget(savedRevealTiles, savedRevealSeconds);
+			recorder.resume();
+		}
 
-	class TextBox {
-	public:
-		TextBox() = default;
-		TextBox(Rectangle rect) : rect{ rect }, mouseOnBox{ false }, letterCount{0} {}
+		bool isReplaying() const { return replaying; }
 
-		const Rectangle& getRect() const {
-			return rect;
+		// Mirrors the game of a co-op host: moves, resets and continues go to sink, what the host
+		// changed comes in through setRemoteState. The mines follow with setMirrorLayout once the
+		// host's first click placed them.
+		void startMirror(size_t rows, size_t cols, size_t mines, MoveSink* sink) {
+			recorder.close();
+			moveSink = nullptr;
+			loadLayout(rows, cols, std::vector<uint64_t>{}, [](auto) {});
+			bombCount = mines;
+			startTime = GetTime();
+			moveSink = sink;
+			mirrorMines = false;
 		}
-		bool isOn() const {
-			return mouseOnBox;
+
+		// The host's mines once its game is over, the tiles the host sent so far are kept
+		template<typename Mines>
+		void setMirrorLayout(const Mines& layout) {
+			std::vector<std::pair<size_t, TileState>> kept;
+			for (size_t index = 0; index < sizeConfig.rows * sizeConfig.cols; index++) {
+				TileState tileState = board.getState(index / sizeConfig.cols, index % sizeConfig.cols);
+				if (tileState != TileState::Closed)
+					kept.push_back({ index, tileState });
+			}
+			double started = startTime, ended = endTime;
+			size_t moves = clicks;
+			GameState mirrored = state;
+			loadLayout(sizeConfig.rows, sizeConfig.cols, layout, [&kept](auto set) {
+				for (const auto& [index, tileState] : kept)
+					set(index, tileState);
+				});
+			startTime = started;
+			endTime = ended;
+			clicks = moves;
+			firstMove = moves == 0;
+			state = mirrored;
+			mirrorMines = true;
 		}
 
-		void setMouseOn(bool state) {
-			mouseOnBox = state;
+		// The hint the host sent with an opened tile, a mirror has no mines to work it out from
+		void setRemoteHint(size_t index, int value, bool mine) {
+			Tile& tile = board[index / sizeConfig.cols][index % sizeConfig.cols];
+			tile = Tile{ mine ? 0 : value, mine, tile.getState() };
 		}
 
-		int getLetterCount() const {
-			return letterCount;
+		bool isMirror() const { return moveSink != nullptr; }
+
+		// A tile as the co-op host has it now, the counters follow as for a local move
+		void setRemoteState(size_t index, TileState tileState) {
+			size_t row = index / sizeConfig.cols;
+			size_t col = index % sizeConfig.cols;
+			TileState before = board.getState(row, col);
+			if (before == tileState)
+				return;
+			bool safe = !board[row][col].isBomb();
+			if (before == TileState::Flagged) {
+				++bombCount;
+				pendingChanges.unflagged.push_back(index);
+			}
+			else if (before == TileState::Open && safe) {
+				openedSafe--;
+				if (mirrorMines)
+					countSolved(row, col, -1);
+			}
+			board.setState(row, col, tileState);
+			if (tileState == TileState::Open) {
+				if (safe) {
+					openedSafe++;
+					//Without the mines there are no openings to count, the layout brings the count
+					if (mirrorMines)
+						countSolved(row, col, 1);
+				}
+				pendingChanges.opened.push_back(index);
+			}
+			else if (tileState == TileState::Flagged) {
+				--bombCount;
+				pendingChanges.flagged.push_back(index);
+			}
+			else if (before == TileState::Open)
+				pendingChanges.closed.push_back(index);
 		}
 
-		TextBox& operator++() {
-			letterCount++;
-			return *this;
+		void setRemoteProgress(GameState remoteState, size_t remoteClicks) {
+			if (remoteState != state && remoteState != GameState::Ongoing)
+				endTime = GetTime();
+			state = remoteState;
+			clicks = remoteClicks;
+			firstMove = remoteClicks == 0;
 		}
-		TextBox& operator--() {
-			letterCount--;
-			return *this;
+
+		// The first move placed the mines for good
+		bool hasStarted() const { return !firstMove; }
+
+		// Replaces every tile state, load(set) calls set(index, TileState) for the tiles that
+		// aren't closed. moves is the number of moves that led there.
+		template<typename Load>
+		void restoreStates(GameState restored, size_t moves, Load load) {
+			board.closeAll();
+			bombCount = board.getBombs();
+			openedSafe = 0;
+			resetLiveMetrics();
+			reveals.clear();
+			undoable = false;
+			pendingChanges.clear();
+			pendingChanges.reset = true;
+			reserveBuffers();
+			load([this](size_t index, TileState tileState) {
+				size_t row = index / sizeConfig.cols;
+				size_t col = index % sizeConfig.cols;
+				board.setState(row, col, tileState);
+				if (tileState == TileState::Flagged) {
+					--bombCount;
+					pendingChanges.flagged.push_back(index);
+					return;
+				}
+				if (!board[row][col].isBomb()) {
+					openedSafe++;
+					countSolved(row, col, 1);
+				}
+				pendingChanges.opened.push_back(index);
+				});
+			state = restored;
+			firstMove = moves == 0;
+			clicks = moves;
+			endTime = GetTime();
 		}
 
-		void addInput(char c, int index) {
-			if (index < MAX_INPUT_CHARS && index >= 0)
-				inputDim[index] = c;
+		Rectangle getTileRect(size_t row, size_t col) const {
+			float step = sizeConfig.tileSize + sizeConfig.tilePadding;
+			return { boardOrigin.x + col * step, boardOrigin.y + row * step, sizeConfig.tileSize, sizeConfig.tileSize };
+		}
+		Tile& getTile(size_t row, size_t col) const {
+			return board[row][col];
+		}
+		GameState getGameState() const { return state; }
+		TileState getTileState(size_t row, size_t col) const {
+			return board.getState(row, col);
 		}
+		TileState getTileRenderState(size_t row, size_t col) const {
+			const Tile& tile = board[row][col];
+			TileState tileState = board.getState(row, col);
 
-		void setLetterCount(int count) {
-			letterCount = count;
+			if (tileState == TileState::Open) {
+				if (tile.isBomb()) {
+					return TileState::Bomb;
+				}
+				return TileState::Open;
+			}
+			if (tile.isHeldDown())
+				return TileState::HeldDown;
+			return tileState;
+		}
+		size_t getBombs() const { return bombCount; }
+		size_t getBombTotal() const { return board.getBombs(); }
+		uint32_t getSeed() const { return board.getSeed(); }
+		// Played on after a mine went off, such a win doesn't count as a record
+		bool wasContinued() const { return continued; }
+
+		// Sorted mine positions, replays and co-op send the gaps between them
+		const std::vector<size_t>& getMineLayout() {
+			minePositions.clear();
+			for (size_t index : board.getBombPositions()) {
+				if (board[index / sizeConfig.cols][index % sizeConfig.cols].isBomb())
+					minePositions.push_back(index);
+			}
+			//A mine moved by the first click may come back to a position that is still listed
+			std::sort(minePositions.begin(), minePositions.end());
+			minePositions.erase(std::unique(minePositions.begin(), minePositions.end()), minePositions.end());
+			return minePositions;
+		}
+		size_t getRows() const { return sizeConfig.rows; }
+		size_t getCols() const { return sizeConfig.cols; }
+		double getGameTime() const {
+			if(state == GameState::Won || state == GameState::Lost)
+				return endTime - startTime;
+			return GetTime() - startTime;
 		}
 
-		const char* getInput() {
-			return inputDim;
+		const BoardMetrics& getBoardMetrics() const { return board.getMetrics(); }
+		size_t getClicks() const { return clicks; }
+		// 3BV of the openings and isolated numbers opened so far
+		size_t getSolvedBBBV() const { return solvedBBBV; }
+
+		double getBBBVPerSecond() const {
+			double time = getGameTime();
+			return time > 0.0 ? solvedBBBV / time : 0.0;
 		}
 
-		int getInput_int() {
-			
-			int num1 = inputDim[0] - '0'; // 4
-			if (letterCount == 1)
-				return num1;
-			int num2 = inputDim[1] - '0'; // 7
-			
+		// Solved 3BV per click, 1 is a perfect game
+		double getEfficiency() const {
+			return clicks > 0 ? (double)solvedBBBV / clicks : 0.0;
+		}
+		const Button& getTryAgainButton() const {
+			return tryAgainButton;
+		}
+		const Button& getHomeButton() const {
+			return homeButton;
+		}
+		const Button& getContinueButton() const{
+			return continueButton;
+		}
+		
+		void fastOpen(size_t row, size_t col) {
+			Move move{ row, col, MoveType::Chord };
+			applyMoves(&move, 1);
+		}
 
-			return num1 * 10 + num2;
+		// A chord on the tile would open its neighbors, the flags around it match its hint
+		bool isChordReady(size_t row, size_t col) const {
+			return board.getState(row, col) == TileState::Open && board.getAdjacentFlags(row, col) == board[row][col].getValue();
 		}
 
+		bool isSatisfied(size_t row, size_t col) const {
+			return board.isSatisfied(row, col);
+		}
 
-		static const int MAX_INPUT_CHARS = 2;
+		// The kept flag counts around every tile match a recount, for the headless checks
+		bool checkAdjacentFlags() const {
+			return board.checkAdjacentFlags();
+		}
+		
+		void hoverAdjacent(size_t row, size_t col, bool pushed) {
+			board.loopAdjTiles(row, col, [this, &pushed](size_t newRow, size_t newCol){
+				if (board.getState(newRow, newCol) == TileState::Closed) {
+					board[newRow][newCol].setHeldDown(pushed);
+					}
+				});
+		}
+		
 	private:
-		Rectangle rect;
-		bool mouseOnBox;
-		int letterCount;
-	
-		char inputDim[MAX_INPUT_CHARS + 1] = "\0";
-	};
+		void setOpen(size_t row, size_t col) {
+			if (board.getState(row, col) == TileState::Open)
+				return;
+			board.setState(row, col, TileState::Open);
+			if (!board[row][col].isBomb()) {
+				openedSafe++;
+				countSolved(row, col, 1);
+			}
+			size_t index = row * sizeConfig.cols + col;
+			pendingChanges.opened.push_back(index);
+			recorder.touched(index);
+			if (recordingMove)
+				moveChanges.opened.push_back(index);
+			else if (undoable)
+				undoChanges.opened.push_back(index);
+		}
 
-	class Settings {
-	public:
-		Settings(SizeConfig& conf) : sizeConfig{ conf }, difficulty{Difficulty::Easy} {
-			const char* enterText = "Enter the size of the board:";
-			int enterTextWidth = MeasureText(enterText, 20);
+		// Opening the first zero of an opening or an isolated number solves one 3BV, closing it again
+		// (a host's state reaching a co-op client) passes -1
+		void countSolved(size_t row, size_t col, int delta) {
+			const Tile& tile = board[row][col];
+			if (tile.getValue() != 0) {
+				if (!board.touchesOpening(row, col))
+					solvedBBBV += delta;
+				return;
+			}
+			uint64_t region = board.getRegions().regionOf(row * sizeConfig.cols + col);
+			if (region >= regionOpened.size())
+				reserveRegions(board.getRegions().size());
+			uint64_t& opened = regionOpened.get()[region];
+			if (opened == 0) {
+				//A region closed and opened again is listed twice, past the capacity the whole plane is cleared on reset
+				if (touchedCount < touchedRegions.size())
+					touchedRegions.get()[touchedCount++] = region;
+				else
+					touchedOverflow = true;
+			}
+			opened += delta;
+			if ((delta > 0 && opened == 1) || (delta < 0 && opened == 0))
+				solvedBBBV += delta;
+		}
 
-			Rectangle textBoxRow = { sizeConfig.screenWidth / 2.0f - (enterTextWidth / 2) , 180, 100, 50 };
-			float padTextBox = enterTextWidth - textBoxRow.width * 2;
-			Rectangle textBoxCol = { textBoxRow.x + padTextBox + textBoxRow.width, textBoxRow.y, textBoxRow.width, textBoxRow.height };
-			rowsBox = { textBoxRow };
-			colsBox = { textBoxCol };
-			playButton = { (const char*)"Play!", {sizeConfig.screenWidth / 2.0f- 175.0f,400,350,90 }, GameScreen::GAMEPLAY };
+		// A new replay file for the game that starts now
+		void beginRecording() {
+			if (replayPath.empty() || replaying)
+				return;
+			ReplayHeader header;
+			header.rows = sizeConfig.rows;
+			header.cols = sizeConfig.cols;
+			header.mines = (uint64_t)board.getBombs();
+			header.seed = board.getSeed();
+			//A keyframe costs about a byte per run of tiles, bigger boards take them less often
+			header.keyframeInterval = (uint32_t)std::clamp<size_t>(sizeConfig.rows * sizeConfig.cols / 1024, minKeyframeInterval, maxKeyframeInterval);
+			header.instantReveal = revealTileBudget == 0 && revealSecondBudget == 0;
+			if (!recorder.open(replayPath, header))
+				std::cerr << "Failed to create replay file " << replayPath << std::endl;
+		}
 
-			float buttonPosY = 250;
-			easy = { (const char*)"Easy", {sizeConfig.screenWidth / 2.0f - 175.0f -360.0f,buttonPosY,350,90 }, GameScreen::SETTINGS,  {0, 119, 0, 255} };
-			medium = { (const char*)"Medium", {sizeConfig.screenWidth / 2.0f - 175.0f,buttonPosY,350,90 }, GameScreen::SETTINGS, {0,0,255,255} };
-			hard = { (const char*)"Hard", {sizeConfig.screenWidth / 2.0f - 175.0f+360.0f,buttonPosY,350,90 }, GameScreen::SETTINGS, RED };
+		void recordMines() {
+			recorder.mines(getMineLayout());
+		}
 
+		// A board with exactly the mines of layout, every tile closed but the ones load sets
+		template<typename Mines, typename Load>
+		void loadLayout(size_t rows, size_t cols, const Mines& layout, Load load) {
+			board.resize(rows, cols);
+			sizeConfig.rows = rows;
+			sizeConfig.cols = cols;
+			sizeConfig.update();
+			board.setMines(layout);
+			initTiles();
+			restoreStates(GameState::Ongoing, 0, load);
 		}
 
-		TextBox& getDimBoxes(size_t dim) {
-			if (dim == 0)
-				return rowsBox;
-			return colsBox;
+		// Reads only the tiles changed since the keyframe before unless a sixteenth of the board changed
+		void writeKeyframe() {
+			recorder.keyframe((uint8_t)state, sizeConfig.rows * sizeConfig.cols, [this](size_t index) {
+				TileState tileState = board.getState(index / sizeConfig.cols, index % sizeConfig.cols);
+				if (tileState == TileState::Open)
+					return ReplayTile::Opened;
+				if (tileState == TileState::Flagged)
+					return ReplayTile::Flagged;
+				return ReplayTile::Closed;
+				});
 		}
 
-		const TextBox& getDimBoxes(size_t dim) const {
-			if (dim == 0)
-				return rowsBox;
-			return colsBox;
+		// Sizes the buffers filled during a game up front, so playing doesn't allocate
+		void reserveBuffers() {
+			reserveChanges(moveChanges);
+			reserveChanges(pendingChanges);
+			//The batch to undo collects the slices of its cascades too, so it gets room for a whole flood
+			reserveChanges(undoChanges);
+			undoChanges.opened.reserve(std::min(sizeConfig.rows * sizeConfig.cols, maxReservedChanges));
+			reserveRegions(board.getRegions().size());
+			seedRegions.reserve(9);
 		}
-	
-		bool isOnBox(TextBox const& box) const {
-			return box.isOn();
+
+		// The per region planes only grow, opened counts are kept. The headroom covers the regions a
+		// first click adds, so it doesn't copy them.
+		void reserveRegions(size_t regionCount) {
+			if (regionOpened.size() >= regionCount)
+				return;
+			regionCount += regionHeadroom;
+			BoardStorage<uint64_t> grown;
+			grown.resize(regionCount);
+			std::copy(regionOpened.get(), regionOpened.get() + regionOpened.size(), grown.get());
+			regionOpened = std::move(grown);
+			grown.resize(regionCount);
+			std::copy(touchedRegions.get(), touchedRegions.get() + touchedCount, grown.get());
+			touchedRegions = std::move(grown);
 		}
 
-		const Button& getPlayButton() const{
-			return playButton;
+		void reserveChanges(ChangeSet& changes) const {
+			size_t capacity = changeCapacity();
+			changes.opened.reserve(capacity);
+			//Tiles only close again when a lost game goes on, the mines that were hit, or a move is undone
+			changes.closed.reserve(16);
+			changes.flagged.reserve(16);
+			changes.unflagged.reserve(16);
 		}
 
-		 Button& getDifficultyButton(Difficulty d) {
-			if (d == Difficulty::Easy)
-				return easy;
-			if (d == Difficulty::Medium)
-				return medium;
-		
-				return hard;
+		// Only the regions opened last game are cleared, so a reset stays cheap
+		void resetLiveMetrics() {
+			uint64_t* opened = regionOpened.get();
+			if (touchedOverflow)
+				std::fill(opened, opened + regionOpened.size(), 0);
+			else {
+				for (size_t k = 0; k < touchedCount; k++)
+					opened[touchedRegions.get()[k]] = 0;
+			}
+			touchedCount = 0;
+			touchedOverflow = false;
+			clicks = 0;
+			solvedBBBV = 0;
 		}
 
-		 const Button& getDifficultyButton(Difficulty d) const {
-			 if (d == Difficulty::Easy)
-				 return easy;
-			 if (d == Difficulty::Medium)
-				 return medium;
-				 return hard;
-		 }
+		void flipFlag(size_t row, size_t col) {
+			//The cascade already reached this tile, it is about to be opened
+			if (isRevealPending(row, col))
+				return;
+			size_t index = row * sizeConfig.cols + col;
+			if (board.getState(row, col) == TileState::Flagged) {
+				board.setState(row, col, TileState::Closed);
+				++bombCount;
+				pendingChanges.unflagged.push_back(index);
+				moveChanges.unflagged.push_back(index);
+				recorder.touched(index);
+				return;
+			}
+			if (board.getState(row, col) == TileState::Closed) {
+				board.setState(row, col, TileState::Flagged);
+				--bombCount;
+				pendingChanges.flagged.push_back(index);
+				moveChanges.flagged.push_back(index);
+				recorder.touched(index);
+			}
+		}
 
-		Difficulty getDifficulty()const {
-			return difficulty;
+		// Opens one tile of a move, returns true if it was a bomb. Zero tiles only queue their
+		// cascade, the floods of a whole batch run together in openSeedRegions or in update().
+		bool openSeed(size_t row, size_t col) {
+			if (board.getState(row, col) != TileState::Closed)
+				return false;
+			if (firstMove) {
+				firstMove = false;
+				if (firstClickSafe) {
+					//Moving the mines relabels the regions, their count may have grown
+					board.clearArea(row, col);
+					reserveBuffers();
+				}
+			}
+			Tile& tile = board[row][col];
+			setOpen(row, col);
+			if (tile.isBomb())
+				return true;
+			if (tile.getValue() != 0)
+				return false;
+
+			uint64_t region = board.getRegions().regionOf(row * sizeConfig.cols + col);
+			if (revealTileBudget > 0 || revealSecondBudget > 0) {
+				reveals.start(region);
+				return false;
+			}
+			if (std::find(seedRegions.begin(), seedRegions.end(), region) == seedRegions.end())
+				seedRegions.push_back(region);
+			return false;
 		}
 
-		void setDifficulty(Difficulty diff) {
-			difficulty = diff;
+		bool chord(size_t row, size_t col) {
+			if (board.getState(row, col) != TileState::Open)
+				return false;
+			if (board.getAdjacentFlags(row, col) != board[row][col].getValue())
+				return false;
+
+			bool hitBomb = false;
+			board.loopAdjTiles(row, col, [this, &hitBomb](size_t newRow, size_t newCol) {
+				if (board.getState(newRow, newCol) == TileState::Closed)
+					hitBomb |= openSeed(newRow, newCol);
+				});
+			return hitBomb;
 		}
 
-	
-	private:
-		SizeConfig& sizeConfig;
-		TextBox rowsBox, colsBox;
-		Button playButton;
-		Button easy, medium, hard;
-		Difficulty difficulty;
-	};
+		// Opens the zero regions queued by the moves of a batch at once from their precomputed spans
+		void openSeedRegions() {
+			const BoardRegions& regions = board.getRegions();
+			for (uint64_t region : seedRegions) {
+				regions.forEachSpan(region, [this](BoardRegions::Span span) {
+					for (size_t index : span) {
+						size_t row = index / sizeConfig.cols;
+						size_t col = index % sizeConfig.cols;
+						if (board.getState(row, col) == TileState::Closed)
+							setOpen(row, col);
+					}
+					});
+			}
+			seedRegions.clear();
+		}
 
-	class InputHandler {
+		// Opens a tile of a cascade unless it was opened or flagged meanwhile
+		bool openCascadeTile(size_t index) {
+			size_t row = index / sizeConfig.cols;
+			size_t col = index % sizeConfig.cols;
+			if (board.getState(row, col) != TileState::Closed)
+				return false;
+			setOpen(row, col);
+			return true;
+		}
+
+		int64_t bombCount;
+		double startTime, endTime;
+		Board board;
+		GameState state;
+		SizeConfig& sizeConfig;
+		Vector2 boardOrigin{};
+		Button tryAgainButton, homeButton, continueButton;
+		bool firstMove = true;
+		bool continued = false;
+		//A mirror got the host's mines, they only come once the host's game is over
+		bool mirrorMines = true;
+		bool firstClickSafe = true;
+		size_t openedSafe = 0;
+		RevealScheduler reveals;
+		size_t revealTileBudget = 4096;
+		double revealSecondBudget = 0.004;
+		ChangeSet moveChanges, pendingChanges;
+		//The last batch that changed a tile and the cascade slices that followed it
+		ChangeSet undoChanges;
+		bool undoable = false;
+		bool recordingMove = false;
+		std::vector<uint64_t> seedRegions;
+		BoardPool<Board>* boardPool = &BoardPool<Board>::shared();
+		BoardPool<Board>::Setting pooled;
+		size_t clicks = 0;
+		size_t solvedBBBV = 0;
+		//Opened zero tiles per region and the regions that have any, so a reset only clears those
+		BoardStorage<uint64_t> regionOpened;
+		BoardStorage<uint64_t> touchedRegions;
+		size_t touchedCount = 0;
+		bool touchedOverflow = false;
+		static constexpr size_t regionHeadroom = 64;
+		static constexpr size_t minKeyframeInterval = 64, maxKeyframeInterval = 4096;
+		static constexpr size_t maxReservedChanges = size_t(1) << 16;
+		ReplayWriter recorder;
+		std::string replayPath;
+		std::vector<size_t> minePositions;
+		bool replaying = false;
+		bool savedFirstClickSafe = true;
+		size_t savedRevealTiles = 0;
+		double savedRevealSeconds = 0.0;
+		MoveSink* moveSink = nullptr;
+	};
+
+	// Steps and scrubs through a replay file on a Game. A seek restores the last keyframe before
+	// the target and applies the few moves after it, stepping forward only applies the next ones.
+	class ReplayViewer {
 	public:
-		InputHandler(SizeConfig& conf) : mousePoint{}, sizeConfig{conf} {};
-		
-		GameScreen handleGameInput(Game& game) {
-			
+		bool open(const std::string& path, Game& game) {
+			if (!reader.open(path))
+				return false;
+			if (reader.isTruncated())
+				std::cerr << "Replay " << path << " ends early, playing what was saved" << std::endl;
+			const ReplayHeader& header = reader.getHeader();
+			game.startReplay((size_t)header.rows, (size_t)header.cols, reader.getMines(), header.instantReveal);
+			position = 0;
+			active = true;
+			return true;
+		}
 
-			if (game.getGameState() != GameState::Ongoing && IsMouseButtonReleased(MOUSE_BUTTON_LEFT)) {
-				if (CheckCollisionPointRec(mousePoint, game.getTryAgainButton().getButtonRect()) && game.getGameState() == GameState::Won) {
-					game.resetGame();
-					return GameScreen::GAMEPLAY;
-				}
-				if (CheckCollisionPointRec(mousePoint, game.getContinueButton().getButtonRect()) && game.getGameState() == GameState::Lost) {
-					game.continueGame();
-					return GameScreen::GAMEPLAY;
+		// Leaves the game at the end of the replay
+		void close(Game& game) {
+			if (!active)
+				return;
+			seek(game, getMoveCount());
+			game.stopReplay();
+			active = false;
+		}
+
+		// State after the first target moves and the cascade slices that followed them. A batch
+		// is played as a whole, a target inside one moves to its end or with back to its start.
+		void seek(Game& game, uint64_t target, bool back = false) {
+			target = std::min(target, getMoveCount());
+			while (reader.continuesBatch(target))
+				back ? target-- : target++;
+			const ReplayKeyframe* keyframe = reader.keyframeAtOrBefore(target);
+			uint64_t from = reader.eventOfMove(position);
+			if (target < position || (keyframe && keyframe->position > position)) {
+				if (keyframe && restore(game, *keyframe)) {
+					from = keyframe->event;
 				}
-				if (CheckCollisionPointRec(mousePoint, game.getHomeButton().getButtonRect())) {
-					game.resetGame();
-					return GameScreen::TITLE;
+				else {
+					game.restoreStates(GameState::Ongoing, 0, [](auto) {});
+					from = 0;
 				}
 			}
-			for (int row = 0; row < sizeConfig.rows ; row++)
-			{
-				for (size_t col = 0; col < sizeConfig.cols; col++)
-				{
-					Tile& currentTile = game.getTile(row, col);
-					if (CheckCollisionPointRec(mousePoint, game.getTileRect(row, col)))
-					{
-						//Hover effect when holding down mouse
-						if (IsMouseButtonDown(MOUSE_BUTTON_LEFT) && currentTile.getState() != TileState::Flagged ) {
-						
-							if (currentTile.getState() == TileState::Open) {
-								game.hoverAdjacent(row, col, true);
-								return GameScreen::GAMEPLAY;
-							}
-							else if (currentTile.getState() == TileState::Closed) {
-								game.toggleHeldDown(row, col, true);
-							}		
-						}
-						if(IsMouseButtonReleased(MOUSE_BUTTON_LEFT)){
-							//Open by clicking on an already open tile
-							if(currentTile.getState() == TileState::Open) {
-								game.toggleHeldDown(row, col, false); 
-								game.hoverAdjacent(row, col, false);
-								game.fastOpen(row, col);
-							}
-							//Open tile by clikcing on closed tile
-							if (currentTile.getState() != TileState::Flagged && game.getGameState() == GameState::Ongoing) {
-								//game.toggleHeldDown(row, col, false); 
-								game.hoverAdjacent(row, col, false);
-								game.openTile(row, col);
-							}
-						}
-						//Put down a flag
-						if (IsMouseButtonPressed(MOUSE_BUTTON_RIGHT) && game.getGameState() == GameState::Ongoing)
-							game.toggleFlag(row, col);
-					}
-					else {
-						game.toggleHeldDown(row, col, false);
+			apply(game, from, reader.eventOfMove(target));
+			position = target;
+		}
+
+		void step(Game& game, int64_t moves) {
+			if (moves < 0 && (uint64_t)-moves > position)
+				seek(game, 0);
+			else
+				seek(game, position + moves, moves < 0);
+		}
+
+		bool isActive() const { return active; }
+		uint64_t getPosition() const { return position; }
+		uint64_t getMoveCount() const { return reader.getMoveCount(); }
+		uint32_t getKeyframeInterval() const { return reader.getHeader().keyframeInterval; }
+
+	private:
+		bool restore(Game& game, const ReplayKeyframe& keyframe) {
+			bool loaded = true;
+			game.restoreStates((GameState)keyframe.gameState, (size_t)keyframe.position, [&](auto set) {
+				loaded = reader.loadKeyframe(keyframe, [&set](uint64_t index, ReplayTile tile) {
+					set((size_t)index, tile == ReplayTile::Flagged ? TileState::Flagged : TileState::Open);
+					});
+				});
+			return loaded;
+		}
+
+		// Events [from, to), moves of one batch are applied together like they were played
+		void apply(Game& game, uint64_t from, uint64_t to) {
+			const std::vector<ReplayEvent>& events = reader.getEvents();
+			for (uint64_t i = from; i < to; i++) {
+				const ReplayEvent& event = events[i];
+				switch (event.type) {
+				case ReplayRecord::Move:
+					batch.clear();
+					batch.push_back({ (size_t)event.row, (size_t)event.col, (MoveType)event.moveType });
+					while (i + 1 < to && events[i + 1].type == ReplayRecord::Move && events[i + 1].batched) {
+						i++;
+						batch.push_back({ (size_t)events[i].row, (size_t)events[i].col, (MoveType)events[i].moveType });
 					}
+					game.applyMoves(batch);
+					break;
+				case ReplayRecord::Reveal:
+					game.runReveal((size_t)event.row);
+					break;
+				case ReplayRecord::Continue:
+					game.continueGame();
+					break;
+				case ReplayRecord::Undo:
+					game.undo();
+					break;
+				default:
+					break;
 				}
 			}
-			return GameScreen::GAMEPLAY;
 		}
-		GameScreen handleMenuInput(Menu& menu) {
 
+		ReplayReader reader;
+		uint64_t position = 0;
+		bool active = false;
+		std::vector<Move> batch;
+	};
 
-			for (size_t i = 0; i < menu.size(); i++)
-			{
-				Button& currentButton = menu.getButton(i);
-				if (CheckCollisionPointRec(mousePoint, currentButton.getButtonRect()) )
-				{
-					if (IsMouseButtonDown(MOUSE_BUTTON_LEFT))
-						currentButton.setHeldDown(true);
+	// Lets other instances play the game of this one over a loopback socket. The moves clients sent
+	// are applied once per frame as one batch, what the frame changed goes to every client as runs
+	// of tiles. A cascade costs a few bytes per board row however many tiles it opens.
+	class CoopHost {
+	public:
+		bool listen(const CoopAddress& address) { return listener.listen(address); }
+		bool isActive() const { return listener.isListening(); }
+		size_t getClientCount() const { return clients.size(); }
 
-					if (IsMouseButtonReleased(MOUSE_BUTTON_LEFT)) {
-						currentButton.setHeldDown(false);
-						if (sizeConfig.rows == 0 && currentButton.getScreen() == GameScreen::GAMEPLAY)
-							return GameScreen::SETTINGS;
-						return currentButton.getScreen();
+		// Bytes all clients together receive per move, the host's own moves included
+		double getBytesPerMove() const {
+			return streamMoves > 0 ? (double)streamBytes / streamMoves : 0.0;
+		}
+
+		// New clients and the moves they sent, called before the local input of the frame
+		void receive(Game& game) {
+			for (CoopConnection connection = listener.accept(); connection.isOpen(); connection = listener.accept())
+				addClient(std::move(connection), game);
+
+			moves.clear();
+			bool reset = false, resume = false;
+			for (Client& client : clients) {
+				client.connection.receive([&](CoopMessage type, const uint8_t* in, const uint8_t* end) {
+					uint64_t row, col;
+					switch (type) {
+					case CoopMessage::Move:
+						client.received++;
+						if (!replay_detail::getVarint(in, end, row) || !replay_detail::getVarint(in, end, col) || in == end)
+							return;
+						if (row < game.getRows() && col < game.getCols() && *in <= (uint8_t)MoveType::Chord)
+							moves.push_back({ (size_t)row, (size_t)col, (MoveType)*in });
+						break;
+					case CoopMessage::Reset:
+						reset = true;
+						break;
+					case CoopMessage::Continue:
+						resume = true;
+						break;
+					default:
+						break;
+					}
+					});
+			}
+			clients.erase(std::remove_if(clients.begin(), clients.end(), [](const Client& client) { return !client.connection.isOpen(); }), clients.end());
+
+			if (!moves.empty())
+				game.applyMoves(moves);
+			if (resume && game.getGameState() == GameState::Lost)
+				game.continueGame();
+			if (reset && game.getGameState() != GameState::Ongoing)
+				game.resetGame();
+		}
+
+		// A client that is already connected, the game as it is goes out to it right away
+		void addClient(CoopConnection&& connection, Game& game) {
+			clients.push_back({ std::move(connection) });
+			join(clients.back(), game);
+		}
+
+		// Sends what the frame changed, called with the changes the game handed out for the frame
+		void broadcast(Game& game, const ChangeSet& changes) {
+			if (changes.reset) {
+				layoutSent = false;
+				for (Client& client : clients)
+					sendJoin(client, game);
+			}
+			//The mines stay with the host while the game goes on, ahead of the changes that ended it
+			if (!layoutSent && game.getGameState() != GameState::Ongoing) {
+				encodeLayout(game);
+				size_t size = 0;
+				for (Client& client : clients)
+					size += client.connection.send(CoopMessage::Layout, body);
+				streamBytes += size;
+				layoutSent = true;
+			}
+
+			bool progressed = game.getGameState() != sentState || game.getClicks() != sentClicks;
+			bool pending = !changes.empty() || progressed;
+			for (const Client& client : clients)
+				pending = pending || client.received != client.acked;
+			if (pending) {
+				encodeChanges(game, { &changes.opened, &changes.closed, &changes.flagged, &changes.unflagged });
+				size_t size = 0;
+				for (Client& client : clients)
+					size += sendChanges(client);
+				//Cascade slices of later frames count for the move that started them
+				streamBytes += size;
+				if (size > 0 && game.getClicks() > sentClicks)
+					streamMoves += game.getClicks() - sentClicks;
+				sentState = game.getGameState();
+				sentClicks = game.getClicks();
+			}
+			for (Client& client : clients)
+				client.connection.flush();
+		}
+
+	private:
+		struct Client {
+			CoopConnection connection;
+			uint64_t received = 0, acked = 0;
+		};
+
+		// The game as it is: size and mine count, the mines if the game was over once, then the
+		// tiles that aren't closed if it has started
+		void join(Client& client, Game& game) {
+			sendJoin(client, game);
+			if (!game.hasStarted())
+				return;
+			if (layoutSent) {
+				encodeLayout(game);
+				client.connection.send(CoopMessage::Layout, body);
+			}
+			joinTiles.clear();
+			for (size_t index = 0; index < game.getRows() * game.getCols(); index++) {
+				if (game.getTileState(index / game.getCols(), index % game.getCols()) != TileState::Closed)
+					joinTiles.push_back(index);
+			}
+			encodeChanges(game, { &joinTiles });
+			sendChanges(client);
+			client.connection.flush();
+		}
+
+		void sendJoin(Client& client, const Game& game) {
+			body.clear();
+			replay_detail::putVarint(body, game.getRows());
+			replay_detail::putVarint(body, game.getCols());
+			replay_detail::putVarint(body, game.getBombTotal());
+			client.connection.send(CoopMessage::Join, body);
+		}
+
+		void encodeLayout(Game& game) {
+			const std::vector<size_t>& mines = game.getMineLayout();
+			body.clear();
+			replay_detail::putVarint(body, mines.size());
+			size_t previous = 0;
+			for (size_t index : mines) {
+				replay_detail::putVarint(body, index - previous);
+				previous = index;
+			}
+		}
+
+		// The listed tiles as the game has them now, a tile changed back and forth in one frame
+		// is sent in its final state only
+		void encodeChanges(const Game& game, std::initializer_list<const std::vector<size_t>*> lists) {
+			nowOpen.clear();
+			nowClosed.clear();
+			nowFlagged.clear();
+			for (const std::vector<size_t>* list : lists) {
+				for (size_t index : *list) {
+					switch (game.getTileState(index / game.getCols(), index % game.getCols())) {
+					case TileState::Open:
+						nowOpen.push_back(index);
+						break;
+					case TileState::Flagged:
+						nowFlagged.push_back(index);
+						break;
+					default:
+						nowClosed.push_back(index);
+						break;
 					}
 				}
-				else {
-					currentButton.setHeldDown(false);
+			}
+			size_t tileCount = game.getRows() * game.getCols();
+			body.clear();
+			body.push_back((uint8_t)game.getGameState());
+			replay_detail::putVarint(body, game.getClicks());
+			spans.encode(body, nowOpen, tileCount);
+			encodeHints(game);
+			spans.encode(body, nowClosed, tileCount);
+			spans.encode(body, nowFlagged, tileCount);
+		}
+
+		// Hints of the tiles of the open runs just encoded, in their order
+		void encodeHints(const Game& game) {
+			uint8_t low = 0;
+			bool half = false;
+			for (const std::pair<size_t, size_t>& run : spans.getRuns()) {
+				for (size_t index = run.first; index < run.first + run.second; index++) {
+					const Tile& tile = game.getTile(index / game.getCols(), index % game.getCols());
+					uint8_t hint = tile.isBomb() ? coopMineHint : (uint8_t)tile.getValue();
+					if (half)
+						body.push_back((uint8_t)(low | hint << 4));
+					low = hint;
+					half = !half;
 				}
 			}
-			return GameScreen::TITLE;
+			if (half)
+				body.push_back(low);
 		}
-		GameScreen handleSettingsInput(Settings& settings, Game& game) {
-			
-			if (CheckCollisionPointRec(mousePoint, settings.getPlayButton().getButtonRect())) {
-		
-				if (IsMouseButtonReleased(MOUSE_BUTTON_LEFT)) {
-					//If the user has entered the board dimensions
-					if (settings.getDimBoxes(0).getLetterCount() != 0 && settings.getDimBoxes(1).getLetterCount() != 0)
-						sizeConfig.rows = settings.getDimBoxes(0).getInput_int();
-						sizeConfig.cols = settings.getDimBoxes(1).getInput_int();
-						game.startGame(sizeConfig.rows, sizeConfig.cols, settings.getDifficulty());
-						return GameScreen::GAMEPLAY;
+
+		// The shared body behind the count of the client's own moves applied so far
+		size_t sendChanges(Client& client) {
+			head.clear();
+			replay_detail::putVarint(head, client.received);
+			client.acked = client.received;
+			return client.connection.send(CoopMessage::Changes, head.data(), head.size(), body.data(), body.size());
+		}
+
+		CoopListener listener;
+		std::vector<Client> clients;
+		std::vector<Move> moves;
+		SpanCoder spans;
+		std::vector<size_t> nowOpen, nowClosed, nowFlagged, joinTiles;
+		std::vector<uint8_t> head, body;
+		bool layoutSent = false;
+		GameState sentState = GameState::Ongoing;
+		size_t sentClicks = 0;
+		uint64_t streamBytes = 0, streamMoves = 0;
+	};
+
+	// Plays the game of a co-op host. The local game only mirrors the host's, moves made on it go
+	// to the host and come back with the changes of the frame the host applied them in.
+	class CoopClient : public MoveSink {
+	public:
+		bool connect(const CoopAddress& address) {
+			connection = CoopConnection::connect(address);
+			return connection.isOpen();
+		}
+
+		// Plays over a connection that is already open
+		bool connect(CoopConnection&& connected) {
+			connection = std::move(connected);
+			return connection.isOpen();
+		}
+
+		bool isActive() const { return connection.isOpen(); }
+		uint64_t getBytesReceived() const { return connection.getBytesReceived(); }
+
+		// Brings in what the host sent, true if the host started a game
+		bool receive(Game& game) {
+			if (!connection.isOpen())
+				return false;
+			bool joined = false;
+			connection.receive([&](CoopMessage type, const uint8_t* in, const uint8_t* end) {
+				switch (type) {
+				case CoopMessage::Join:
+					if (readJoin(in, end, game))
+						joined = true;
+					break;
+				case CoopMessage::Layout:
+					if (game.isMirror() && readLayout(in, end))
+						game.setMirrorLayout(layout);
+					break;
+				case CoopMessage::Changes:
+					readChanges(in, end, game);
+					break;
+				default:
+					break;
 				}
+				});
+			if (!connection.isOpen())
+				std::cerr << "Co-op: the host left" << std::endl;
+			connection.flush();
+			return joined;
+		}
+
+		void forward(const Move* moves, size_t count) override {
+			for (size_t i = 0; i < count; i++) {
+				payload.clear();
+				replay_detail::putVarint(payload, moves[i].row);
+				replay_detail::putVarint(payload, moves[i].column);
+				payload.push_back((uint8_t)moves[i].type);
+				connection.send(CoopMessage::Move, payload);
+				sentAt[sent++ % sentAt.size()] = GetTime();
 			}
-			handleDifficultyBtn(settings, Difficulty::Easy);
-			handleDifficultyBtn(settings, Difficulty::Medium);
-			handleDifficultyBtn(settings, Difficulty::Hard);
-			for (size_t i = 0; i < 2; i++)
-			{
-				TextBox& currentBox = settings.getDimBoxes(i);
-				TextBox& otherBox = settings.getDimBoxes(std::abs((int)i-1));
-			
-				if (CheckCollisionPointRec(mousePoint, currentBox.getRect()) && IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
-					currentBox.setMouseOn(true);
-					otherBox.setMouseOn(false);
+			connection.flush();
+		}
+
+		void requestReset() override {
+			connection.send(CoopMessage::Reset, nullptr, 0, nullptr, 0);
+			connection.flush();
+		}
+
+		void requestContinue() override {
+			connection.send(CoopMessage::Continue, nullptr, 0, nullptr, 0);
+			connection.flush();
+		}
+
+		// From sending a move to the frame that shows its changes, in seconds
+		double getLatency() const { return latency; }
+		double getMaxLatency() const { return maxLatency; }
+
+	private:
+		bool readJoin(const uint8_t* in, const uint8_t* end, Game& game) {
+			uint64_t rows, cols, mines;
+			if (!replay_detail::getVarint(in, end, rows) || !replay_detail::getVarint(in, end, cols) || !replay_detail::getVarint(in, end, mines))
+				return false;
+			if (rows == 0 || cols == 0 || mines > rows * cols)
+				return false;
+			game.startMirror((size_t)rows, (size_t)cols, (size_t)mines, this);
+			return true;
+		}
+
+		bool readLayout(const uint8_t* in, const uint8_t* end) {
+			uint64_t count, index = 0;
+			if (!replay_detail::getVarint(in, end, count))
+				return false;
+			layout.clear();
+			for (uint64_t i = 0; i < count; i++) {
+				uint64_t gap;
+				if (!replay_detail::getVarint(in, end, gap))
+					return false;
+				index += gap;
+				layout.push_back(index);
+			}
+			return true;
+		}
+
+		void readChanges(const uint8_t* in, const uint8_t* end, Game& game) {
+			uint64_t ack, clicks;
+			if (!replay_detail::getVarint(in, end, ack))
+				return;
+			double now = GetTime();
+			for (; acked < ack && acked < sent; acked++) {
+				latency = now - sentAt[acked % sentAt.size()];
+				maxLatency = std::max(maxLatency, latency);
+			}
+			if (!game.isMirror() || in == end)
+				return;
+			GameState state = (GameState)*in++;
+			if (!replay_detail::getVarint(in, end, clicks))
+				return;
+			size_t tileCount = game.getRows() * game.getCols();
+			if (!readOpened(in, end, game, tileCount)) {
+				std::cerr << "Co-op: damaged changes from the host" << std::endl;
+				return;
+			}
+			for (TileState tileState : { TileState::Closed, TileState::Flagged }) {
+				bool valid = SpanCoder::decode(in, end, tileCount, [&game, tileState](size_t start, size_t length) {
+					for (size_t index = start; index < start + length; index++)
+						game.setRemoteState(index, tileState);
+					});
+				if (!valid) {
+					std::cerr << "Co-op: damaged changes from the host" << std::endl;
+					return;
 				}
+			}
+			game.setRemoteProgress(state, (size_t)clicks);
+		}
 
-				if (settings.isOnBox(currentBox))
-				{
-					// Set the window's cursor to the I-Beam
-					SetMouseCursor(MOUSE_CURSOR_IBEAM);
+		// The open runs and the hints behind them, every tile gets its hint before it opens
+		bool readOpened(const uint8_t*& in, const uint8_t* end, Game& game, size_t tileCount) {
+			openRuns.clear();
+			size_t opened = 0;
+			bool valid = SpanCoder::decode(in, end, tileCount, [this, &opened](size_t start, size_t length) {
+				openRuns.push_back({ start, length });
+				opened += length;
+				});
+			if (!valid || (size_t)(end - in) < (opened + 1) / 2)
+				return false;
+			size_t nibble = 0;
+			for (const std::pair<size_t, size_t>& run : openRuns) {
+				for (size_t index = run.first; index < run.first + run.second; index++, nibble++) {
+					uint8_t hint = in[nibble / 2] >> (nibble % 2 * 4) & 15;
+					game.setRemoteHint(index, hint, hint == coopMineHint);
+					game.setRemoteState(index, TileState::Open);
+				}
+			}
+			in += (opened + 1) / 2;
+			return true;
+		}
 
-					// Get char pressed (unicode character) on the queue
-					int key = GetCharPressed();
+		CoopConnection connection;
+		std::vector<uint8_t> payload;
+		std::vector<uint64_t> layout;
+		std::vector<std::pair<size_t, size_t>> openRuns;
+		//Send times of the moves the host hasn't applied yet
+		std::array<double, 256> sentAt{};
+		uint64_t sent = 0, acked = 0;
+		double latency = 0.0, maxLatency = 0.0;
+	};
 
-					// Check if more characters have been pressed on the same frame
-					while (key > 0)
-					{
-						// NOTE: Only allow keys in range [48..57]
-						if ((key >= 48) && (key <= 57) && (currentBox.getLetterCount() < 2))
-						{
-							
-							if (!(currentBox.getLetterCount() == 0 && key == 48)){
-								currentBox.addInput((char)key, currentBox.getLetterCount());
-								currentBox.addInput('\0', currentBox.getLetterCount() + 1);
-								++currentBox;
-							}
-							
-						}
+	// Shows the game to bots in other processes through a SharedBoard and applies the moves they
+	// send. Only the tiles a frame changed are written, a new game writes all of them once. Needs
+	// nothing from the window, a headless game publishes the same way.
+	class BotBridge {
+	public:
+		// Shares the games from now on under a POSIX shared memory name like "/minesweeper"
+		void share(std::string segmentName) { name = std::move(segmentName); }
+		bool isActive() const { return !name.empty(); }
 
-						key = GetCharPressed();  // Check next character in the queue
-					}
+		// The moves bots sent since the last frame as one batch, called before the local input
+		void receive(Game& game) {
+			if (!board.isOpen())
+				return;
+			moves.clear();
+			SharedMove move;
+			while (board.popMove(move)) {
+				received++;
+				if (move.row < game.getRows() && move.col < game.getCols() && move.type <= (uint8_t)MoveType::Chord)
+					moves.push_back({ move.row, move.col, (MoveType)move.type });
+			}
+			if (!moves.empty())
+				game.applyMoves(moves);
+		}
 
-					if (IsKeyPressed(KEY_BACKSPACE))
-					{
-						--currentBox;
-						if (currentBox.getLetterCount() < 0) currentBox.setLetterCount(0);
-						currentBox.addInput('\0', currentBox.getLetterCount());
-					}
+		// Writes what the frame changed, called with the changes the game handed out for the frame
+		void publish(const Game& game, const ChangeSet& changes) {
+			if (name.empty() || game.getRows() == 0)
+				return;
+			bool resized = !board.isOpen() || board.getRows() != game.getRows() || board.getCols() != game.getCols();
+			if (resized) {
+				received = 0;
+				applied = 0;
+				if (!board.create(name, game.getRows(), game.getCols())) {
+					name.clear();
+					return;
 				}
-				else SetMouseCursor(MOUSE_CURSOR_DEFAULT);
 			}
-			return GameScreen::SETTINGS;
-		};
+			//A bot waiting for its move sees the whole cascade it started, not the first slice of it
+			uint64_t nowApplied = changes.revealing ? applied : received;
+			//Bots reading meanwhile don't have to read again for a frame that changed nothing
+			if (!resized && changes.empty() && nowApplied == applied)
+				return;
+			applied = nowApplied;
 
-		void updateMousePosition() {
-			mousePoint = GetMousePosition();
+			board.beginWrite();
+			if (resized || changes.reset) {
+				for (size_t index = 0; index < game.getRows() * game.getCols(); index++)
+					writeTile(game, index);
+			}
+			for (const std::vector<size_t>* list : { &changes.opened, &changes.closed, &changes.flagged, &changes.unflagged }) {
+				for (size_t index : *list)
+					writeTile(game, index);
+			}
+			SharedBoardHeader& header = board.getHeader();
+			header.gameState.store((uint64_t)game.getGameState(), std::memory_order_relaxed);
+			header.bombsLeft.store(game.getBombs(), std::memory_order_relaxed);
+			header.bombTotal.store(game.getBombTotal(), std::memory_order_relaxed);
+			header.clicks.store(game.getClicks(), std::memory_order_relaxed);
+			header.movesApplied.store(applied, std::memory_order_relaxed);
+			board.endWrite();
 		}
+
 	private:
-		void handleDifficultyBtn(Settings& settings, Difficulty diff) {
-			if (CheckCollisionPointRec(mousePoint, settings.getDifficultyButton(diff).getButtonRect()) ) {
-				
+		// Held down is the local mouse button, a bot sees the tile as closed
+		void writeTile(const Game& game, size_t index) {
+			size_t row = index / game.getCols(), col = index % game.getCols();
+			TileState tileState = game.getTileRenderState(row, col);
+			uint8_t hint = 0;
+			if (tileState == TileState::HeldDown)
+				tileState = TileState::Closed;
+			else if (tileState == TileState::Open)
+				hint = (uint8_t)game.getTile(row, col).getValue();
+			board.setTile(index, (uint8_t)((uint8_t)tileState << 4 | hint));
+		}
 
-				//if (IsMouseButtonDown(MOUSE_BUTTON_LEFT)) 
-					//settings.getDifficultyButton(diff).setHeldDown(true);  
+		SharedBoard board;
+		std::string name;
+		std::vector<Move> moves;
+		uint64_t received = 0, applied = 0;
+	};
 
-				if (IsMouseButtonReleased(MOUSE_BUTTON_LEFT)) {
+	// A bot in its own process for trying out a game started with --bots: reads the shared board,
+	// decides on a move, sends it and waits until the game applied it. Reports how many moves it
+	// decides per second and the round trip from sending a move to seeing its result.
+	class BotAgent {
+	public:
+		explicit BotAgent(uint32_t seed) : rng{ seed } {}
+
+		// Plays until the game is over, the time is up or the game stopped answering
+		int run(const std::string& name, double seconds) {
+			using Clock = std::chrono::steady_clock;
+			if (!board.open(name)) {
+				std::cerr << "Bot agent: no shared board " << name << ", start the game with --bots " << name << std::endl;
+				return 1;
+			}
+			Clock::time_point start = Clock::now();
+			double deciding = 0.0;
+			while (std::chrono::duration<double>(Clock::now() - start).count() < seconds) {
+				if (board.isRetired() && !board.open(name))
+					break;
+				Clock::time_point decideStart = Clock::now();
+				Decision decision = board.read([this](const SharedBoard& shared) { return decide(shared); });
+				deciding += std::chrono::duration<double>(Clock::now() - decideStart).count();
+				if (!decision.ongoing)
+					break;
+				decisions++;
+				guesses += decision.guess;
+				const Move& move = decision.move;
+				Clock::time_point sent = Clock::now();
+				uint64_t ticket = board.pushMove((uint32_t)move.row, (uint32_t)move.column, (uint8_t)move.type);
+				if (ticket == 0 || !waitFor(ticket, sent + std::chrono::seconds(2))) {
+					std::cerr << "Bot agent: the game didn't apply the move, is it on the game screen?" << std::endl;
+					break;
+				}
+				roundTrips.push_back(std::chrono::duration<double, std::micro>(Clock::now() - sent).count());
+			}
+			report(deciding);
+			return 0;
+		}
+
+	private:
+		struct Decision {
+			bool ongoing = false;
+			//Nothing was forced, the move opens a random closed tile
+			bool guess = false;
+			Move move{};
+		};
+
+		static TileState stateOf(uint8_t tile) { return (TileState)(tile >> 4); }
+
+		// A chord or a flag a hint forces, looked for from where the last one was found, a
+		// random closed tile when nothing is forced. false once the game is over.
+		Decision decide(const SharedBoard& shared) {
+			const SharedBoardHeader& header = shared.getHeader();
+			if (header.gameState.load(std::memory_order_relaxed) != (uint64_t)GameState::Ongoing)
+				return {};
+			size_t rows = shared.getRows(), cols = shared.getCols(), count = rows * cols;
+			const uint8_t* tiles = shared.getTiles();
+			for (size_t step = 0; step < count; step++) {
+				size_t index = (cursor + step) % count;
+				if (stateOf(tiles[index]) != TileState::Open || (tiles[index] & 15) == 0)
+					continue;
+				size_t row = index / cols, col = index % cols;
+				int flags = 0, closed = 0;
+				size_t closedIndex = 0;
+				Neighborhood<SquareTopology>::forEach(row, col, rows, cols, [&](size_t r, size_t c) {
+					TileState neighbor = stateOf(tiles[r * cols + c]);
+					flags += neighbor == TileState::Flagged;
+					if (neighbor == TileState::Closed) {
+						closed++;
+						closedIndex = r * cols + c;
+					}
+					});
+				int hint = tiles[index] & 15;
+				if (closed == 0)
+					continue;
+				cursor = index;
+				if (flags == hint)
+					return { true, false, Move{ row, col, MoveType::Chord } };
+				if (flags + closed == hint)
+					return { true, false, Move{ closedIndex / cols, closedIndex % cols, MoveType::Flag } };
+			}
+			for (int probe = 0; probe < 64; probe++) {
+				size_t index = rng() % count;
+				if (stateOf(tiles[index]) == TileState::Closed)
+					return { true, true, Move{ index / cols, index % cols, MoveType::Open } };
+			}
+			for (size_t index = 0; index < count; index++) {
+				if (stateOf(tiles[index]) == TileState::Closed)
+					return { true, true, Move{ index / cols, index % cols, MoveType::Open } };
+			}
+			return {};
+		}
+
+		template<typename TimePoint>
+		bool waitFor(uint64_t ticket, TimePoint deadline) {
+			while (board.getHeader().movesApplied.load(std::memory_order_acquire) < ticket) {
+				if (board.isRetired() || std::chrono::steady_clock::now() > deadline)
+					return false;
+				std::this_thread::yield();
+			}
+			return true;
+		}
+
+		void report(double deciding) {
+			printf("bot agent: %zu moves, %zu of them guesses, %.0f decisions/s\n", decisions, guesses, deciding > 0.0 ? decisions / deciding : 0.0);
+			if (roundTrips.empty())
+				return;
+			std::sort(roundTrips.begin(), roundTrips.end());
+			double sum = 0.0;
+			for (double micros : roundTrips)
+				sum += micros;
+			printf("  round trip avg %.1f us, p50 %.1f us, p99 %.1f us, max %.1f us\n", sum / roundTrips.size(),
+				roundTrips[roundTrips.size() / 2], roundTrips[roundTrips.size() * 99 / 100], roundTrips.back());
+		}
+
+		SharedBoard board;
+		std::mt19937 rng;
+		size_t cursor = 0, decisions = 0, guesses = 0;
+		std::vector<double> roundTrips;
+	};
+
+	// A FixedBoard played through the calls of Game that the bots, the board grid and its renderer
+	// use. Its changes are the difference of the bit planes since they were last taken.
+	template<typename Preset>
+	class PresetGame {
+	public:
+		PresetGame() : board{ std::random_device{}() } {}
+
+		void startGame(Difficulty diff) {
+			board.startGame(Board::minesFor(Preset::TileCount, diff));
+			reset = true;
+		}
+
+		void applyMoves(const Move* moves, size_t count) {
+			for (size_t i = 0; i < count; i++) {
+				const Move& move = moves[i];
+				if (move.type == MoveType::Open)
+					board.openTile(move.row, move.column);
+				else if (move.type == MoveType::Flag)
+					board.toggleFlag(move.row, move.column);
+				else
+					board.fastOpen(move.row, move.column);
+			}
+		}
+
+		// Moves take effect at once, there are no cascades left for later frames
+		void update() {}
+		bool isRevealing() const { return false; }
+
+		void takeChanges(ChangeSet& changes) {
+			changes.clear();
+			changes.reset = reset;
+			changes.stateBefore = takenState;
+			changes.state = takenState = board.getGameState();
+			typename Preset::Bits opened = board.getOpened(), flagged = board.getFlagged();
+			if (reset) {
+				takenOpened.clear();
+				takenFlagged.clear();
+				reset = false;
+			}
+			(opened & ~takenOpened).forEach([&changes](size_t row, size_t col) { changes.opened.push_back(row * Preset::cols() + col); });
+			(takenOpened & ~opened).forEach([&changes](size_t row, size_t col) { changes.closed.push_back(row * Preset::cols() + col); });
+			(flagged & ~takenFlagged).forEach([&changes](size_t row, size_t col) { changes.flagged.push_back(row * Preset::cols() + col); });
+			(takenFlagged & ~flagged).forEach([&changes](size_t row, size_t col) { changes.unflagged.push_back(row * Preset::cols() + col); });
+			takenOpened = opened;
+			takenFlagged = flagged;
+		}
+
+		size_t getRows() const { return Preset::rows(); }
+		size_t getCols() const { return Preset::cols(); }
+		GameState getGameState() const { return board.getGameState(); }
+		TileState getTileState(size_t row, size_t col) const { return board.getTileState(row, col); }
+
+		TileState getTileRenderState(size_t row, size_t col) const {
+			TileState tileState = board.getTileState(row, col);
+			return tileState == TileState::Open && board.isBomb(row, col) ? TileState::Bomb : tileState;
+		}
+
+		Tile getTile(size_t row, size_t col) const {
+			return Tile{ board.getValue(row, col), board.isBomb(row, col), board.getTileState(row, col) };
+		}
+
+	private:
+		Preset board;
+		typename Preset::Bits takenOpened, takenFlagged;
+		GameState takenState = GameState::Ongoing;
+		bool reset = false;
+	};
+
+	// Plays a board the way a simple bot would: a chord where a hint has all its flags, a flag
+	// where a hint has as many closed neighbors as missing mines and a random closed tile when no
+	// hint forces anything. Plays a Game or a PresetGame. A hint can only start to force a move
+	// when a tile around it changed, so only the tiles around the changes passed to observe() are
+	// looked at instead of the whole board.
+	class AutoPlayer {
+	public:
+		explicit AutoPlayer(uint32_t seed) : rng{ seed } {}
+
+		// Queues the tiles around the changes the game handed out, every change set of the game has
+		// to come through here
+		template<typename Playable>
+		void observe(const Playable& game, const ChangeSet& changes) {
+			size_t rows = game.getRows(), cols = game.getCols();
+			if (changes.reset || queued.size() != rows * cols) {
+				candidates.clear();
+				queued.assign(rows * cols, 0);
+			}
+			for (const std::vector<size_t>* tiles : { &changes.opened, &changes.closed, &changes.flagged, &changes.unflagged }) {
+				for (size_t index : *tiles) {
+					enqueue(index);
+					Neighborhood<SquareTopology>::forEach(index / cols, index % cols, rows, cols, [this, cols](size_t row, size_t col) {
+						enqueue(row * cols + col);
+						});
+				}
+			}
+		}
+
+		// Makes one move, false if the game is over
+		template<typename Playable>
+		bool step(Playable& game) {
+			if (game.getGameState() != GameState::Ongoing)
+				return false;
+			Move move{};
+			if (findForcedMove(game, move) || findGuess(game, move)) {
+				game.applyMoves(&move, 1);
+				return true;
+			}
+			return false;
+		}
+
+	private:
+		void enqueue(size_t index) {
+			if (queued[index])
+				return;
+			queued[index] = 1;
+			candidates.push_back(index);
+		}
+
+		// A queued tile that forces nothing is dropped until a change around it queues it again, the
+		// one that forces the move stays until its move shows up in the changes
+		template<typename Playable>
+		bool findForcedMove(Playable const& game, Move& move) {
+			size_t cols = game.getCols();
+			while (!candidates.empty()) {
+				size_t index = candidates.back();
+				if (forcedMove(game, index / cols, index % cols, move))
+					return true;
+				candidates.pop_back();
+				queued[index] = 0;
+			}
+			return false;
+		}
+
+		template<typename Playable>
+		bool forcedMove(Playable const& game, size_t row, size_t col, Move& move) {
+			if (game.getTileState(row, col) != TileState::Open)
+				return false;
+			int hint = game.getTile(row, col).getValue();
+			if (hint == 0)
+				return false;
+			int closed = 0, flags = 0;
+			size_t closedRow = 0, closedCol = 0;
+			Neighborhood<SquareTopology>::forEach(row, col, game.getRows(), game.getCols(), [&](size_t newRow, size_t newCol) {
+				TileState state = game.getTileState(newRow, newCol);
+				if (state == TileState::Flagged)
+					flags++;
+				else if (state == TileState::Closed) {
+					closed++;
+					closedRow = newRow;
+					closedCol = newCol;
+				}
+				});
+			if (closed == 0)
+				return false;
+			if (flags == hint) {
+				move = { row, col, MoveType::Chord };
+				return true;
+			}
+			if (flags + closed == hint) {
+				move = { closedRow, closedCol, MoveType::Flag };
+				return true;
+			}
+			return false;
+		}
+
+		// A few random picks, then the first closed tile from a random start
+		template<typename Playable>
+		bool findGuess(Playable const& game, Move& move) {
+			size_t tileCount = game.getRows() * game.getCols();
+			size_t start = rng() % tileCount;
+			for (int attempt = 0; attempt < 16; attempt++) {
+				size_t index = attempt == 0 ? start : rng() % tileCount;
+				if (game.getTileState(index / game.getCols(), index % game.getCols()) == TileState::Closed) {
+					move = { index / game.getCols(), index % game.getCols(), MoveType::Open };
+					return true;
+				}
+			}
+			for (size_t i = 0; i < tileCount; i++) {
+				size_t index = (start + i) % tileCount;
+				if (game.getTileState(index / game.getCols(), index % game.getCols()) == TileState::Closed) {
+					move = { index / game.getCols(), index % game.getCols(), MoveType::Open };
+					return true;
+				}
+			}
+			return false;
+		}
+
+		std::mt19937 rng;
+		//Tiles around changes not looked at yet, queued marks the ones in the list
+		std::vector<size_t> candidates;
+		std::vector<uint8_t> queued;
+	};
+
+	// Many independent games on one screen, for the grid and speed challenge modes. Every board is
+	// played by its own AutoPlayer until the player clicks it and starts over a second after it
+	// ended. The boards update in parallel on a TaskPool, each touches only its own game. All boards
+	// are one preset size and kept in bitboards.
+	template<typename Preset>
+	class BoardGrid {
+	public:
+		struct Slot {
+			explicit Slot(uint32_t seed) : player{ seed } {}
+
+			PresetGame<Preset> game;
+			AutoPlayer player;
+			ChangeSet changes;
+			Rectangle viewport{};
+			GameState lastState = GameState::Ongoing;
+			double endedAt = 0.0;
+			bool human = false;
+			size_t wins = 0, losses = 0;
+		};
+
+		// Pause before an ended board starts over, in seconds
+		static constexpr double restartDelay = 1.0;
+
+		void start(size_t count, Difficulty difficulty, Rectangle area) {
+			this->difficulty = difficulty;
+			slots.clear();
+			std::random_device seeds;
+			for (size_t i = 0; i < count; i++) {
+				slots.push_back(std::make_unique<Slot>(seeds()));
+				slots.back()->game.startGame(difficulty);
+			}
+			layout(area);
+		}
+
+		void stop() {
+			slots.clear();
+		}
+
+		bool isActive() const { return !slots.empty(); }
+
+		// One frame of every board: its bot's move, its cascades and its restart, now is in seconds
+		void update(TaskPool& pool, double now) {
+			pool.run(slots.size(), [this, now](size_t i) {
+				Slot& slot = *slots[i];
+				PresetGame<Preset>& game = slot.game;
+				GameState state = game.getGameState();
+				if (state != GameState::Ongoing) {
+					if (slot.lastState == GameState::Ongoing) {
+						slot.endedAt = now;
+						(state == GameState::Won ? slot.wins : slot.losses)++;
+					}
+					else if (now - slot.endedAt >= restartDelay) {
+						game.startGame(difficulty);
+						slot.human = false;
+						state = GameState::Ongoing;
+					}
+				}
+				else if (!slot.human && !game.isRevealing()) {
+					slot.player.step(game);
+				}
+				game.update();
+				game.takeChanges(slot.changes);
+				slot.player.observe(game, slot.changes);
+				slot.lastState = state;
+				});
+		}
+
+		// A move by the player on the board under the mouse, that board's bot stops playing it
+		bool click(Vector2 mouse, MoveType type) {
+			for (const std::unique_ptr<Slot>& slot : slots) {
+				if (!CheckCollisionPointRec(mouse, slot->viewport))
+					continue;
+				size_t row = std::min(rows - 1, (size_t)((mouse.y - slot->viewport.y) / tileSize));
+				size_t col = std::min(cols - 1, (size_t)((mouse.x - slot->viewport.x) / tileSize));
+				slot->human = true;
+				Move move{ row, col, type };
+				slot->game.applyMoves(&move, 1);
+				return true;
+			}
+			return false;
+		}
+
+		const std::vector<std::unique_ptr<Slot>>& getSlots() const { return slots; }
+		float getTileSize() const { return tileSize; }
+		size_t getRows() const { return rows; }
+		size_t getCols() const { return cols; }
+
+		size_t getWins() const {
+			size_t wins = 0;
+			for (const std::unique_ptr<Slot>& slot : slots)
+				wins += slot->wins;
+			return wins;
+		}
+
+		size_t getLosses() const {
+			size_t losses = 0;
+			for (const std::unique_ptr<Slot>& slot : slots)
+				losses += slot->losses;
+			return losses;
+		}
+
+	private:
+		// Picks the number of grid columns that gives the biggest tiles, up to the game's own size
+		void layout(Rectangle area) {
+			const float gap = 8.0f;
+			size_t count = slots.size();
+			size_t bestColumns = 1;
+			tileSize = 0.0f;
+			for (size_t columns = 1; columns <= count; columns++) {
+				size_t gridRows = (count + columns - 1) / columns;
+				float byWidth = (area.width - gap * (columns - 1)) / (columns * cols);
+				float byHeight = (area.height - gap * (gridRows - 1)) / (gridRows * rows);
+				float size = std::min({ byWidth, byHeight, SizeConfig{}.tileSize });
+				if (size > tileSize) {
+					tileSize = size;
+					bestColumns = columns;
+				}
+			}
+			tileSize = std::max(1.0f, std::floor(tileSize));
+			float boardWidth = cols * tileSize, boardHeight = rows * tileSize;
+			size_t gridRows = (count + bestColumns - 1) / bestColumns;
+			float left = area.x + (area.width - bestColumns * boardWidth - gap * (bestColumns - 1)) / 2;
+			float top = area.y + (area.height - gridRows * boardHeight - gap * (gridRows - 1)) / 2;
+			for (size_t i = 0; i < count; i++)
+				slots[i]->viewport = { left + (i % bestColumns) * (boardWidth + gap), top + (i / bestColumns) * (boardHeight + gap), boardWidth, boardHeight };
+		}
+
+		static constexpr size_t rows = Preset::rows(), cols = Preset::cols();
+
+		std::vector<std::unique_ptr<Slot>> slots;
+		Difficulty difficulty = Difficulty::Easy;
+		float tileSize = 0.0f;
+	};
+
+	class Menu {
+	public:
+
+		Menu(SizeConfig const& conf) : buttons{}, sizeConfig{ conf } {
+			float btnVertPadd = 30.0f;
+			const char* menuText[MENU_BUTTONS] = { "Play", "Settings", "How to play" };
+			GameScreen menuScreens[MENU_BUTTONS] = { GameScreen::GAMEPLAY , GameScreen::SETTINGS, GameScreen::HOW_TO };
+			float menuHeight = (MENU_BUTTONS * sizeConfig.buttonHeight) + (MENU_BUTTONS - 1) * btnVertPadd;
+
+			for (int i = 0; i < MENU_BUTTONS; i++)
+			{
+				float y = (sizeConfig.screenHeight / 2) - (menuHeight / 2) + (i * (btnVertPadd + sizeConfig.buttonHeight));
+				buttons[i] = Button{ menuText[i], sizeConfig.buttonRect(y), menuScreens[i]};
+			}
+		}
+
+		Button& getButton(size_t index)  {
+			return buttons[index];
+		}
+
+		const Button& getButton(size_t index) const {
+			return buttons[index];
+		}
+
+		size_t size() const {
+			return MENU_BUTTONS;
+		}
+
+	
+	private:
+		static const int MENU_BUTTONS = 3;
+		std::array<Button, MENU_BUTTONS> buttons;
+		
+		SizeConfig const& sizeConfig;
+	};
+
+	class TextBox {
+	public:
+		TextBox() = default;
+		TextBox(Rectangle rect) : rect{ rect }, mouseOnBox{ false }, letterCount{0} {}
+
+		const Rectangle& getRect() const {
+			return rect;
+		}
+		bool isOn() const {
+			return mouseOnBox;
+		}
+
+		void setMouseOn(bool state) {
+			mouseOnBox = state;
+		}
+
+		int getLetterCount() const {
+			return letterCount;
+		}
+
+		TextBox& operator++() {
+			letterCount++;
+			return *this;
+		}
+		TextBox& operator--() {
+			letterCount--;
+			return *this;
+		}
+
+		void addInput(char c, int index) {
+			if (index < MAX_INPUT_CHARS && index >= 0)
+				inputDim[index] = c;
+			inputLabel.setText(inputDim);
+		}
+
+		const TextLabel& getInputLabel() const {
+			return inputLabel;
+		}
+
+		void setLetterCount(int count) {
+			letterCount = count;
+		}
+
+		const char* getInput() const {
+			return inputDim;
+		}
+
+		int getInput_int() {
+			
+			int num1 = inputDim[0] - '0'; // 4
+			if (letterCount == 1)
+				return num1;
+			int num2 = inputDim[1] - '0'; // 7
+			
+
+			return num1 * 10 + num2;
+		}
+
+
+		static const int MAX_INPUT_CHARS = 2;
+	private:
+		Rectangle rect;
+		bool mouseOnBox;
+		int letterCount;
+	
+		char inputDim[MAX_INPUT_CHARS + 1] = "\0";
+		TextLabel inputLabel{ "", 40 };
+	};
+
+	class Settings {
+	public:
+		Settings(SizeConfig& conf) : sizeConfig{ conf }, difficulty{Difficulty::Easy} {
+			const char* enterText = "Enter the size of the board:";
+			int enterTextWidth = MeasureText(enterText, 20);
+
+			Rectangle textBoxRow = { sizeConfig.screenWidth / 2.0f - (enterTextWidth / 2) , 180, 100, 50 };
+			float padTextBox = enterTextWidth - textBoxRow.width * 2;
+			Rectangle textBoxCol = { textBoxRow.x + padTextBox + textBoxRow.width, textBoxRow.y, textBoxRow.width, textBoxRow.height };
+			rowsBox = { textBoxRow };
+			colsBox = { textBoxCol };
+			playButton = { (const char*)"Play!", sizeConfig.buttonRect(400), GameScreen::GAMEPLAY };
+
+			float buttonPosY = 250;
+			easy = { (const char*)"Easy", sizeConfig.buttonRect(buttonPosY, -360.0f), GameScreen::SETTINGS,  {0, 119, 0, 255} };
+			medium = { (const char*)"Medium", sizeConfig.buttonRect(buttonPosY), GameScreen::SETTINGS, {0,0,255,255} };
+			hard = { (const char*)"Hard", sizeConfig.buttonRect(buttonPosY, 360.0f), GameScreen::SETTINGS, RED };
+			safeStart = { (const char*)"Safe start", sizeConfig.buttonRect(520), GameScreen::SETTINGS };
+			safeStart.setHeldDown(true);
+
+		}
+
+		TextBox& getDimBoxes(size_t dim) {
+			if (dim == 0)
+				return rowsBox;
+			return colsBox;
+		}
+
+		const TextBox& getDimBoxes(size_t dim) const {
+			if (dim == 0)
+				return rowsBox;
+			return colsBox;
+		}
+	
+		bool isOnBox(TextBox const& box) const {
+			return box.isOn();
+		}
+
+		const Button& getPlayButton() const{
+			return playButton;
+		}
+
+		 Button& getDifficultyButton(Difficulty d) {
+			if (d == Difficulty::Easy)
+				return easy;
+			if (d == Difficulty::Medium)
+				return medium;
+		
+				return hard;
+		}
+
+		 const Button& getDifficultyButton(Difficulty d) const {
+			 if (d == Difficulty::Easy)
+				 return easy;
+			 if (d == Difficulty::Medium)
+				 return medium;
+				 return hard;
+		 }
+
+		Difficulty getDifficulty()const {
+			return difficulty;
+		}
+
+		void setDifficulty(Difficulty diff) {
+			difficulty = diff;
+		}
+
+		Button& getSafeStartButton() {
+			return safeStart;
+		}
+
+		const Button& getSafeStartButton() const {
+			return safeStart;
+		}
+
+		//The safe start button stays pushed down while the mode is on
+		bool isSafeStart() const {
+			return safeStart.isHeldDown();
+		}
+
+	
+	private:
+		SizeConfig& sizeConfig;
+		TextBox rowsBox, colsBox;
+		Button playButton;
+		Button easy, medium, hard;
+		Button safeStart;
+		Difficulty difficulty;
+	};
+
+	class InputHandler {
+	public:
+		InputHandler(SizeConfig& conf) : mousePoint{}, sizeConfig{conf} {};
+		
+		GameScreen handleGameInput(Game& game) {
+			
+
+			if (game.getGameState() != GameState::Ongoing && IsMouseButtonReleased(MOUSE_BUTTON_LEFT)) {
+				if (CheckCollisionPointRec(mousePoint, game.getTryAgainButton().getButtonRect()) && game.getGameState() == GameState::Won) {
+					game.resetGame();
+					return GameScreen::GAMEPLAY;
+				}
+				if (CheckCollisionPointRec(mousePoint, game.getContinueButton().getButtonRect()) && game.getGameState() == GameState::Lost) {
+					game.continueGame();
+					return GameScreen::GAMEPLAY;
+				}
+				if (CheckCollisionPointRec(mousePoint, game.getHomeButton().getButtonRect())) {
+					game.resetGame();
+					return GameScreen::TITLE;
+				}
+			}
+			for (int row = 0; row < sizeConfig.rows ; row++)
+			{
+				for (size_t col = 0; col < sizeConfig.cols; col++)
+				{
+					TileState currentState = game.getTileState(row, col);
+					if (CheckCollisionPointRec(mousePoint, game.getTileRect(row, col)))
+					{
+						//Hover effect when holding down mouse
+						if (IsMouseButtonDown(MOUSE_BUTTON_LEFT) && currentState != TileState::Flagged ) {
+						
+							if (currentState == TileState::Open) {
+								game.hoverAdjacent(row, col, true);
+								return GameScreen::GAMEPLAY;
+							}
+							else if (currentState == TileState::Closed) {
+								game.toggleHeldDown(row, col, true);
+							}		
+						}
+						if(IsMouseButtonReleased(MOUSE_BUTTON_LEFT)){
+							//Open by clicking on an already open tile
+							if(currentState == TileState::Open) {
+								game.toggleHeldDown(row, col, false); 
+								game.hoverAdjacent(row, col, false);
+								if (game.isChordReady(row, col))
+									game.fastOpen(row, col);
+							}
+							//Open tile by clikcing on closed tile
+							else if (currentState == TileState::Closed && game.getGameState() == GameState::Ongoing) {
+								//game.toggleHeldDown(row, col, false); 
+								game.hoverAdjacent(row, col, false);
+								game.openTile(row, col);
+							}
+						}
+						//Put down a flag, open tiles take none
+						if (IsMouseButtonPressed(MOUSE_BUTTON_RIGHT) && currentState != TileState::Open && game.getGameState() == GameState::Ongoing)
+							game.toggleFlag(row, col);
+					}
+					else {
+						game.toggleHeldDown(row, col, false);
+					}
+				}
+			}
+			return GameScreen::GAMEPLAY;
+		}
+		GameScreen handleMenuInput(Menu& menu) {
+
+
+			for (size_t i = 0; i < menu.size(); i++)
+			{
+				Button& currentButton = menu.getButton(i);
+				if (CheckCollisionPointRec(mousePoint, currentButton.getButtonRect()) )
+				{
+					if (IsMouseButtonDown(MOUSE_BUTTON_LEFT))
+						currentButton.setHeldDown(true);
+
+					if (IsMouseButtonReleased(MOUSE_BUTTON_LEFT)) {
+						currentButton.setHeldDown(false);
+						if (sizeConfig.rows == 0 && currentButton.getScreen() == GameScreen::GAMEPLAY)
+							return GameScreen::SETTINGS;
+						return currentButton.getScreen();
+					}
+				}
+				else {
+					currentButton.setHeldDown(false);
+				}
+			}
+			return GameScreen::TITLE;
+		}
+		GameScreen handleSettingsInput(Settings& settings, Game& game) {
+			
+			if (CheckCollisionPointRec(mousePoint, settings.getPlayButton().getButtonRect())) {
+		
+				if (IsMouseButtonReleased(MOUSE_BUTTON_LEFT)) {
+					//If the user has entered the board dimensions
+					if (settings.getDimBoxes(0).getLetterCount() != 0 && settings.getDimBoxes(1).getLetterCount() != 0)
+						sizeConfig.rows = settings.getDimBoxes(0).getInput_int();
+						sizeConfig.cols = settings.getDimBoxes(1).getInput_int();
+						game.setFirstClickSafe(settings.isSafeStart());
+						game.startGame(sizeConfig.rows, sizeConfig.cols, settings.getDifficulty());
+						return GameScreen::GAMEPLAY;
+				}
+			}
+			handleDifficultyBtn(settings, Difficulty::Easy);
+			handleDifficultyBtn(settings, Difficulty::Medium);
+			handleDifficultyBtn(settings, Difficulty::Hard);
+			Button& safeStart = settings.getSafeStartButton();
+			if (CheckCollisionPointRec(mousePoint, safeStart.getButtonRect()) && IsMouseButtonReleased(MOUSE_BUTTON_LEFT))
+				safeStart.setHeldDown(!safeStart.isHeldDown());
+			for (size_t i = 0; i < 2; i++)
+			{
+				TextBox& currentBox = settings.getDimBoxes(i);
+				TextBox& otherBox = settings.getDimBoxes(std::abs((int)i-1));
+			
+				if (CheckCollisionPointRec(mousePoint, currentBox.getRect()) && IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
+					currentBox.setMouseOn(true);
+					otherBox.setMouseOn(false);
+				}
+
+				if (settings.isOnBox(currentBox))
+				{
+					// Set the window's cursor to the I-Beam
+					SetMouseCursor(MOUSE_CURSOR_IBEAM);
+
+					// Get char pressed (unicode character) on the queue
+					int key = GetCharPressed();
+
+					// Check if more characters have been pressed on the same frame
+					while (key > 0)
+					{
+						// NOTE: Only allow keys in range [48..57]
+						if ((key >= 48) && (key <= 57) && (currentBox.getLetterCount() < 2))
+						{
+							
+							if (!(currentBox.getLetterCount() == 0 && key == 48)){
+								currentBox.addInput((char)key, currentBox.getLetterCount());
+								currentBox.addInput('\0', currentBox.getLetterCount() + 1);
+								++currentBox;
+							}
+							
+						}
+
+						key = GetCharPressed();  // Check next character in the queue
+					}
+
+					if (IsKeyPressed(KEY_BACKSPACE))
+					{
+						--currentBox;
+						if (currentBox.getLetterCount() < 0) currentBox.setLetterCount(0);
+						currentBox.addInput('\0', currentBox.getLetterCount());
+					}
+				}
+				else SetMouseCursor(MOUSE_CURSOR_DEFAULT);
+			}
+			return GameScreen::SETTINGS;
+		};
+
+		void updateMousePosition() {
+			mousePoint = GetMousePosition();
+		}
+	private:
+		void handleDifficultyBtn(Settings& settings, Difficulty diff) {
+			if (CheckCollisionPointRec(mousePoint, settings.getDifficultyButton(diff).getButtonRect()) ) {
+				
+
+				//if (IsMouseButtonDown(MOUSE_BUTTON_LEFT)) 
+					//settings.getDifficultyButton(diff).setHeldDown(true);  
+
+				if (IsMouseButtonReleased(MOUSE_BUTTON_LEFT)) {
 					//settings.getDifficultyButton(diff).setHeldDown(false);
 					settings.setDifficulty(diff); 
 				}
 			}
-
-			if (settings.getDifficulty() == diff) {
-				settings.getDifficultyButton(diff).setHeldDown(true);
+
+			if (settings.getDifficulty() == diff) {
+				settings.getDifficultyButton(diff).setHeldDown(true);
+			}
+			else {
+				settings.getDifficultyButton(diff).setHeldDown(false);
+			}
+		}
+
+		Vector2 mousePoint;
+		SizeConfig& sizeConfig;
+		
+	};
+
+	class Renderer {
+	public:
+		// Needs no window until the backend loads the first texture, which it does when it is first drawn
+		Renderer(SizeConfig const& s) :
+			sizeConfig{ s }, framesCounter{} {}
+
+		~Renderer() {
+			if (minimapTex.id != 0)
+				backend->unloadTexture(minimapTex);
+		}
+
+		// Everything drawn between beginFrame and endFrame is recorded and handed to the backend sorted
+		void beginFrame() {
+			list.clear();
+		}
+
+		void endFrame() {
+			backend->submit(list);
+		}
+
+		// Allocations of the last finished frame, toggled with F3
+		void drawAllocOverlay(const AllocTracker& tracker) {
+			const AllocCounts& frame = tracker.getLastFrame();
+			char text[TextLabel::MAX_TEXT];
+			snprintf(text, sizeof(text), "Allocs/frame: %zu (%zu bytes)", frame.allocations, frame.bytes);
+			allocLabels[0].setText(text);
+			snprintf(text, sizeof(text), "Input: %zu  Update: %zu  Draw: %zu",
+				tracker.getLastPhase(AllocPhase::Input).allocations,
+				tracker.getLastPhase(AllocPhase::Update).allocations,
+				tracker.getLastPhase(AllocPhase::Draw).allocations);
+			allocLabels[1].setText(text);
+
+			list.rect(LAYER_OVERLAY, { 10, 10, 360, 50 }, Fade(BLACK, 0.6f));
+			list.text(LAYER_OVERLAY_TEXT, allocLabels[0].getText(), 20, 15, 20, GREEN);
+			list.text(LAYER_OVERLAY_TEXT, allocLabels[1].getText(), 20, 37, 20, GREEN);
+		}
+
+		// The minimap moves to the new backend, the art is loaded again from it when drawn
+		void setBackend(std::unique_ptr<RenderBackend> newBackend) {
+			if (minimapTex.id != 0) {
+				backend->unloadTexture(minimapTex);
+				minimapTex = newBackend->createTexture(minimapImage());
+			}
+			backend = std::move(newBackend);
+		}
+
+		void drawGame(Game const& game) {
+			updateLayout();
+			drawGameBoard(game);
+			drawBombCounter(game);
+			drawGameOverMessage(game);
+			if (showMinimap && minimapTex.id != 0) {
+				Vector2 position{ sizeConfig.screenWidth - minimapTex.width - 20.0f, 40.0f };
+				list.texture(LAYER_HUD, minimapTex, (int)position.x, (int)position.y, WHITE);
+				list.rectLines(LAYER_HUD_TEXT, { position.x - 1, position.y - 1, minimapTex.width + 2.0f, minimapTex.height + 2.0f }, DARKGRAY);
+			}
+		}
+
+		// Feeds the changes of a frame to the minimap and uploads only the pixels they touched
+		void updateMinimap(const ChangeSet& changes) {
+			if (changes.reset && (minimapRows != sizeConfig.rows || minimapCols != sizeConfig.cols)) {
+				minimapRows = sizeConfig.rows;
+				minimapCols = sizeConfig.cols;
+				minimap.resize(minimapRows, minimapCols, MINIMAP_SIZE, MINIMAP_SIZE);
+				if (minimapTex.id != 0)
+					backend->unloadTexture(minimapTex);
+				minimapTex = backend->createTexture(minimapImage());
+			}
+			minimap.apply(changes);
+
+			MinimapRect rect;
+			if (const uint8_t* pixels = minimap.takeDirty(rect)) {
+				if (minimapTex.id != 0)
+					backend->updateTexture(minimapTex, { (float)rect.x, (float)rect.y, (float)rect.width, (float)rect.height }, pixels);
+			}
+		}
+
+		Image minimapImage() const {
+			return { const_cast<uint8_t*>(minimap.getPixels()), (int)minimap.getWidth(), (int)minimap.getHeight(), 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8 };
+		}
+
+		void toggleMinimap() {
+			showMinimap = !showMinimap;
+		}
+
+		// Tints every closed frontier tile from green to red by its mine probability
+		void drawHeatmap(Game const& game, MineProbability const& heatmap) {
+			for (const TileProbability& tile : heatmap.getFrontier()) {
+				size_t row = tile.index / sizeConfig.cols;
+				size_t col = tile.index % sizeConfig.cols;
+				if (row >= sizeConfig.rows || game.getTileState(row, col) != TileState::Closed)
+					continue;
+				unsigned char red = (unsigned char)(255 * tile.mine);
+				list.rect(LAYER_HEATMAP, game.getTileRect(row, col), Color{ red, (unsigned char)(255 - red), 0, 110 });
+			}
+
+			const MineProbability::Stats& stats = heatmap.getStats();
+			char text[TextLabel::MAX_TEXT];
+			snprintf(text, sizeof(text), "Frontier: %zu tiles, %zu parts, rest %d%%, %.1f ms", stats.frontierTiles,
+				stats.components, (int)(heatmap.getRestProbability() * 100), stats.latency * 1000.0);
+			heatmapLabel.setText(text);
+			list.text(LAYER_HUD_TEXT, heatmapLabel.getText(), 20, sizeConfig.screenHeight - 30, 20, DARKGRAY);
+		}
+		void drawReplayBar(uint64_t position, uint64_t moves) {
+			char text[TextLabel::MAX_TEXT];
+			snprintf(text, sizeof(text), "Replay: move %llu of %llu   <- -> step, PgUp PgDn jump, R close",
+				(unsigned long long)position, (unsigned long long)moves);
+			replayLabel.setText(text);
+			float width = sizeConfig.screenWidth - 40.0f;
+			float done = moves > 0 ? (float)position / moves : 1.0f;
+			list.rect(LAYER_OVERLAY, { 20, sizeConfig.screenHeight - 60.0f, width, 8 }, LIGHTGRAY);
+			list.rect(LAYER_OVERLAY, { 20, sizeConfig.screenHeight - 60.0f, width * done, 8 }, DARKBLUE);
+			list.text(LAYER_OVERLAY_TEXT, replayLabel.getText(), 20, sizeConfig.screenHeight - 45, 20, DARKGRAY);
+		}
+		// Players and bytes per move on the host, the time a move takes to show up on a client
+		void drawCoopStatus(const CoopHost& host, const CoopClient& client) {
+			char text[TextLabel::MAX_TEXT];
+			if (host.isActive())
+				snprintf(text, sizeof(text), "Co-op host: %zu joined, %.0f bytes per move", host.getClientCount(), host.getBytesPerMove());
+			else
+				snprintf(text, sizeof(text), "Co-op: move shown after %.1f ms, at most %.1f ms", client.getLatency() * 1000.0, client.getMaxLatency() * 1000.0);
+			coopLabel.setText(text);
+			list.text(LAYER_OVERLAY_TEXT, coopLabel.getText(), 20, sizeConfig.screenHeight - 25, 20, DARKGRAY);
+		}
+		void drawHowTo() {
+			list.text(LAYER_HUD_TEXT, "MINESWEEPER", 0, 0, 50, BLUE);
+		}
+		void drawMenu(Menu const& menu) {
+			list.text(LAYER_HUD_TEXT, titleLabel.getText(), (sizeConfig.screenWidth - titleLabel.getWidth()) / 2, 100, 75, DARKGREEN);
+			for (size_t i = 0; i < menu.size(); i++)
+			{
+				drawMenuButton(menu.getButton(i));
+			}
+		}
+		void drawSettings(Settings const& settings) {
+			int enterTextWidth = enterLabel.getWidth();
+			const TextBox& textBox = settings.getDimBoxes(0);
+
+			float padTextBox = enterTextWidth - textBox.getRect().width * 2;
+			list.text(LAYER_HUD_TEXT, enterLabel.getText(), sizeConfig.screenWidth / 2- (enterTextWidth / 2), 140, 20, GRAY); 
+			list.text(LAYER_HUD_TEXT, xLabel.getText(), (int)(textBox.getRect().x + textBox.getRect().width + (padTextBox / 2) - xLabel.getWidth() / 2), (int)textBox.getRect().y + 20, 20, GRAY);
+			
+			drawMenuButton(settings.getDifficultyButton(Difficulty::Easy));
+			drawMenuButton(settings.getDifficultyButton(Difficulty::Medium));
+			drawMenuButton(settings.getDifficultyButton(Difficulty::Hard));
+			drawMenuButton(settings.getPlayButton());
+			drawMenuButton(settings.getSafeStartButton());
+
+			//DrawText(TextFormat("INPUT CHARS: %i/%i", letterCount, MAX_INPUT_CHARS),750 , 300, 20, DARKGRAY);
+			for (size_t i = 0; i < 2; i++)
+			{
+				const TextBox& box = settings.getDimBoxes(i);
+
+				list.rect(LAYER_HUD, box.getRect(), LIGHTGRAY);
+
+				if (settings.isOnBox(box)) list.rectLines(LAYER_HUD, box.getRect(), RED);
+				else list.rectLines(LAYER_HUD, box.getRect(), DARKGRAY);
+		
+				list.text(LAYER_HUD_TEXT, box.getInput(), (int)box.getRect().x + 5, (int)box.getRect().y + 8, 40, MAROON);
+				
+
+				if (settings.isOnBox(box))
+				{
+					if (box.getLetterCount() < box.MAX_INPUT_CHARS)
+					{
+						// Draw blinking underscore char
+						if (((framesCounter / 20) % 2) == 0) list.text(LAYER_HUD_TEXT, "_", (int)box.getRect().x + 8 + box.getInputLabel().getWidth(), (int)box.getRect().y + 12, 40, MAROON);
+					}
+					else list.text(LAYER_HUD_TEXT, "Press BACKSPACE to delete chars...", 230, 300, 20, GRAY);
+				}
+			}
+		}
+	
+		// Tile art the board grid is drawn with
+		struct TileTextures {
+			Texture2D up, down, bomb, flag;
+		};
+
+		// Every board of the grid goes into the one draw list, so the tiles of all boards are drawn
+		// in a few texture batches instead of a batch per board
+		template<typename Preset>
+		void drawBoardGrid(BoardGrid<Preset> const& grid) {
+			list.reserve(3 * grid.getSlots().size() * grid.getRows() * grid.getCols() + 64);
+			recordBoardGrid(list, grid, { backend->texture(TextureArt::TileUp), backend->texture(TextureArt::TileDown),
+				backend->texture(TextureArt::Bomb), backend->texture(TextureArt::Flag) });
+			char gridMsg[TextLabel::MAX_TEXT];
+			snprintf(gridMsg, sizeof(gridMsg), "Boards: %zu  Won: %zu  Lost: %zu  G: back", grid.getSlots().size(), grid.getWins(), grid.getLosses());
+			gridLabel.setText(gridMsg);
+			list.text(LAYER_HUD_TEXT, gridLabel.getText(), 20, 20, 20, BLACK);
+		}
+
+		// Records the boards scaled to the grid's tile size, without a window for the benchmark
+		template<typename Preset>
+		static void recordBoardGrid(DrawList& list, BoardGrid<Preset> const& grid, TileTextures const& textures) {
+			float tile = grid.getTileSize();
+			auto art = [](Texture2D texture) { return Rectangle{ 0, 0, (float)texture.width, (float)texture.height }; };
+			Rectangle upSource = art(textures.up), downSource = art(textures.down), bombSource = art(textures.bomb), flagSource = art(textures.flag);
+			float flagSize = tile * textures.flag.width / SizeConfig{}.tileSize;
+			const Color tint{ 230, 230, 230, 255 };
+
+			for (const std::unique_ptr<typename BoardGrid<Preset>::Slot>& slot : grid.getSlots()) {
+				const PresetGame<Preset>& game = slot->game;
+				Rectangle view = slot->viewport;
+				list.rect(LAYER_BOARD, { view.x - 2, view.y - 2, view.width + 4, view.height + 4 }, GRAY);
+				for (size_t row = 0; row < grid.getRows(); row++) {
+					for (size_t col = 0; col < grid.getCols(); col++) {
+						Rectangle dest{ view.x + col * tile, view.y + row * tile, tile, tile };
+						switch (game.getTileRenderState(row, col)) {
+						case TileState::Open: {
+							list.texturePro(LAYER_TILES, textures.down, downSource, dest, tint);
+							int tileValue = game.getTile(row, col).getValue();
+							if (tileValue == 0)
+								break;
+							//Below the smallest font size a hint is a dot in its color
+							if (tile >= 10.0f)
+								list.text(LAYER_TILE_ICONS, numberTexts[tileValue], (int)(dest.x + tile / 3), (int)(dest.y + tile / 4),
+									std::max(10, (int)(tile * 2 / 3)), getNumberColor(tileValue));
+							else
+								list.rect(LAYER_TILE_ICONS, { dest.x + tile / 4, dest.y + tile / 4, tile / 2, tile / 2 }, getNumberColor(tileValue));
+							break;
+						}
+						case TileState::Bomb:
+							list.texturePro(LAYER_TILES, textures.bomb, bombSource, dest, WHITE);
+							break;
+						case TileState::Flagged:
+							list.texturePro(LAYER_TILES, textures.up, upSource, dest, tint);
+							list.texturePro(LAYER_TILE_ICONS, textures.flag, flagSource,
+								{ dest.x + (tile - flagSize) / 2, dest.y + (tile - flagSize) / 2, flagSize, flagSize }, WHITE);
+							break;
+						case TileState::HeldDown:
+							list.texturePro(LAYER_TILES, textures.down, downSource, dest, tint);
+							break;
+						default:
+							list.texturePro(LAYER_TILES, textures.up, upSource, dest, tint);
+							break;
+						}
+					}
+				}
+				if (game.getGameState() != GameState::Ongoing)
+					list.rectLines(LAYER_HUD, view, game.getGameState() == GameState::Won ? GREEN : RED);
+			}
+		}
+
+		// Where the last win ranks among the records of its board, shown under its stats
+		void showRecord(size_t rank, uint32_t bestMillis) {
+			char recordMsg[TextLabel::MAX_TEXT];
+			if (rank > 0)
+				snprintf(recordMsg, sizeof(recordMsg), "Rank: #%zu  Best: %.2fs", rank, bestMillis / 1000.0);
+			else
+				snprintf(recordMsg, sizeof(recordMsg), "Best: %.2fs", bestMillis / 1000.0);
+			recordLabel.setText(recordMsg);
+			overlayValid = false;
+		}
+
+		void hideRecord() {
+			recordLabel.setText("");
+			overlayValid = false;
+		}
+
+		// Color of the hint on an open tile, snapshots draw theirs the same
+		static Color getNumberColor(int tileValue) {
+			switch (tileValue) {
+			case 1:
+				return  {0,0,255,255};
+				break;
+			case 2:
+				return {0, 119, 0, 255};
+				break;
+			case 3:
+				return RED;
+				break;
+			case 4:
+				return { 0,0,128,255 };
+				break;
+			case 5:
+				return { 128, 0, 0, 255 };
+				break;
+			case 6:
+				return {0, 128, 170, 255};
+				break;
+			default:
+				return BLACK;
+				break;
+			}
+		}
+
+	private:
+		// Recomputes the board, counter and overlay geometry after SizeConfig changed
+		void updateLayout() {
+			if (layoutVersion == sizeConfig.version)
+				return;
+			layoutVersion = sizeConfig.version;
+			//A tile, its icon or number and its heatmap tint, plus the HUD and overlay, so a frame never grows the list
+			list.reserve(3 * sizeConfig.rows * sizeConfig.cols + 64);
+
+			float centerX = (sizeConfig.screenWidth - sizeConfig.boardWidth) / 2;
+			float centerY = (sizeConfig.screenHeight - sizeConfig.boardHeight) / 2;
+			boardRect = { centerX - sizeConfig.boardPadding / 2,centerY - sizeConfig.boardPadding / 2,
+								sizeConfig.boardWidth + sizeConfig.boardPadding, sizeConfig.boardHeight + sizeConfig.boardPadding };
+
+			float counterWidth = sizeConfig.screenWidth * 0.125f;
+			float counterHeight = sizeConfig.screenHeight * 0.075f;
+			Vector2 innerPad{ 0.1f * counterWidth, 0.2f * counterHeight };
+			counterTextPos = { centerX + innerPad.x / 2 , centerY - counterHeight + innerPad.y / 2 };
+			counterRect = { centerX - sizeConfig.boardPadding / 2,(centerY - sizeConfig.boardPadding / 2) - counterHeight,
+								counterWidth, counterHeight };
+			counterInner = { (centerX - sizeConfig.boardPadding / 2) + innerPad.x / 2,(centerY - sizeConfig.boardPadding / 2) - counterHeight + innerPad.y / 2,
+								counterWidth - innerPad.x, counterHeight - innerPad.y };
+			overlayValid = false;
+		}
+
+		// Message and time positions of the game over overlay, only redone when its text changes
+		void updateOverlayLayout(Game const& game, GameState gameState, int seconds) {
+			if (overlayValid && overlayState == gameState && overlaySeconds == seconds)
+				return;
+			overlayValid = true;
+			overlayState = gameState;
+			overlaySeconds = seconds;
+
+			const TextLabel& msgLabel = gameState == GameState::Won ? winLabel : loseLabel;
+			msgPosition = { (sizeConfig.screenWidth - msgLabel.getWidth()) / 2.0f, sizeConfig.screenHeight / 2.0f - GetFontDefault().baseSize / 2.0f - 80.0f };
+			msgBackground = { msgPosition.x, msgPosition.y, msgLabel.getExtent().x, msgLabel.getExtent().y };
+			if (gameState != GameState::Won)
+				return;
+
+			char timeMsg[TextLabel::MAX_TEXT];
+			snprintf(timeMsg, sizeof(timeMsg), "Time: %ds", seconds);
+			timeLabel.setText(timeMsg);
+			float center = (winLabel.getExtent().x - timeLabel.getExtent().x) / 2;
+			timePosition = { msgPosition.x + center, msgPosition.y + 50 };
+			timeBackground = { timePosition.x, timePosition.y, timeLabel.getExtent().x, timeLabel.getExtent().y };
+
+			char statsMsg[TextLabel::MAX_TEXT];
+			snprintf(statsMsg, sizeof(statsMsg), "3BV: %zu  3BV/s: %.2f  Clicks: %zu  Eff: %d%%",
+				game.getBoardMetrics().bbbv, game.getBBBVPerSecond(), game.getClicks(), (int)(game.getEfficiency() * 100));
+			statsLabel.setText(statsMsg);
+			statsPosition = { (sizeConfig.screenWidth - statsLabel.getExtent().x) / 2.0f, timePosition.y + 25 };
+			statsBackground = { statsPosition.x, statsPosition.y, statsLabel.getExtent().x, statsLabel.getExtent().y };
+
+			recordPosition = { (sizeConfig.screenWidth - recordLabel.getExtent().x) / 2.0f, statsPosition.y + 25 };
+			recordBackground = { recordPosition.x, recordPosition.y, recordLabel.getExtent().x, recordLabel.getExtent().y };
+		}
+
+		void drawGameBoard(Game const& game) {
+			Texture2D tileUpTex = backend->texture(TextureArt::TileUp), tileDownTex = backend->texture(TextureArt::TileDown);
+			Texture2D bombTex = backend->texture(TextureArt::Bomb), flagTex = backend->texture(TextureArt::Flag);
+			list.rect(LAYER_BOARD, boardRect, GRAY);
+
+			for (int i = 0; i < sizeConfig.cols * sizeConfig.rows; ++i) {
+				size_t row = i / sizeConfig.cols;
+				size_t col = i % sizeConfig.cols;
+
+				TileState state = game.getTileRenderState(row, col);
+				Rectangle tileRect = game.getTileRect(row, col);
+
+				switch (state) {
+				case TileState::Open: {
+					int tileValue = game.getTile(row, col).getValue();
+					list.texture(LAYER_TILES, tileDownTex, (int)tileRect.x, (int)tileRect.y, { 230,230,230, 255 });
+					if (tileValue == 0) 
+						break;
+					
+					list.text(LAYER_TILE_ICONS, numberTexts[tileValue],
+						(int)(tileRect.x + (sizeConfig.tileSize / 3)), (int)(tileRect.y + (sizeConfig.tileSize / 4)), 20,
+						game.isSatisfied(row, col) ? Fade(getNumberColor(tileValue), 0.4f) : getNumberColor(tileValue));
+					break;
+				}
+				case TileState::Bomb:
+					list.texture(LAYER_TILES, bombTex, (int)tileRect.x, (int)tileRect.y, WHITE);
+					break;
+				case TileState::Flagged:
+					list.texture(LAYER_TILES, tileUpTex, (int)tileRect.x, (int)tileRect.y, { 230,230,230, 255 });
+					list.texture(LAYER_TILE_ICONS, flagTex, (int)tileRect.x + (int)(tileRect.width- flagTex.width)/2, (int)(tileRect.y) + (int)(tileRect.height - flagTex.height) / 2, WHITE);
+					break;
+				case TileState::HeldDown:
+					list.texture(LAYER_TILES, tileDownTex, (int)tileRect.x, (int)tileRect.y, { 230,230,230, 255 });
+					break;
+				default:
+					list.texture(LAYER_TILES, tileUpTex, (int)tileRect.x, (int)tileRect.y, {230,230,230, 255});
+					break;
+				}
+			}
+		}
+		void drawBombCounter(Game const& game) {
+			if (shownBombs != game.getBombs()) {
+				shownBombs = game.getBombs();
+				char count[TextLabel::MAX_TEXT];
+				snprintf(count, sizeof(count), "%i", (int)shownBombs);
+				counterLabel.setText(count);
+			}
+
+			list.rect(LAYER_HUD, counterRect, DARKGRAY);
+			list.rectRounded(LAYER_HUD, counterInner, 0.1f, { 140, 140, 140, 255 });
+			list.textEx(LAYER_HUD_TEXT, counterLabel.getText(), counterTextPos, 25, 5, RED);
+
+		};
+		void drawGameOverMessage(Game const& game) {
+			if (game.getGameState() == GameState::Ongoing)
+				return;
+			drawMenuButton(game.getHomeButton());
+			updateOverlayLayout(game, game.getGameState(), (int)game.getGameTime());
+
+			//Draw message
+			const TextLabel& msgLabel = game.getGameState() == GameState::Won ? winLabel : loseLabel;
+			list.rectRounded(LAYER_OVERLAY, msgBackground, 0.1f, DARKGRAY);
+			list.textEx(LAYER_OVERLAY_TEXT, msgLabel.getText(), msgPosition, 50.0f, 5, BLACK);
+			if (game.getGameState() == GameState::Won) {
+				list.rectRounded(LAYER_OVERLAY, timeBackground, 0.1f, DARKGRAY);
+				list.textEx(LAYER_OVERLAY_TEXT, timeLabel.getText(), timePosition, 15, 5, BLACK);
+				list.rectRounded(LAYER_OVERLAY, statsBackground, 0.1f, DARKGRAY);
+				list.textEx(LAYER_OVERLAY_TEXT, statsLabel.getText(), statsPosition, 15, 5, BLACK);
+				if (recordLabel.getText()[0] != '\0') {
+					list.rectRounded(LAYER_OVERLAY, recordBackground, 0.1f, DARKGRAY);
+					list.textEx(LAYER_OVERLAY_TEXT, recordLabel.getText(), recordPosition, 15, 5, BLACK);
+				}
+				drawMenuButton(game.getTryAgainButton()); 
+			}
+			else {
+				drawMenuButton(game.getContinueButton());
+			}
+		}
+		void drawMenuButton(Button const& button) {
+			Texture2D menuBtnTex = backend->texture(TextureArt::MenuButton), menuBtnDownTex = backend->texture(TextureArt::MenuButtonDown);
+			Rectangle recSource{ 0.f,0.f, (float)menuBtnTex.width, (float)menuBtnTex.height };
+			float centerX = (menuBtnTex.width - button.getLabel().getWidth()) / 2.0f;
+			float centerY = (menuBtnTex.height - 25.0f) / 2;
+			if (button.isHeldDown())
+				list.textureRec(LAYER_OVERLAY, menuBtnDownTex, recSource, button.getPosition(), WHITE);
+			else
+				list.textureRec(LAYER_OVERLAY, menuBtnTex, recSource, button.getPosition(), WHITE);
+
+			list.text(LAYER_OVERLAY_TEXT, button.getText(), (int)button.getPosition().x + (int)centerX, (int)button.getPosition().y + (int)centerY, 25, button.getTextColor());
+
+		}
+		
+		enum Layer : uint8_t { LAYER_BOARD, LAYER_TILES, LAYER_TILE_ICONS, LAYER_HEATMAP, LAYER_HUD, LAYER_HUD_TEXT, LAYER_OVERLAY, LAYER_OVERLAY_TEXT };
+
+		static constexpr const char* numberTexts[9] = { "0", "1", "2", "3", "4", "5", "6", "7", "8" };
+
+		int framesCounter;
+	
+		SizeConfig const& sizeConfig;
+		TextLabel titleLabel{ "MINESWEEPER", 75 };
+		TextLabel enterLabel{ "Enter the size of the board:", 20 }, xLabel{ "X", 20 };
+		TextLabel winLabel{ "YOU WIN!", 50, 5 }, loseLabel{ "YOU LOSE!", 50, 5 }, timeLabel{ "", 15, 5 }, statsLabel{ "", 15, 5 }, recordLabel{ "", 15, 5 };
+		TextLabel gridLabel{ "", 20, 1 };
+		TextLabel allocLabels[2];
+		TextLabel heatmapLabel;
+		TextLabel replayLabel;
+		TextLabel coopLabel;
+		TextLabel counterLabel{ "", 25, 5 };
+		size_t shownBombs = SIZE_MAX;
+		unsigned layoutVersion = UINT_MAX;
+		Rectangle boardRect{}, counterRect{}, counterInner{};
+		Vector2 counterTextPos{};
+		bool overlayValid = false;
+		GameState overlayState = GameState::Ongoing;
+		int overlaySeconds = 0;
+		Vector2 msgPosition{}, timePosition{}, statsPosition{}, recordPosition{};
+		Rectangle msgBackground{}, timeBackground{}, statsBackground{}, recordBackground{};
+		static const size_t MINIMAP_SIZE = 256;
+		Minimap minimap;
+		Texture2D minimapTex{};
+		size_t minimapRows = 0, minimapCols = 0;
+		bool showMinimap = false;
+		DrawList list;
+		std::unique_ptr<RenderBackend> backend = std::make_unique<RaylibBackend>();
+	};
+
+	// Writes the board as the game shows it to a PNG, without a window, for thumbnails of finished games
+	class SnapshotExporter {
+	public:
+		// Long side of a snapshot in pixels, tiles shrink to fit
+		static constexpr size_t maxSide = 4096;
+
+		bool exportPng(Game const& game, const std::string& path) {
+			if (!artLoaded) {
+				rasterizer.loadArt("resources");
+				for (int hint = 1; hint <= 8; hint++)
+					rasterizer.setNumberColor(hint, Renderer::getNumberColor(hint));
+				artLoaded = true;
+			}
+			size_t rows = game.getRows(), cols = game.getCols();
+			tileKinds(game, kinds);
+			return rasterizer.exportPng(path, kinds.data(), rows, cols, BoardRasterizer::fitTileSize(rows, cols, maxSide));
+		}
+
+		// A SnapshotTile per tile of the game, row by row
+		static void tileKinds(Game const& game, std::vector<uint8_t>& kinds) {
+			size_t rows = game.getRows(), cols = game.getCols();
+			kinds.resize(rows * cols);
+			for (size_t row = 0; row < rows; row++)
+				for (size_t col = 0; col < cols; col++) {
+					SnapshotTile kind;
+					switch (game.getTileRenderState(row, col)) {
+					case TileState::Open:
+						kind = (SnapshotTile)((int)SnapshotTile::Open + game.getTile(row, col).getValue());
+						break;
+					case TileState::Flagged:
+						kind = SnapshotTile::Flagged;
+						break;
+					case TileState::Bomb:
+						kind = SnapshotTile::Bomb;
+						break;
+					default:
+						//A tile held down by the mouse is still closed
+						kind = SnapshotTile::Closed;
+						break;
+					}
+					kinds[row * cols + col] = (uint8_t)kind;
+				}
+		}
+
+	private:
+		BoardRasterizer rasterizer;
+		std::vector<uint8_t> kinds;
+		bool artLoaded = false;
+	};
+
+	// Frame cost of the grid mode without a window for 1, 2, 4 ... boards up to maxBoards, all
+	// played by bots: the parallel update, then recording and sorting the shared draw list. What
+	// the GPU does with the list is left out, a batch is counted wherever the texture changes.
+	inline int benchmarkBoardGrid(size_t maxBoards) {
+		TaskPool pool;
+		DrawList list;
+		const Renderer::TileTextures textures{ { 1, 30, 30, 1, 7 }, { 2, 30, 30, 1, 7 }, { 3, 30, 30, 1, 7 }, { 4, 20, 20, 1, 7 } };
+		const int frames = 600;
+		using Clock = std::chrono::steady_clock;
+		std::cout << "Board grid benchmark, " << pool.getThreadCount() << " threads, 16x16 medium boards, " << frames << " frames" << std::endl;
+		for (size_t count = 1; ; count = std::min(count * 2, maxBoards)) {
+			BoardGrid<IntermediateBoard> grid;
+			grid.start(count, Difficulty::Medium, { 0, 0, 1700, 900 });
+			double updateSeconds = 0.0, drawSeconds = 0.0;
+			size_t commands = 0, batches = 0;
+			for (int frame = 0; frame < frames; frame++) {
+				Clock::time_point start = Clock::now();
+				grid.update(pool, frame / 60.0);
+				Clock::time_point updated = Clock::now();
+				list.clear();
+				Renderer::recordBoardGrid(list, grid, textures);
+				uint64_t lastKey = UINT64_MAX;
+				list.forEachSorted([&](const DrawCommand& command) {
+					uint64_t key = (uint64_t)command.layer << 32 | DrawList::batchKey(command);
+					batches += key != lastKey;
+					lastKey = key;
+					});
+				commands += list.size();
+				drawSeconds += std::chrono::duration<double>(Clock::now() - updated).count();
+				updateSeconds += std::chrono::duration<double>(updated - start).count();
+			}
+			printf("%3zu boards: update %7.1f us/frame, draw list %7.1f us/frame (%.2f us per board), %zu commands in %zu batches, %zu won %zu lost\n",
+				count, updateSeconds * 1e6 / frames, drawSeconds * 1e6 / frames, (updateSeconds + drawSeconds) * 1e6 / frames / count,
+				commands / frames, batches / frames, grid.getWins(), grid.getLosses());
+			if (count == maxBoards)
+				return 0;
+		}
+	}
+
+	// Resident and peak resident bytes of this process, 0 where the OS doesn't tell
+	inline void processMemory(size_t& resident, size_t& peak) {
+		resident = peak = 0;
+#if defined(__linux__)
+		std::ifstream status{ "/proc/self/status" };
+		std::string line;
+		while (std::getline(status, line)) {
+			if (line.rfind("VmRSS:", 0) == 0)
+				resident = std::stoull(line.substr(6)) * 1024;
+			else if (line.rfind("VmHWM:", 0) == 0)
+				peak = std::stoull(line.substr(6)) * 1024;
+		}
+#endif
+	}
+
+	// Generation and the cascade of the first click on one side x side board with 5% mines, where
+	// one region spans most of the board. Throughput and memory of both, once with every plane on
+	// the heap and once with every plane in a mapped file.
+	inline int benchmarkLargeBoard(size_t side) {
+		using Clock = std::chrono::steady_clock;
+		const double mib = 1024.0 * 1024.0;
+		size_t tiles = side * side;
+		size_t threshold = mappedStorageBytes;
+		std::cout << "Large board benchmark, " << side << "x" << side << " board with 5% mines, " << sizeof(Tile) << " byte tiles" << std::endl;
+		for (bool mapped : { false, true }) {
+			mappedStorageBytes = mapped ? 0 : SIZE_MAX;
+			size_t resident, peak;
+			SizeConfig config;
+			Game game{ config };
+			game.setBoardPool(nullptr);
+			game.setRevealBudget(size_t(1) << 20);
+			Clock::time_point start = Clock::now();
+			game.startGame(side, side, Board::minesFor(tiles, 0.05f));
+			double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+			processMemory(resident, peak);
+			printf("%s generate: %.2f s, %.1f M tiles/s, rss %.0f MiB, peak %.0f MiB\n", mapped ? "mapped" : "heap  ",
+				seconds, tiles / seconds / 1e6, resident / mib, peak / mib);
+
+			//The first click is safe, so the middle tile is a zero and floods its region
+			ChangeSet changes;
+			size_t opened = 0, frames = 0;
+			start = Clock::now();
+			game.openTile(side / 2, side / 2);
+			do {
+				game.update();
+				game.takeChanges(changes);
+				opened += changes.opened.size();
+				frames++;
+			} while (game.isRevealing());
+			seconds = std::chrono::duration<double>(Clock::now() - start).count();
+			processMemory(resident, peak);
+			printf("%s first click: %zu tiles in %zu frames, %.2f s, %.1f M tiles/s, rss %.0f MiB, peak %.0f MiB\n", mapped ? "mapped" : "heap  ",
+				opened, frames, seconds, opened / seconds / 1e6, resident / mib, peak / mib);
+		}
+		mappedStorageBytes = threshold;
+		return 0;
+	}
+
+	// The heatmap's time from a frame's changes to its result by the size of the frontier, on
+	// side x side boards a bot plays on after losing. The frame waits for every result.
+	inline int benchmarkHeatmap(size_t side) {
+		std::cout << "Heatmap benchmark, " << side << "x" << side << " boards with 15% mines, latency by frontier tiles" << std::endl;
+		const size_t bucketLimits[] = { 64, 256, 1024, 4096, 16384, SIZE_MAX };
+		const size_t bucketCount = sizeof(bucketLimits) / sizeof(bucketLimits[0]);
+		std::vector<double> latencies[bucketCount];
+		size_t enumerated[bucketCount] = {}, components[bucketCount] = {}, unsolved[bucketCount] = {};
+		MineProbability heatmap;
+		heatmap.setEnabled(true);
+		ChangeSet changes;
+		size_t samples = 0, timeouts = 0;
+		for (uint32_t round = 0; samples < 3000 && round < 50; round++) {
+			SizeConfig config;
+			Game game{ config };
+			game.setBoardPool(nullptr);
+			AutoPlayer bot{ round };
+			game.startGame(side, side, Board::minesFor(side * side, 0.15f));
+			for (int frame = 0; frame < 4000 && game.getGameState() != GameState::Won; frame++) {
+				if (game.getGameState() == GameState::Lost)
+					game.continueGame();
+				bot.step(game);
+				game.update();
+				game.takeChanges(changes);
+				bot.observe(game, changes);
+				if (changes.empty())
+					continue;
+				heatmap.apply(changes, game.getRows(), game.getCols(), game.getBombTotal(), [&game](size_t index) {
+					const Tile& tile = game.getTile(index / game.getCols(), index % game.getCols());
+					return tile.isBomb() ? -1 : tile.getValue();
+					});
+				double deadline = GetTime() + 5.0;
+				bool ready = false;
+				while (!(ready = heatmap.poll()) && GetTime() < deadline)
+					std::this_thread::sleep_for(std::chrono::microseconds(20));
+				if (!ready) {
+					timeouts++;
+					continue;
+				}
+				const MineProbability::Stats& stats = heatmap.getStats();
+				size_t bucket = 0;
+				while (stats.frontierTiles >= bucketLimits[bucket])
+					bucket++;
+				latencies[bucket].push_back(stats.latency * 1e3);
+				enumerated[bucket] += stats.enumerated;
+				components[bucket] += stats.components;
+				unsolved[bucket] += stats.unsolved;
+				samples++;
+			}
+		}
+		printf("frontier tiles  results   avg ms   p50 ms   p99 ms   max ms  components  enumerated  unsolved\n");
+		for (size_t bucket = 0; bucket < bucketCount; bucket++) {
+			std::vector<double>& times = latencies[bucket];
+			if (times.empty())
+				continue;
+			std::sort(times.begin(), times.end());
+			double sum = 0.0;
+			for (double time : times)
+				sum += time;
+			size_t count = times.size();
+			char range[32];
+			if (bucketLimits[bucket] == SIZE_MAX)
+				snprintf(range, sizeof(range), "%zu+", bucketLimits[bucket - 1]);
+			else
+				snprintf(range, sizeof(range), "< %zu", bucketLimits[bucket]);
+			printf("%14s %8zu %8.3f %8.3f %8.3f %8.3f %11.1f %11.1f %9.1f\n", range, count, sum / count, times[count / 2],
+				times[count * 99 / 100], times.back(), (double)components[bucket] / count, (double)enumerated[bucket] / count,
+				(double)unsolved[bucket] / count);
+		}
+		if (timeouts > 0)
+			printf("%zu results took longer than 5 s\n", timeouts);
+		return 0;
+	}
+
+	// Startup with a records log of count wins: writing it, the first open that rebuilds the index
+	// and compacts or writes the snapshot, and the open after that, which reads the snapshot. Once
+	// with a few configurations where most games can never rank, once with so many that every
+	// game is kept and nothing can be compacted.
+	inline int benchmarkRecords(size_t count) {
+		using Clock = std::chrono::steady_clock;
+		const double mib = 1024.0 * 1024.0;
+		std::error_code error;
+		std::string path = (std::filesystem::temp_directory_path(error) / "minesweeper-bench.msrl").string();
+		std::cout << "Records benchmark, " << count << " wins, " << count * sizeof(GameRecord) / mib << " MiB log at " << path << std::endl;
+		printf("configs     write ms  first open ms  log after  reopen ms  best() ns  rss MiB\n");
+		for (size_t configs : { (size_t)64, std::max<size_t>(count / RecordStore::topCount, 1) }) {
+			std::filesystem::remove(path, error);
+			std::filesystem::remove(path + ".top", error);
+			{
+				//A store starts the log with its header, the wins are appended in one go
+				RecordStore store;
+				if (!store.open(path))
+					return 1;
+			}
+			std::mt19937 rng{ 48 };
+			std::uniform_int_distribution<uint32_t> millis{ 1000, 600000 };
+			std::vector<GameRecord> batch(65536);
+			Clock::time_point start = Clock::now();
+			std::ofstream out(path, std::ios::binary | std::ios::app);
+			for (size_t written = 0; written < count;) {
+				size_t size = std::min(batch.size(), count - written);
+				for (size_t i = 0; i < size; i++) {
+					GameRecord& record = batch[i];
+					uint32_t config = (uint32_t)((written + i) % configs);
+					record.rows = 9 + config % 64;
+					record.cols = 9 + config / 64 % 64;
+					record.mines = 10 + config / 4096;
+					record.seed = (uint32_t)(written + i);
+					record.millis = millis(rng);
+					record.finishedAt = 1700000000u + (uint32_t)(written + i);
+					record.checksum = RecordStore::checksum(record);
+				}
+				out.write(reinterpret_cast<const char*>(batch.data()), (std::streamsize)(size * sizeof(GameRecord)));
+				written += size;
+			}
+			out.close();
+			double writeSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+			if (!out) {
+				std::cerr << "Records benchmark: can't write " << path << std::endl;
+				return 1;
+			}
+
+			RecordStore store;
+			start = Clock::now();
+			store.open(path);
+			double firstSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+			size_t logAfter = store.getLogRecords();
+			start = Clock::now();
+			store.open(path);
+			double reopenSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+			const size_t lookups = 1000000;
+			size_t found = 0;
+			start = Clock::now();
+			for (size_t i = 0; i < lookups; i++) {
+				uint32_t config = (uint32_t)(i * 7919 % configs);
+				found += store.best({ 9 + config % 64, 9 + config / 64 % 64, 10 + config / 4096 }).size();
+			}
+			double lookupSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+			size_t resident, peak;
+			processMemory(resident, peak);
+			printf("%7zu %12.1f %14.1f %10zu %10.1f %10.1f %8.0f\n", configs, writeSeconds * 1e3, firstSeconds * 1e3, logAfter,
+				reopenSeconds * 1e3, lookupSeconds * 1e9 / lookups, resident / mib);
+			if (found == 0)
+				std::cerr << "Records benchmark: no configuration has records" << std::endl;
+		}
+		std::filesystem::remove(path, error);
+		std::filesystem::remove(path + ".top", error);
+		return 0;
+	}
+
+	// Counting the mines around every tile of a side x side board with 20% mines through
+	// Neighborhood, against the lambda over a vector of offsets that loopAdjTiles used before, once
+	// with the vector built for every tile as loopAdjTiles did and once built for the whole pass
+	// as the old placeHints did
+	inline int benchmarkNeighbors(size_t side) {
+		using Clock = std::chrono::steady_clock;
+		LayoutMatrix<Tile, BoardLayout> tiles{ side, side };
+		std::mt19937 rng{ 26 };
+		std::bernoulli_distribution mine{ 0.2 };
+		for (size_t row = 0; row < side; row++)
+			for (size_t col = 0; col < side; col++)
+				tiles[row][col] = Tile{ 0, mine(rng), TileState::Closed };
+		std::cout << "Neighbor benchmark, " << side << "x" << side << " board with 20% mines" << std::endl;
+
+		auto vectorPath = [&tiles, side](size_t row, size_t col, const std::vector<std::pair<int, int>>& offsets, auto callOnTiles) {
+			for (auto& [dx, dy] : offsets) {
+				size_t newRow = row + dx;
+				size_t newCol = col + dy;
+				if (newRow < side && newCol < side)
+					callOnTiles(tiles[newRow][newCol]);
+			}
+		};
+		auto pass = [&tiles, side](const char* name, auto countAround) {
+			const int rounds = 5;
+			size_t total = 0;
+			Clock::time_point start = Clock::now();
+			for (int round = 0; round < rounds; round++)
+				for (size_t row = 0; row < side; row++)
+					for (size_t col = 0; col < side; col++)
+						total += countAround(row, col);
+			double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+			printf("%-22s %6.2f ns per tile (%zu)\n", name, seconds * 1e9 / (rounds * side * side), total / rounds);
+			return seconds;
+		};
+
+		double perTile = pass("vector for every tile", [&vectorPath](size_t row, size_t col) {
+			std::vector<std::pair<int, int>>
+				offsets{ {-1,-1},{-1, 0},{-1,1},
+						 { 0,-1}        ,{ 0,1},
+						 { 1,-1},{ 1, 0},{ 1,1} };
+			int bombCount = 0;
+			vectorPath(row, col, offsets, [&bombCount](Tile& tile) { bombCount += tile.isBomb(); });
+			return bombCount;
+			});
+		const std::vector<std::pair<int, int>>
+			offsets{ {-1,-1},{-1, 0},{-1,1},
+					 { 0,-1}        ,{ 0,1},
+					 { 1,-1},{ 1, 0},{ 1,1} };
+		double perPass = pass("vector for the pass", [&vectorPath, &offsets](size_t row, size_t col) {
+			int bombCount = 0;
+			vectorPath(row, col, offsets, [&bombCount](Tile& tile) { bombCount += tile.isBomb(); });
+			return bombCount;
+			});
+		double neighborhood = pass("Neighborhood", [&tiles, side](size_t row, size_t col) {
+			int bombCount = 0;
+			Neighborhood<SquareTopology>::forEach(row, col, side, side, [&tiles, &bombCount](size_t newRow, size_t newCol) {
+				bombCount += tiles[newRow][newCol].isBomb();
+				});
+			return bombCount;
+			});
+		printf("Neighborhood is %.1fx as fast as a vector for every tile, %.1fx as a vector for the pass\n",
+			perTile / neighborhood, perPass / neighborhood);
+		return 0;
+	}
+
+	// Drawing the mines of one side x side board with every sampling strategy, from 1% to 90% of the
+	// tiles, and which one Auto picks
+	inline int benchmarkDensities(size_t side) {
+		using Clock = std::chrono::steady_clock;
+		const size_t total = side * side;
+		const SamplingStrategy strategies[] = { SamplingStrategy::Floyd, SamplingStrategy::FisherYates, SamplingStrategy::Complement, SamplingStrategy::Auto };
+		const char* names[] = { "auto", "floyd", "fisher-yates", "complement" };
+		std::cout << "Density benchmark, " << side << "x" << side << " board, ms per draw" << std::endl;
+		printf("density %12s %12s %12s %12s  auto picks\n", names[1], names[2], names[3], names[0]);
+		MineSampler sampler;
+		std::mt19937 rng{ 43 };
+		for (float density : { 0.01f, 0.05f, 0.1f, 0.2f, 0.3f, 0.4f, 0.5f, 0.6f, 0.7f, 0.8f, 0.9f }) {
+			size_t count = Board::minesFor(total, density);
+			double ms[4];
+			size_t sum = 0;
+			for (int k = 0; k < 4; k++) {
+				sampler.setStrategy(strategies[k]);
+				//The first draw sizes the buffers, boards are drawn again into the same ones
+				sampler.sample(count, total, rng, [&sum](size_t index) { sum += index; });
+				const int draws = 3;
+				Clock::time_point start = Clock::now();
+				for (int draw = 0; draw < draws; draw++)
+					sampler.sample(count, total, rng, [&sum](size_t index) { sum += index; });
+				ms[k] = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / draws;
+			}
+			printf("%6d%% %12.2f %12.2f %12.2f %12.2f  %s (%zu)\n", (int)std::lround(density * 100), ms[0], ms[1], ms[2], ms[3],
+				names[(size_t)MineSampler::pick(count, total)], sum % 10);
+		}
+		return 0;
+	}
+
+	// The passes a board makes over its tiles with one memory layout on a rows x cols board with 5%
+	// mines: the hints in bands, a flood fill through the zero tiles from the middle and reading
+	// 64x64 viewports at random spots
+	template<typename Layout>
+	inline void benchmarkLayout(const char* name, size_t rows, size_t cols) {
+		using Clock = std::chrono::steady_clock;
+		LayoutMatrix<Tile, Layout> tiles{ rows, cols };
+		std::mt19937 rng{ 35 };
+		std::bernoulli_distribution mine{ 0.05 };
+		for (size_t row = 0; row < rows; row++)
+			for (size_t col = 0; col < cols; col++)
+				tiles[row][col] = Tile{ 0, mine(rng), TileState::Closed };
+
+		Clock::time_point start = Clock::now();
+		tiles.forEachBand(size_t(4) << 20, [&tiles, rows, cols](size_t row, size_t col, Tile& tile) {
+			if (tile.isBomb())
+				return;
+			int count = 0;
+			Neighborhood<SquareTopology>::forEach(row, col, rows, cols, [&tiles, &count](size_t r, size_t c) {
+				count += tiles[r][c].isBomb();
+				});
+			tile = Tile{ count };
+			});
+		double hints = std::chrono::duration<double>(Clock::now() - start).count();
+
+		size_t seed = rows / 2 * cols + cols / 2;
+		while (seed < rows * cols && (tiles[seed / cols][seed % cols].isBomb() || tiles[seed / cols][seed % cols].getValue() != 0))
+			seed++;
+		std::vector<size_t> stack{ seed };
+		size_t filled = 0;
+		start = Clock::now();
+		tiles[seed / cols][seed % cols].setState(TileState::Open);
+		while (!stack.empty()) {
+			size_t index = stack.back();
+			stack.pop_back();
+			filled++;
+			if (tiles[index / cols][index % cols].getValue() != 0)
+				continue;
+			Neighborhood<SquareTopology>::forEach(index / cols, index % cols, rows, cols, [&](size_t r, size_t c) {
+				Tile& tile = tiles[r][c];
+				if (tile.getState() != TileState::Open && !tile.isBomb()) {
+					tile.setState(TileState::Open);
+					stack.push_back(r * cols + c);
+				}
+				});
+		}
+		double flood = std::chrono::duration<double>(Clock::now() - start).count();
+
+		const size_t view = 64, views = 4000;
+		size_t sum = 0;
+		start = Clock::now();
+		for (size_t v = 0; v < views; v++) {
+			size_t top = rng() % (rows - view), left = rng() % (cols - view);
+			for (size_t row = top; row < top + view; row++)
+				for (size_t col = left; col < left + view; col++)
+					sum += tiles[row][col].getValue() + (tiles[row][col].getState() == TileState::Open);
+		}
+		double viewports = std::chrono::duration<double>(Clock::now() - start).count();
+		printf("%-10s hints %7.1f ms, flood fill %7.1f ms (%zu tiles), %zu viewports %6.1f ms (%zu)\n",
+			name, hints * 1e3, flood * 1e3, filled, views, viewports * 1e3, sum);
+	}
+
+	// BoardLayout is picked from this one, cols wide and a sixteenth as many rows
+	inline int benchmarkLayouts(size_t cols) {
+		size_t rows = std::max<size_t>(cols / 16, 128);
+		std::cout << "Layout benchmark, " << rows << "x" << cols << " board, " << sizeof(Tile) << " byte tiles" << std::endl;
+		benchmarkLayout<RowMajorLayout>("row major", rows, cols);
+		benchmarkLayout<TiledLayout<3>>("tiled 8", rows, cols);
+		benchmarkLayout<TiledLayout<4>>("tiled 16", rows, cols);
+		benchmarkLayout<MortonLayout<4>>("morton 16", rows, cols);
+		return 0;
+	}
+
+	// A long game recorded on one side x side board: the moves that wrote a keyframe against the
+	// others, and what reading every tile for a full keyframe would cost each of them instead
+	inline int benchmarkReplay(size_t side) {
+		using Clock = std::chrono::steady_clock;
+		const char* path = "minesweeper-bench.msrp";
+		const size_t moves = 20000;
+		std::cout << "Replay benchmark, " << side << "x" << side << " medium board, " << moves << " moves" << std::endl;
+		SizeConfig config;
+		Game game{ config };
+		game.setBoardPool(nullptr);
+		game.setRevealBudget(0);
+		game.setReplayFile(path);
+		game.startGame(side, side, Difficulty::Medium);
+		game.openTile(side / 2, side / 2);
+
+		std::mt19937 rng{ 44 };
+		std::vector<double> micros;
+		micros.reserve(moves);
+		while (micros.size() < moves && game.getGameState() == GameState::Ongoing) {
+			size_t row = rng() % side, col = rng() % side;
+			if (game.getTileState(row, col) == TileState::Open)
+				continue;
+			//Mostly flags, safe tiles are opened now and then so cascades and numbers show up
+			Move move{ row, col, game.getTile(row, col).isBomb() || rng() % 8 != 0 ? MoveType::Flag : MoveType::Open };
+			Clock::time_point start = Clock::now();
+			game.applyMoves(&move, 1);
+			micros.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+		}
+		game.setReplayFile("");
+
+		ReplayReader reader;
+		if (!reader.open(path)) {
+			std::remove(path);
+			return 1;
+		}
+		std::ifstream file{ path, std::ios::binary | std::ios::ate };
+		double bytes = (double)file.tellg();
+		file.close();
+		//The move after every interval moves writes the keyframe, the first click came before them
+		size_t interval = reader.getHeader().keyframeInterval;
+		std::vector<double> keyframeMicros, moveMicros;
+		for (size_t i = 0; i < micros.size(); i++)
+			((i + 1) % interval == 0 ? keyframeMicros : moveMicros).push_back(micros[i]);
+
+		Clock::time_point start = Clock::now();
+		size_t runs = 1;
+		for (size_t index = 1; index < side * side; index++)
+			runs += game.getTileState(index / side, index % side) != game.getTileState((index - 1) / side, (index - 1) % side);
+		double scanMicros = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+		//Seeks to random moves from wherever the one before left off, and from the start to the
+		//moves right before a keyframe or the end, which restore the keyframe before and apply
+		//the longest run of moves after one
+		std::vector<uint64_t> worstTargets;
+		for (uint64_t target = 1; target <= reader.getMoveCount(); target++) {
+			if (target == reader.getMoveCount() || reader.keyframeAtOrBefore(target) != reader.keyframeAtOrBefore(target + 1))
+				worstTargets.push_back(target);
+		}
+		SizeConfig viewerConfig;
+		Game viewer{ viewerConfig };
+		ReplayViewer replay;
+		std::vector<double> randomSeekMicros, worstSeekMicros;
+		if (replay.open(path, viewer)) {
+			for (size_t i = 0; i < 500; i++) {
+				uint64_t target = rng() % (replay.getMoveCount() + 1);
+				start = Clock::now();
+				replay.seek(viewer, target);
+				randomSeekMicros.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+			}
+			for (size_t i = 0; i < 100 && !worstTargets.empty(); i++) {
+				replay.seek(viewer, 0);
+				start = Clock::now();
+				replay.seek(viewer, worstTargets[i % worstTargets.size()]);
+				worstSeekMicros.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+			}
+			replay.close(viewer);
+		}
+		std::remove(path);
+
+		auto report = [](const char* what, std::vector<double>& values) {
+			if (values.empty())
+				return;
+			std::sort(values.begin(), values.end());
+			double sum = 0.0;
+			for (double value : values)
+				sum += value;
+			printf("  %-14s %6zu, avg %8.1f us, p50 %8.1f us, p99 %8.1f us, max %8.1f us\n", what, values.size(), sum / values.size(),
+				values[values.size() / 2], values[values.size() * 99 / 100], values.back());
+		};
+		printf("keyframe every %zu moves, %.1f bytes per move\n", interval, bytes / micros.size());
+		report("moves", moveMicros);
+		report("keyframe moves", keyframeMicros);
+		printf("  reading all %zu tiles for a full keyframe of %zu runs: %.1f us\n", side * side, runs, scanMicros);
+		report("random seeks", randomSeekMicros);
+		report("worst seeks", worstSeekMicros);
+		return 0;
+	}
+
+	// Same regions with the same tiles and the same metrics, region ids may differ
+	inline bool sameRegions(Board& patched, Board& fresh, size_t tileCount) {
+		const BoardRegions& a = patched.getRegions();
+		const BoardRegions& b = fresh.getRegions();
+		std::vector<uint64_t> toFresh(a.size(), BoardRegions::none), toPatched(b.size(), BoardRegions::none);
+		for (size_t index = 0; index < tileCount; index++) {
+			uint64_t ra = a.regionOf(index), rb = b.regionOf(index);
+			if ((ra == BoardRegions::none) != (rb == BoardRegions::none))
+				return false;
+			if (ra == BoardRegions::none)
+				continue;
+			if (toFresh[ra] == BoardRegions::none && toPatched[rb] == BoardRegions::none) {
+				toFresh[ra] = rb;
+				toPatched[rb] = ra;
+			}
+			if (toFresh[ra] != rb || toPatched[rb] != ra)
+				return false;
+		}
+		std::vector<uint64_t> tilesA, tilesB;
+		for (uint64_t rb = 0; rb < b.size(); rb++) {
+			tilesA.clear();
+			tilesB.clear();
+			a.forEachSpan(toPatched[rb], [&tilesA](BoardRegions::Span span) { tilesA.insert(tilesA.end(), span.begin(), span.end()); });
+			b.forEachSpan(rb, [&tilesB](BoardRegions::Span span) { tilesB.insert(tilesB.end(), span.begin(), span.end()); });
+			std::sort(tilesA.begin(), tilesA.end());
+			tilesA.erase(std::unique(tilesA.begin(), tilesA.end()), tilesA.end());
+			std::sort(tilesB.begin(), tilesB.end());
+			if (tilesA != tilesB)
+				return false;
+		}
+		const BoardMetrics& ma = patched.getMetrics();
+		const BoardMetrics& mb = fresh.getMetrics();
+		return ma.openings == mb.openings && ma.isolatedNumbers == mb.isolatedNumbers && ma.bbbv == mb.bbbv;
+	}
+
+	// First clicks on random boards of every density. The patched board has to match one built
+	// from scratch on the same mines: hints, regions and metrics.
+	inline bool checkFirstClick() {
+		std::mt19937 rng{ 27 };
+		const float densities[] = { 0.02f, 0.1f, 0.2f, 0.3f, 0.5f, 0.8f, 0.95f };
+		size_t clicks = 0, local = 0, bad = 0;
+		Board board, fresh;
+		std::vector<size_t> mines;
+		for (uint32_t round = 0; round < 700; round++) {
+			size_t rows = 4 + rng() % 80, cols = 4 + rng() % 80;
+			board.seed(round);
+			board.regenerate(rows, cols, Board::minesFor(rows * cols, densities[round % 7]));
+			size_t mineCount = board.getBombs();
+			//A reset clears another area of the same board
+			for (int click = 0; click < 3; click++) {
+				size_t row = rng() % rows, col = rng() % cols;
+				board.clearArea(row, col);
+				clicks++;
+				local += board.wasClearedLocally();
+
+				mines.clear();
+				for (size_t index = 0; index < rows * cols; index++) {
+					if (board[index / cols][index % cols].isBomb())
+						mines.push_back(index);
+				}
+				fresh.resize(rows, cols);
+				fresh.setMines(mines);
+				bool same = mines.size() == mineCount;
+				for (size_t index = 0; index < rows * cols; index++) {
+					const Tile& patched = board[index / cols][index % cols];
+					same &= patched.getValue() == fresh[index / cols][index % cols].getValue();
+				}
+				if (mines.size() < rows * cols - 9) {
+					for (int dr = -1; dr <= 1; dr++)
+						for (int dc = -1; dc <= 1; dc++) {
+							size_t r = row + dr, c = col + dc;
+							same &= r >= rows || c >= cols || !board[r][c].isBomb();
+						}
+				}
+				if (!same) {
+					std::cerr << "First click " << row << ", " << col << " on " << rows << "x" << cols << " board " << round << " patched the hints wrong" << std::endl;
+					bad++;
+				}
+				if (!sameRegions(board, fresh, rows * cols)) {
+					std::cerr << "First click " << row << ", " << col << " on " << rows << "x" << cols << " board " << round << " patched the regions wrong" << std::endl;
+					bad++;
+				}
+			}
+		}
+		printf("first-click: %zu clicks, %zu moved their mines to spares, %zu mismatches\n", clicks, local, bad);
+		return bad == 0;
+	}
+
+	// --check <name|all>, exits with 1 if a check fails
+	// Random games played with moves that change nothing mixed in: opening, flagging and chording
+	// an open tile and chording a number without its flags. Only moves that changed a tile count
+	// as clicks and the no-ops must leave every tile as it was. With sliced reveal half the moves
+	// come while a cascade is still opening, a loss has to finish it as instant reveal does, so no
+	// open zero is left next to a closed tile.
+	inline bool checkClicks() {
+		std::mt19937 rng{ 37 };
+		size_t games = 0, noops = 0, losses = 0, bad = 0;
+		for (uint32_t round = 0; round < 200; round++) {
+			SizeConfig config;
+			Game game{ config };
+			game.setBoardPool(nullptr);
+			game.setRevealBudget(round % 2 ? 0 : 16);
+			size_t rows = 4 + rng() % 30, cols = 4 + rng() % 30;
+			game.startGame(rows, cols, round % 3 ? Difficulty::Easy : Difficulty::Medium);
+			games++;
+			for (int step = 0; step < 200 && game.getGameState() == GameState::Ongoing; step++) {
+				while (game.isRevealing() && rng() % 2 == 0)
+					game.update();
+				//The end of a cascade may have won the game
+				if (game.getGameState() != GameState::Ongoing)
+					break;
+				size_t row = rng() % rows, col = rng() % cols;
+				TileState before = game.getTileState(row, col);
+				const Tile& tile = game.getTile(row, col);
+				if (before == TileState::Open && !game.isChordReady(row, col)) {
+					size_t clicks = game.getClicks();
+					std::vector<TileState> states;
+					for (size_t index = 0; index < rows * cols; index++)
+						states.push_back(game.getTileState(index / cols, index % cols));
+					game.openTile(row, col);
+					game.toggleFlag(row, col);
+					game.fastOpen(row, col);
+					noops += 3;
+					bool same = game.getClicks() == clicks;
+					for (size_t index = 0; index < rows * cols; index++)
+						same &= game.getTileState(index / cols, index % cols) == states[index];
+					if (!same) {
+						std::cerr << "Moves on open tile " << row << ", " << col << " of game " << round << " changed the game" << std::endl;
+						bad++;
+					}
+					continue;
+				}
+				if (before != TileState::Closed || (tile.isBomb() && rng() % 4 != 0))
+					continue;
+				size_t clicks = game.getClicks();
+				//Now and then a mine is opened instead of flagged, which loses the game
+				if (tile.isBomb() && rng() % 8 != 0)
+					game.toggleFlag(row, col);
+				else
+					game.openTile(row, col);
+				if (game.getClicks() != clicks + 1) {
+					std::cerr << "Move on closed tile " << row << ", " << col << " of game " << round << " counted " << game.getClicks() - clicks << " clicks" << std::endl;
+					bad++;
+				}
+			}
+			if (game.getGameState() != GameState::Lost)
+				continue;
+			losses++;
+			game.continueGame();
+			size_t halfOpened = 0;
+			for (size_t index = 0; index < rows * cols; index++) {
+				size_t row = index / cols, col = index % cols;
+				if (game.getTileState(row, col) != TileState::Open || game.getTile(row, col).isBomb() || game.getTile(row, col).getValue() != 0)
+					continue;
+				Neighborhood<SquareTopology>::forEach(row, col, rows, cols, [&](size_t newRow, size_t newCol) {
+					halfOpened += game.getTileState(newRow, newCol) == TileState::Closed;
+					});
+			}
+			if (halfOpened > 0 || game.isRevealing()) {
+				std::cerr << "Game " << round << " was lost with a cascade opening, " << halfOpened << " closed tiles next to open zeros"
+					<< (game.isRevealing() ? " and the cascade still pending" : "") << std::endl;
+				bad++;
+			}
+		}
+		printf("clicks: %zu games, %zu losses, %zu moves that changed nothing, %zu mismatches\n", games, losses, noops, bad);
+		return bad == 0;
+	}
+
+	// Scripted games on boards of every size with instant and sliced reveal, boards from the
+	// shared pool and the replay recorded as the app does: once the first move is made, moves,
+	// cascade slices, recording them and taking the changes every frame must not allocate
+	inline bool checkAllocations() {
+		const char* path = "minesweeper-check-alloc.msrp";
+		AllocTracker::trackThisThread();
+		std::mt19937 rng{ 38 };
+		size_t frames = 0, bad = 0;
+		ChangeSet changes;
+		for (uint32_t round = 0; round < 24; round++) {
+			SizeConfig config;
+			Game game{ config };
+			game.setReplayFile(path);
+			game.setRevealBudget(round % 2 ? 0 : 64);
+			size_t rows = 8 + rng() % 250, cols = 8 + rng() % 250;
+			game.startGame(rows, cols, round % 3 ? Difficulty::Easy : Difficulty::Medium);
+			game.openTile(rows / 2, cols / 2);
+			game.update();
+			game.takeChanges(changes);
+			game.takeChanges(changes);
+			for (int frame = 0; frame < 2000 && game.isInProgress(); frame++) {
+				AllocCounts before = AllocTracker::getTotals();
+				//A frame with a move most of the time, the move may do nothing
+				if (rng() % 4 != 0) {
+					size_t row = rng() % rows, col = rng() % cols;
+					const Tile& tile = game.getTile(row, col);
+					Move move{ row, col, MoveType::Chord };
+					if (game.getTileState(row, col) == TileState::Closed)
+						move.type = tile.isBomb() ? MoveType::Flag : MoveType::Open;
+					game.applyMoves(&move, 1);
+				}
+				game.update();
+				game.takeChanges(changes);
+				AllocCounts after = AllocTracker::getTotals();
+				frames++;
+				if (after.allocations != before.allocations) {
+					std::cerr << "Frame " << frame << " of game " << round << " on a " << rows << "x" << cols << " board allocated "
+						<< after.allocations - before.allocations << " times (" << after.bytes - before.bytes << " bytes)" << std::endl;
+					bad++;
+				}
+			}
+			game.setReplayFile("");
+		}
+		std::remove(path);
+		printf("allocations: %zu frames, %zu allocated\n", frames, bad);
+		return bad == 0;
+	}
+
+	// Random moves on recorded games with instant and sliced reveal that are taken back, some right
+	// away and some after the cascade they started opened over a few frames, losing ones too. After
+	// an undo every tile, the mine counter, the 3BV solved and the game state have to be as they
+	// were before the move, and the replay of every game has to end on the board the game ended on.
+	inline bool checkUndo() {
+		const char* path = "minesweeper-check-undo.msrp";
+		std::mt19937 rng{ 30 };
+		size_t undone = 0, bad = 0;
+		ReplayViewer replay;
+		for (uint32_t round = 0; round < 120 && bad < 10; round++) {
+			SizeConfig config, viewerConfig;
+			Game game{ config }, viewer{ viewerConfig };
+			game.setBoardPool(nullptr);
+			game.setRevealBudget(round % 2 ? 0 : 16);
+			game.setReplayFile(path);
+			size_t rows = 4 + rng() % 40, cols = 4 + rng() % 40;
+			game.startGame(rows, cols, round % 3 ? Difficulty::Easy : Difficulty::Medium);
+			std::vector<TileState> before(rows * cols);
+			auto sameTiles = [&]() {
+				for (size_t index = 0; index < rows * cols; index++) {
+					if (game.getTileState(index / cols, index % cols) != before[index])
+						return false;
+				}
+				return true;
+			};
+			for (int step = 0; step < 300 && game.getGameState() != GameState::Won && bad < 10; step++) {
+				if (game.getGameState() == GameState::Lost)
+					game.continueGame();
+				while (game.isRevealing())
+					game.update();
+				if (game.getGameState() != GameState::Ongoing)
+					continue;
+				for (size_t index = 0; index < rows * cols; index++)
+					before[index] = game.getTileState(index / cols, index % cols);
+				size_t bombs = game.getBombs(), solved = game.getSolvedBBBV(), clicks = game.getClicks();
+				size_t row = rng() % rows, col = rng() % cols;
+				const Tile& tile = game.getTile(row, col);
+				Move move{ row, col, MoveType::Chord };
+				if (game.getTileState(row, col) != TileState::Open)
+					move.type = tile.isBomb() && rng() % 6 != 0 ? MoveType::Flag : MoveType::Open;
+				game.applyMoves(&move, 1);
+				for (int frame = rng() % 3; frame > 0; frame--)
+					game.update();
+				//A move that changed nothing leaves the one before it to undo
+				if (rng() % 3 != 0 || game.getClicks() == clicks || !game.canUndo())
+					continue;
+				game.undo();
+				undone++;
+				if (!sameTiles() || game.getBombs() != bombs || game.getSolvedBBBV() != solved || game.getGameState() != GameState::Ongoing || game.isRevealing()) {
+					std::cerr << "Undoing move " << step << " of game " << round << " on " << row << ", " << col << " left "
+						<< (sameTiles() ? "the counters" : "the tiles") << " changed" << std::endl;
+					bad++;
+				}
+			}
+			while (game.isRevealing())
+				game.update();
+			game.setReplayFile("");
+			for (size_t index = 0; index < rows * cols; index++)
+				before[index] = game.getTileState(index / cols, index % cols);
+			if (!replay.open(path, viewer))
+				continue;
+			replay.close(viewer);
+			bool same = viewer.getGameState() == game.getGameState();
+			for (size_t index = 0; index < rows * cols; index++)
+				same &= viewer.getTileState(index / cols, index % cols) == before[index];
+			if (!same) {
+				std::cerr << "The replay of game " << round << " ended on another board" << std::endl;
+				bad++;
+			}
+		}
+		std::remove(path);
+		printf("undo: %zu moves taken back, %zu mismatches\n", undone, bad);
+		return bad == 0;
+	}
+
+	// Recorded games with instant and sliced reveal, batches of moves, losses that go on and undos.
+	// The tiles and the game state are kept for every move the replay counts, as they were right
+	// before the next one. Seeks to random moves, forward and back, and to the moves right before
+	// a keyframe have to land on the board the game had at that move.
+	inline bool checkReplaySeek() {
+		const char* path = "minesweeper-check-seek.msrp";
+		std::mt19937 rng{ 44 };
+		size_t seeks = 0, bad = 0;
+		SizeConfig viewerConfig;
+		Game viewer{ viewerConfig };
+		ReplayViewer replay;
+		ReplayReader reader;
+		//The tiles and the game state at every move, none for moves inside a batch
+		std::vector<std::vector<TileState>> boards;
+		std::vector<GameState> states;
+		for (uint32_t round = 0; round < 60 && bad < 10; round++) {
+			SizeConfig config;
+			Game game{ config };
+			game.setBoardPool(nullptr);
+			game.setRevealBudget(round % 2 ? 0 : 8);
+			game.setReplayFile(path);
+			size_t rows = 4 + rng() % 60, cols = 4 + rng() % 60;
+			game.startGame(rows, cols, round % 3 ? Difficulty::Easy : Difficulty::Medium);
+			boards.clear();
+			states.clear();
+			auto keep = [&]() {
+				boards.resize(game.getClicks() + 1);
+				states.resize(game.getClicks() + 1, GameState::Ongoing);
+				std::vector<TileState>& tiles = boards[game.getClicks()];
+				tiles.resize(rows * cols);
+				for (size_t index = 0; index < rows * cols; index++)
+					tiles[index] = game.getTileState(index / cols, index % cols);
+				states[game.getClicks()] = game.getGameState();
+			};
+			std::vector<Move> batch;
+			for (int step = 0; step < 1500 && game.getGameState() != GameState::Won; step++) {
+				if (game.getGameState() == GameState::Lost)
+					game.continueGame();
+				if (rng() % 2)
+					game.update();
+				if (rng() % 12 == 0 && game.canUndo())
+					game.undo();
+				keep();
+				batch.clear();
+				for (size_t moves = rng() % 6 == 0 ? 2 + rng() % 3 : 1; batch.size() < moves; ) {
+					size_t row = rng() % rows, col = rng() % cols;
+					const Tile& tile = game.getTile(row, col);
+					Move move{ row, col, MoveType::Chord };
+					if (game.getTileState(row, col) != TileState::Open)
+						move.type = rng() % 2 == 0 || (tile.isBomb() && rng() % 8 != 0) ? MoveType::Flag : MoveType::Open;
+					batch.push_back(move);
+				}
+				game.applyMoves(batch);
+			}
+			while (game.isRevealing())
+				game.update();
+			keep();
+			game.setReplayFile("");
+
+			if (!reader.open(path) || !replay.open(path, viewer) || replay.getMoveCount() + 1 != boards.size()) {
+				std::cerr << "The replay of game " << round << " holds " << replay.getMoveCount() << " moves of " << boards.size() - 1 << std::endl;
+				bad++;
+				continue;
 			}
-			else {
-				settings.getDifficultyButton(diff).setHeldDown(false);
+			std::vector<uint64_t> targets;
+			for (uint64_t target = 1; target < replay.getMoveCount(); target++) {
+				if (reader.keyframeAtOrBefore(target) != reader.keyframeAtOrBefore(target + 1))
+					targets.push_back(target);
 			}
+			for (int i = 0; i < 60; i++)
+				targets.push_back(rng() % (replay.getMoveCount() + 1));
+			std::shuffle(targets.begin(), targets.end(), rng);
+			for (uint64_t target : targets) {
+				if (bad >= 10)
+					break;
+				replay.seek(viewer, target, rng() % 2 == 0);
+				seeks++;
+				uint64_t position = replay.getPosition();
+				bool same = position < boards.size() && !boards[position].empty() && viewer.getGameState() == states[position];
+				for (size_t index = 0; same && index < rows * cols; index++)
+					same = viewer.getTileState(index / cols, index % cols) == boards[position][index];
+				if (!same) {
+					std::cerr << "Seeking the replay of game " << round << " to move " << target << " landed on move " << position
+						<< " with another board than the game had" << std::endl;
+					bad++;
+				}
+			}
+			replay.close(viewer);
 		}
+		std::remove(path);
+		printf("replay-seek: %zu seeks, %zu mismatches\n", seeks, bad);
+		return bad == 0;
+	}
 
-		Vector2 mousePoint;
-		SizeConfig& sizeConfig;
-		
+	// Takes a mirror's moves and drops them, the check sets the host's states on it itself
+	class DiscardingSink : public MoveSink {
+	public:
+		void forward(const Move*, size_t) override {}
+		void requestReset() override {}
+		void requestContinue() override {}
 	};
 
-	class Renderer {
-	public:
-		Renderer(SizeConfig const& s) :
-			sizeConfig{ s }, framesCounter{} {
-			Image bombPath = LoadImage("resources/bomb_1_ps.png");
-			ImageFormat(&bombPath, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
-			bombTex = LoadTextureFromImage(bombPath);
-			if (bombTex.id == 0) {
-				std::cerr << "Failed to load bomb texture!" << std::endl;
-			}
-
-			Image flagPath = LoadImage("resources/red_flag_20.png");
-			ImageFormat(&flagPath, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
-			flagTex = LoadTextureFromImage(flagPath);
-			if (flagTex.id == 0) {
-				std::cerr << "Failed to load flag texture!" << std::endl;
-			}
-
-			Image tileUpPath = LoadImage("resources/cellup.png");
-			ImageFormat(&tileUpPath, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
-			tileUpTex = LoadTextureFromImage(tileUpPath);
-			if (tileUpTex.id == 0) {
-				std::cerr << "Failed to load tileUp texture!" << std::endl;
-			}
-			Image tileDownPath = LoadImage("resources/celldown.png");
-			ImageFormat(&tileDownPath, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
-			tileDownTex = LoadTextureFromImage(tileDownPath);
-			if (tileDownTex.id == 0) {
-				std::cerr << "Failed to load tileUp texture!" << std::endl;
-			}
-
-			Image menuBtnPath = LoadImage("resources/menu_button.png");
-			ImageFormat(&menuBtnPath, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
-			menuBtnTex = LoadTextureFromImage(menuBtnPath);
-			if (menuBtnTex.id == 0) {
-				std::cerr << "Failed to load tileUp texture!" << std::endl;
-			}
-			Image menuBtnDownPath = LoadImage("resources/menu_button_down.png");
-			ImageFormat(&menuBtnDownPath, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
-			menuBtnDownTex = LoadTextureFromImage(menuBtnDownPath);
-			if (menuBtnDownTex.id == 0) {
-				std::cerr << "Failed to load tileUp texture!" << std::endl;
+	// Random games with flags, chords, lost games that go on and new games on the same board,
+	// and a mirror following every change through setRemoteHint and setRemoteState, which only
+	// gets the mines once the game is over. After every frame the flag counts kept around each
+	// tile have to match a recount, on the host and on the mirror, and so after every seek of a
+	// replay of the game, which closes all tiles and sets them again.
+	inline bool checkAdjacentFlags() {
+		const char* path = "minesweeper-check.msrp";
+		std::mt19937 rng{ 42 };
+		size_t frames = 0, seeks = 0, bad = 0;
+		DiscardingSink sink;
+		ChangeSet changes;
+		SizeConfig viewerConfig;
+		Game viewer{ viewerConfig };
+		ReplayViewer replay;
+		for (uint32_t round = 0; round < 60 && bad < 10; round++) {
+			SizeConfig config, mirrorConfig;
+			Game game{ config }, mirror{ mirrorConfig };
+			game.setBoardPool(nullptr);
+			mirror.setBoardPool(nullptr);
+			game.setRevealBudget(round % 2 ? 0 : 32);
+			game.setReplayFile(path);
+			size_t rows = 4 + rng() % 40, cols = 4 + rng() % 40;
+			for (int restart = 0; restart < 3 && bad < 10; restart++) {
+				game.startGame(rows, cols, round % 3 ? Difficulty::Medium : Difficulty::Hard);
+				mirror.startMirror(rows, cols, game.getMineLayout().size(), &sink);
+				bool mirrored = false;
+				for (int frame = 0; frame < 300 && bad < 10; frame++) {
+					if (game.getGameState() == GameState::Lost)
+						game.continueGame();
+					if (game.getGameState() != GameState::Ongoing)
+						break;
+					size_t row = rng() % rows, col = rng() % cols;
+					MoveType type = rng() % 3 ? MoveType::Flag : (rng() % 2 ? MoveType::Chord : MoveType::Open);
+					Move move{ row, col, type };
+					game.applyMoves(&move, 1);
+					game.update();
+					game.takeChanges(changes);
+					for (size_t index : changes.opened) {
+						const Tile& tile = game.getTile(index / cols, index % cols);
+						mirror.setRemoteHint(index, tile.getValue(), tile.isBomb());
+						mirror.setRemoteState(index, TileState::Open);
+					}
+					for (size_t index : changes.closed)
+						mirror.setRemoteState(index, TileState::Closed);
+					for (size_t index : changes.unflagged)
+						mirror.setRemoteState(index, TileState::Closed);
+					for (size_t index : changes.flagged)
+						mirror.setRemoteState(index, TileState::Flagged);
+					if (!mirrored && game.getGameState() != GameState::Ongoing) {
+						mirror.setMirrorLayout(game.getMineLayout());
+						mirrored = true;
+					}
+					frames++;
+					if (!game.checkAdjacentFlags() || !mirror.checkAdjacentFlags()) {
+						std::cerr << "Flag counts of game " << round << " went wrong in frame " << frame << std::endl;
+						bad++;
+					}
+				}
 			}
-		};
-		~Renderer() {
-			UnloadTexture(bombTex);
-			UnloadTexture(flagTex);
-			UnloadTexture(tileUpTex);
-			UnloadTexture(tileDownTex);
+			game.setReplayFile("");
+			if (!replay.open(path, viewer))
+				continue;
+			for (int seek = 0; seek < 20; seek++) {
+				replay.seek(viewer, rng() % (replay.getMoveCount() + 1));
+				seeks++;
+				if (!viewer.checkAdjacentFlags()) {
+					std::cerr << "Flag counts of the replay of game " << round << " went wrong at move " << replay.getPosition() << std::endl;
+					bad++;
+				}
+			}
+			replay.close(viewer);
 		}
+		std::remove(path);
+		printf("adjacent-flags: %zu frames, %zu replay seeks, %zu mismatches\n", frames, seeks, bad);
+		return bad == 0;
+	}
 
-		void drawGame(Game const& game) const {
-			
-			drawGameBoard(game);
-			drawBombCounter(game);
-			drawGameOverMessage(game);
+	// Bots play boards drawn by a Renderer on a NullBackend, which needs no window. Every frame
+	// the backend has to get its commands ordered by layer and texture, only with textures it
+	// handed out, one tile texture per tile and one flag per flagged tile.
+	inline bool checkRender() {
+		std::mt19937 rng{ 34 };
+		size_t frames = 0, bad = 0;
+		ChangeSet changes;
+		for (uint32_t round = 0; round < 60 && bad < 10; round++) {
+			SizeConfig config;
+			Game game{ config };
+			game.setBoardPool(nullptr);
+			Renderer renderer{ config };
+			std::unique_ptr<NullBackend> owned = std::make_unique<NullBackend>();
+			NullBackend& backend = *owned;
+			renderer.setBackend(std::move(owned));
+			renderer.toggleMinimap();
+			AutoPlayer bot{ round };
+			size_t rows = 8 + rng() % 33, cols = 8 + rng() % 33;
+			game.startGame(rows, cols, round % 2 ? Difficulty::Easy : Difficulty::Medium);
+			const unsigned tileArt[] = { (unsigned)TextureArt::TileUp + 1, (unsigned)TextureArt::TileDown + 1, (unsigned)TextureArt::Bomb + 1 };
+			for (int frame = 0, over = 0; frame < 2000 && over < 2 && bad < 10; frame++) {
+				bot.step(game);
+				game.update();
+				game.takeChanges(changes);
+				bot.observe(game, changes);
+				renderer.updateMinimap(changes);
+				over += game.getGameState() != GameState::Ongoing;
+
+				backend.setRecording(true);
+				renderer.beginFrame();
+				renderer.drawGame(game);
+				renderer.endFrame();
+				frames++;
+
+				size_t tiles = 0, flags = 0, flagged = 0;
+				uint64_t lastKey = 0;
+				bool sorted = true, known = true;
+				for (const DrawCommand& command : backend.getRecorded()) {
+					uint32_t batch = DrawList::batchKey(command);
+					uint64_t key = (uint64_t)command.layer << 32 | batch;
+					sorted &= key >= lastKey;
+					lastKey = key;
+					if (batch == DrawList::shapeKey || batch == DrawList::textKey)
+						continue;
+					known &= backend.isTexture(batch);
+					tiles += std::count(std::begin(tileArt), std::end(tileArt), batch);
+					flags += batch == (unsigned)TextureArt::Flag + 1;
+				}
+				for (size_t index = 0; index < rows * cols; index++)
+					flagged += game.getTileState(index / cols, index % cols) == TileState::Flagged;
+				if (!sorted || !known || tiles != rows * cols || flags != flagged) {
+					std::cerr << "Frame " << frame << " of game " << round << " drew " << tiles << " tiles and " << flags << " flags of "
+						<< rows * cols << " and " << flagged << (sorted ? "" : ", out of order") << (known ? "" : ", with unknown textures") << std::endl;
+					bad++;
+				}
+			}
+		}
+		printf("render: %zu frames, %zu mismatches\n", frames, bad);
+		return bad == 0;
+	}
 
+	// Labels are measured when their text changes and never again after that. Bots play boards
+	// drawn by a Renderer on a NullBackend, a frame may only measure if the mine counter or the
+	// game state changed since the last one, the menu and settings screens only in their first.
+	inline bool checkMeasure() {
+		std::mt19937 rng{ 33 };
+		size_t frames = 0, measured = 0, bad = 0;
+		ChangeSet changes;
+		SizeConfig config;
+		Renderer renderer{ config };
+		renderer.setBackend(std::make_unique<NullBackend>());
+		Menu menu{ config };
+		Settings settings{ config };
+		for (int frame = 0; frame < 100 && bad < 10; frame++) {
+			TextLabel::resetMeasureCalls();
+			renderer.beginFrame();
+			if (frame < 50)
+				renderer.drawMenu(menu);
+			else
+				renderer.drawSettings(settings);
+			renderer.endFrame();
+			frames++;
+			measured += TextLabel::getMeasureCalls();
+			if (frame % 50 != 0 && TextLabel::getMeasureCalls() > 0) {
+				std::cerr << "Frame " << frame << " of the " << (frame < 50 ? "menu" : "settings") << " measured "
+					<< TextLabel::getMeasureCalls() << " labels" << std::endl;
+				bad++;
+			}
 		}
-		void drawMenu(Menu const& menu) {
-			DrawText(TextFormat("MINESWEEPER"), (sizeConfig.screenWidth - MeasureText("MINESWEEPER", 75)) / 2, 100, 75, DARKGREEN);
-			for (size_t i = 0; i < menu.size(); i++)
-			{
-				drawMenuButton(menu.getButton(i));
+		for (uint32_t round = 0; round < 40 && bad < 10; round++) {
+			Game game{ config };
+			game.setBoardPool(nullptr);
+			AutoPlayer bot{ round };
+			game.startGame(8 + rng() % 33, 8 + rng() % 33, round % 2 ? Difficulty::Easy : Difficulty::Medium);
+			int shownBombs = INT_MIN;
+			GameState shownState = GameState::Ongoing;
+			for (int frame = 0, over = 0; frame < 2000 && over < 20 && bad < 10; frame++) {
+				if (over == 10 && game.getGameState() == GameState::Lost)
+					game.continueGame();
+				bot.step(game);
+				game.update();
+				game.takeChanges(changes);
+				bot.observe(game, changes);
+				over += game.getGameState() != GameState::Ongoing;
+
+				TextLabel::resetMeasureCalls();
+				renderer.beginFrame();
+				renderer.drawGame(game);
+				renderer.endFrame();
+				frames++;
+				measured += TextLabel::getMeasureCalls();
+				bool changed = frame == 0 || shownBombs != (int)game.getBombs() || shownState != game.getGameState();
+				shownBombs = (int)game.getBombs();
+				shownState = game.getGameState();
+				if (!changed && TextLabel::getMeasureCalls() > 0) {
+					std::cerr << "Frame " << frame << " of game " << round << " measured " << TextLabel::getMeasureCalls()
+						<< " labels with nothing changed" << std::endl;
+					bad++;
+				}
 			}
 		}
-		void drawSettings(Settings const& settings) {
-			const char* enterText = "Enter the size of the board:";
-			int enterTextWidth = MeasureText(enterText, 20);
+		printf("measure: %zu frames, %zu labels measured, %zu mismatches\n", frames, measured, bad);
+		return bad == 0;
+	}
 
-			Rectangle recSource{ 0,0, (float)menuBtnTex.width, (float)menuBtnTex.height };
-			const TextBox& textBox = settings.getDimBoxes(0);
+	// Random games with flags, chords, losses that go on, undos and new games on the same board,
+	// sliced reveal too. The minimap fed the changes of every frame has to match one counted from
+	// the tiles again, and the SSE2 shading of random blocks the scalar one pixel by pixel.
+	inline bool checkMinimap() {
+		std::mt19937 rng{ 39 };
+		size_t frames = 0, shaded = 0, bad = 0;
+		ChangeSet changes;
+		Minimap minimap, rebuilt;
+		for (uint32_t round = 0; round < 80 && bad < 10; round++) {
+			SizeConfig config;
+			Game game{ config };
+			game.setBoardPool(nullptr);
+			game.setRevealBudget(round % 2 ? 0 : 16);
+			size_t rows = 4 + rng() % 120, cols = 4 + rng() % 120;
+			size_t maxSize = 1 + rng() % 64;
+			minimap.resize(rows, cols, maxSize, maxSize);
+			rebuilt.resize(rows, cols, maxSize, maxSize);
+			game.startGame(rows, cols, round % 3 ? Difficulty::Easy : Difficulty::Medium);
+			auto state = [&game](size_t row, size_t col) {
+				TileState tileState = game.getTileState(row, col);
+				return tileState == TileState::Open ? 1 : tileState == TileState::Flagged ? 2 : 0;
+			};
+			for (int frame = 0; frame < 600 && bad < 10; frame++) {
+				if (game.getGameState() == GameState::Lost)
+					game.continueGame();
+				else if (game.getGameState() == GameState::Won || rng() % 200 == 0)
+					game.resetGame();
+				size_t row = rng() % rows, col = rng() % cols;
+				Move move{ row, col, MoveType::Chord };
+				if (game.getTileState(row, col) != TileState::Open)
+					move.type = rng() % 3 == 0 ? MoveType::Flag : MoveType::Open;
+				if (rng() % 10 == 0 && game.canUndo())
+					game.undo();
+				else
+					game.applyMoves(&move, 1);
+				game.update();
+				game.takeChanges(changes);
+				minimap.apply(changes);
+				rebuilt.rebuild(state);
+				frames++;
+				size_t pixels = minimap.getWidth() * minimap.getHeight() * 4;
+				if (!std::equal(minimap.getPixels(), minimap.getPixels() + pixels, rebuilt.getPixels())) {
+					std::cerr << "Frame " << frame << " of game " << round << " on a " << rows << "x" << cols << " board left the minimap off its tiles" << std::endl;
+					bad++;
+				}
+			}
+		}
 
-			float padTextBox = enterTextWidth - textBox.getRect().width * 2;
-			DrawText(enterText, sizeConfig.screenWidth / 2- (enterTextWidth / 2), 140, 20, GRAY); 
-			DrawText((const char*)"X", (int)(textBox.getRect().x + textBox.getRect().width + (padTextBox / 2) - MeasureText("X", 20) / 2), (int)textBox.getRect().y + 20, 20, GRAY);
-			
-			drawMenuButton(settings.getDifficultyButton(Difficulty::Easy));
-			drawMenuButton(settings.getDifficultyButton(Difficulty::Medium));
-			drawMenuButton(settings.getDifficultyButton(Difficulty::Hard));
-			drawMenuButton(settings.getPlayButton());
+		//Every count a block can have, the scalar tail shades one pixel at a time. It may round a
+		//channel the other way where the compiler fuses its multiply-adds.
+		std::vector<BlockSummary> summaries(4099);
+		std::vector<uint32_t> tiles(summaries.size());
+		std::vector<uint8_t> vector(summaries.size() * 4), scalar(summaries.size() * 4);
+		Minimap::Rgba closed{ 130, 130, 130, 255 }, opened{ 220, 220, 220, 255 }, flagged{ 230, 41, 55, 255 };
+		for (int round = 0; round < 200 && bad < 10; round++) {
+			for (size_t i = 0; i < summaries.size(); i++) {
+				tiles[i] = 1 + rng() % (round % 2 ? 4096 : 16);
+				summaries[i].opened = rng() % (tiles[i] + 1);
+				summaries[i].flagged = rng() % (tiles[i] - summaries[i].opened + 1);
+			}
+			if (round % 4 == 3) {
+				closed = { (uint8_t)rng(), (uint8_t)rng(), (uint8_t)rng(), (uint8_t)rng() };
+				opened = { (uint8_t)rng(), (uint8_t)rng(), (uint8_t)rng(), (uint8_t)rng() };
+				flagged = { (uint8_t)rng(), (uint8_t)rng(), (uint8_t)rng(), (uint8_t)rng() };
+			}
+			Minimap::shade(summaries.data(), tiles.data(), vector.data(), summaries.size(), closed, opened, flagged);
+			for (size_t i = 0; i < summaries.size(); i++)
+				Minimap::shade(&summaries[i], &tiles[i], &scalar[i * 4], 1, closed, opened, flagged);
+			shaded += summaries.size();
+			for (size_t i = 0; i < vector.size() && bad < 10; i++) {
+				if (std::abs(vector[i] - scalar[i]) > 1) {
+					std::cerr << "Block " << i / 4 << " with " << summaries[i / 4].opened << " opened and " << summaries[i / 4].flagged << " flagged of "
+						<< tiles[i / 4] << " shaded " << (int)vector[i] << " instead of " << (int)scalar[i] << " in channel " << i % 4 << std::endl;
+					bad++;
+				}
+			}
+		}
+		printf("minimap: %zu frames, %zu pixels shaded, %zu mismatches\n", frames, shaded, bad);
+		return bad == 0;
+	}
 
-			//DrawText(TextFormat("INPUT CHARS: %i/%i", letterCount, MAX_INPUT_CHARS),750 , 300, 20, DARKGRAY);
-			TextBox box{};
-			for (size_t i = 0; i < 2; i++)
-			{
-				if (i == 0)
-					 box = settings.getDimBoxes(0);
-				else
-				     box = settings.getDimBoxes(1);
+	// Random boards of every tile kind, from single tiles to boards drawn in a few hundred bands,
+	// long runs of one kind too so deflate finds long and far matches. Every PNG exportPng writes
+	// is read back with its CRCs, zlib header and Adler-32 checked, and has to match the boards
+	// drawn tile by tile without threads or SSE2.
+	inline bool checkSnapshot() {
+		const char* path = "minesweeper-check-snapshot.png";
+		std::mt19937 rng{ 47 };
+		size_t boards = 0, pixels = 0, bad = 0;
+		BoardRasterizer rasterizer;
+		bool art = rasterizer.loadArt("resources");
+		for (int hint = 1; hint <= 8; hint++)
+			rasterizer.setNumberColor(hint, { (unsigned char)rng(), (unsigned char)rng(), (unsigned char)rng(), 255 });
+		std::vector<uint8_t> kinds, reference;
+		PngReader png;
+		for (uint32_t round = 0; round < 160 && bad < 10; round++) {
+			size_t rows = 1 + rng() % (round % 8 == 0 ? 1000 : 120), cols = 1 + rng() % (round % 8 == 4 ? 1000 : 120);
+			size_t tileSize = round % 4 == 0 ? BoardRasterizer::fitTileSize(rows, cols, 1 + rng() % 4096) : 1 + rng() % BoardRasterizer::artTileSize;
+			kinds.resize(rows * cols);
+			size_t run = round % 3 == 0 ? 1 : 1 + rng() % 500;
+			for (size_t i = 0; i < kinds.size(); i++)
+				kinds[i] = i % run == 0 ? (uint8_t)(rng() % BoardRasterizer::kindCount) : kinds[i - 1];
+			if (!rasterizer.exportPng(path, kinds.data(), rows, cols, tileSize)) {
+				bad++;
+				continue;
+			}
+			rasterizer.drawReference(kinds.data(), rows, cols, tileSize, reference);
+			boards++;
+			pixels += reference.size() / 3;
+			if (!png.read(path)) {
+				std::cerr << "The snapshot of board " << round << ", " << rows << "x" << cols << " tiles of " << tileSize << " pixels, can't be read back: " << png.getError() << std::endl;
+				bad++;
+			}
+			else if (png.getWidth() != cols * tileSize || png.getHeight() != rows * tileSize || png.getPixels() != reference) {
+				std::cerr << "The snapshot of board " << round << ", " << rows << "x" << cols << " tiles of " << tileSize << " pixels, differs from the board drawn tile by tile" << std::endl;
+				bad++;
+			}
+		}
+		std::remove(path);
+		printf("snapshot: %zu boards, %zu pixels, %s, %zu mismatches\n", boards, pixels, art ? "with art" : "without art", bad);
+		return bad == 0;
+	}
 
-				DrawRectangleRec(box.getRect(), LIGHTGRAY);
+	// Lets a client that shares the process with its host take in everything the host queued
+	// for it, the host flushes what the socket took no more of the last time around
+	inline void drainCoop(CoopHost& host, Game& game, CoopClient& client, Game& mirror) {
+		const ChangeSet none;
+		for (uint64_t received = ~uint64_t(0); received != client.getBytesReceived(); ) {
+			received = client.getBytesReceived();
+			host.broadcast(game, none);
+			client.receive(mirror);
+		}
+	}
 
-				if (settings.isOnBox(box)) DrawRectangleLines((int)box.getRect().x, (int)box.getRect().y, (int)box.getRect().width, (int)box.getRect().height, RED);
-				else DrawRectangleLines((int)box.getRect().x, (int)box.getRect().y, (int)box.getRect().width, (int)box.getRect().height, DARKGRAY);
-		
-				DrawText(box.getInput(), (int)box.getRect().x + 5, (int)box.getRect().y + 8, 40, MAROON);
-				
+	// A host and a client over a socket pair, both making random moves, with a board every few
+	// rounds whose first click opens tens of thousands of tiles, at once or over many frames.
+	// Both open mines now and then, then one of them goes on or starts over. After every frame
+	// the client's game has to match the host's: tile states, the hints of open tiles, the flag
+	// count, the game state and the clicks.
+	inline bool checkCoop() {
+		std::mt19937 rng{ 45 };
+		size_t frames = 0, losses = 0, largest = 0, bad = 0;
+		ChangeSet changes;
+		std::vector<Move> moves;
+		for (uint32_t round = 0; round < 40 && bad < 10; round++) {
+			std::pair<CoopConnection, CoopConnection> ends = CoopConnection::pair();
+			if (!ends.first.isOpen()) {
+				bad++;
+				break;
+			}
+			SizeConfig config, mirrorConfig;
+			Game game{ config }, mirror{ mirrorConfig };
+			game.setBoardPool(nullptr);
+			game.setRevealBudget(round % 2 ? 0 : 4096);
+			bool cascade = round % 5 == 0;
+			size_t rows = cascade ? 200 + rng() % 100 : 4 + rng() % 60, cols = cascade ? 200 + rng() % 100 : 4 + rng() % 60;
+			game.startGame(rows, cols, cascade ? rows * cols / 200 : Board::minesFor(rows * cols, round % 3 ? Difficulty::Easy : Difficulty::Medium));
+			CoopHost host;
+			CoopClient client;
+			host.addClient(std::move(ends.first), game);
+			client.connect(std::move(ends.second));
+			drainCoop(host, game, client, mirror);
+			if (cascade) {
+				Move first{ rows / 2, cols / 2, MoveType::Open };
+				(round % 2 ? game : mirror).applyMoves(&first, 1);
+			}
 
-				if (settings.isOnBox(box))
-				{
-					if (box.getLetterCount() < box.MAX_INPUT_CHARS)
-					{
-						// Draw blinking underscore char
-						if (((framesCounter / 20) % 2) == 0) DrawText("_", (int)box.getRect().x + 8 + MeasureText(box.getInput(), 40), (int)box.getRect().y + 12, 40, MAROON);
+			for (int frame = 0; frame < 250 && bad < 10; frame++) {
+				GameState ended = game.getGameState();
+				if (ended != GameState::Ongoing) {
+					Game& side = rng() % 2 ? game : mirror;
+					if (ended == GameState::Lost && rng() % 4 != 0)
+						side.continueGame();
+					else
+						side.resetGame();
+				}
+				//The client's moves go out first, the host applies them ahead of its own
+				for (Game* side : { &mirror, &game }) {
+					moves.clear();
+					for (size_t count = rng() % 3; moves.size() < count; ) {
+						size_t row = rng() % rows, col = rng() % cols;
+						TileState tileState = side->getTileState(row, col);
+						Move move{ row, col, MoveType::Chord };
+						if (tileState != TileState::Open) {
+							bool mine = game.hasStarted() && game.getTile(row, col).isBomb();
+							move.type = rng() % 3 == 0 || (mine && rng() % 16 != 0) ? MoveType::Flag : MoveType::Open;
+						}
+						moves.push_back(move);
 					}
-					else DrawText("Press BACKSPACE to delete chars...", 230, 300, 20, GRAY);
+					if (side == &game)
+						host.receive(game);
+					if (!moves.empty())
+						side->applyMoves(moves);
+				}
+				game.update();
+				game.takeChanges(changes);
+				largest = std::max(largest, changes.opened.size());
+				host.broadcast(game, changes);
+				drainCoop(host, game, client, mirror);
+				mirror.takeChanges(changes);
+				frames++;
+				if (game.getGameState() == GameState::Lost && ended != GameState::Lost)
+					losses++;
+
+				bool same = client.isActive() && mirror.getRows() == rows && mirror.getCols() == cols
+					&& mirror.getGameState() == game.getGameState() && mirror.getClicks() == game.getClicks() && mirror.getBombs() == game.getBombs();
+				for (size_t index = 0; same && index < rows * cols; index++) {
+					size_t row = index / cols, col = index % cols;
+					TileState tileState = game.getTileState(row, col);
+					const Tile& tile = game.getTile(row, col);
+					const Tile& mirrored = mirror.getTile(row, col);
+					same = mirror.getTileState(row, col) == tileState && (tileState != TileState::Open
+						|| (mirrored.isBomb() == tile.isBomb() && (tile.isBomb() || mirrored.getValue() == tile.getValue())));
+				}
+				if (!same) {
+					std::cerr << "The client of game " << round << ", " << rows << "x" << cols << ", went another way than the host in frame " << frame << std::endl;
+					bad++;
+					break;
 				}
 			}
 		}
-	
-	private:
-		void drawGameBoard(Game const& game) const {
-			float centerX = (sizeConfig.screenWidth - sizeConfig.boardWidth) / 2;
-			float centerY = (sizeConfig.screenHeight - sizeConfig.boardHeight) / 2;
-
-			Rectangle gameBoard{ centerX - sizeConfig.boardPadding / 2,centerY - sizeConfig.boardPadding / 2,
-								sizeConfig.boardWidth + sizeConfig.boardPadding, sizeConfig.boardHeight + sizeConfig.boardPadding };
-			DrawRectangleRec(gameBoard, GRAY);
-
-			for (int i = 0; i < sizeConfig.cols * sizeConfig.rows; ++i) {
-				size_t row = i / sizeConfig.cols;
-				size_t col = i % sizeConfig.cols;
-
-				TileState state = game.getTileRenderState(row, col);
-				Rectangle tileRect = game.getTileRect(row, col);
+		printf("coop: %zu frames, %zu losses, up to %zu tiles opened in a frame, %zu mismatches\n", frames, losses, largest, bad);
+		return bad == 0;
+	}
 
-				switch (state) {
-				case TileState::Open: {
-					int tileValue = game.getTile(row, col).getValue();
-					DrawTexture(tileDownTex, (int)tileRect.x, (int)tileRect.y, { 230,230,230, 255 });
-					if (tileValue == 0) 
-						break;
-					
-					DrawText(TextFormat("%i", game.getTile(row, col).getValue()),
-						(int)(tileRect.x + (sizeConfig.tileSize / 3)), (int)(tileRect.y + (sizeConfig.tileSize / 4)), 20, getNumberColor(tileValue));
+	// Wins added through the store and appended to the log behind its back, with reopens in
+	// between that read the snapshot and the records after it, compactions, and snapshots that
+	// are torn, stale or belong to a log that was replaced. After every open the kept lists have
+	// to be the first topCount wins of each configuration by time, ties in the order they came.
+	inline bool checkRecords() {
+		const std::string path = "minesweeper-check.msrl";
+		std::mt19937 rng{ 48 };
+		size_t opens = 0, bad = 0;
+		std::error_code error;
+		std::vector<std::vector<GameRecord>> wins;
+		auto configOf = [](size_t config) {
+			return RecordConfig{ 9 + (uint32_t)config % 8, 9 + (uint32_t)config / 8, 10 };
+		};
+		auto makeWin = [&](uint32_t config, uint32_t seed) {
+			GameRecord record;
+			record.rows = configOf(config).rows;
+			record.cols = configOf(config).cols;
+			record.mines = configOf(config).mines;
+			record.seed = seed;
+			record.millis = 1000 + rng() % 2000;
+			record.checksum = RecordStore::checksum(record);
+			return record;
+		};
+		auto matches = [&](const RecordStore& store) {
+			for (size_t config = 0; config < wins.size(); config++) {
+				std::vector<GameRecord>& games = wins[config];
+				std::stable_sort(games.begin(), games.end(), [](const GameRecord& a, const GameRecord& b) { return a.millis < b.millis; });
+				if (games.size() > RecordStore::topCount)
+					games.resize(RecordStore::topCount);
+				const std::vector<GameRecord>& kept = store.best(configOf(config));
+				if (kept.size() != games.size() || std::memcmp(kept.data(), games.data(), games.size() * sizeof(GameRecord)) != 0)
+					return false;
+			}
+			return true;
+		};
+		for (uint32_t round = 0; round < 6 && bad < 10; round++) {
+			std::filesystem::remove(path, error);
+			std::filesystem::remove(path + ".top", error);
+			size_t configs = 4 + rng() % 60;
+			wins.assign(configs, {});
+			uint32_t seed = 0;
+			RecordStore store;
+			for (int step = 0; step < 40 && bad < 10; step++) {
+				if (!store.open(path)) {
+					bad++;
 					break;
 				}
-				case TileState::Bomb:
-					DrawTexture(bombTex, (int)tileRect.x, (int)tileRect.y, WHITE);
+				opens++;
+				if (!matches(store)) {
+					std::cerr << "Records of round " << round << " opened in step " << step << " differ from the wins" << std::endl;
+					bad++;
+				}
+				switch (rng() % 6) {
+				case 0: {
+					//Another writer, enough to compact now and then
+					store.close();
+					std::ofstream out(path, std::ios::binary | std::ios::app);
+					for (size_t count = rng() % 2 ? 1 + rng() % 100 : 20000 + rng() % 60000; count > 0; count--) {
+						uint32_t config = rng() % configs;
+						GameRecord record = makeWin(config, seed++);
+						out.write(reinterpret_cast<const char*>(&record), sizeof(record));
+						wins[config].push_back(record);
+					}
 					break;
-				case TileState::Flagged:
-					DrawTexture(tileUpTex, (int)tileRect.x, (int)tileRect.y, { 230,230,230, 255 });
-					DrawTexture(flagTex, (int)tileRect.x + (int)(tileRect.width- flagTex.width)/2, (int)(tileRect.y) + (int)(tileRect.height - flagTex.height) / 2, WHITE);
+				}
+				case 1: {
+					//Torn or damaged snapshots, the log has to be read instead
+					store.close();
+					uint64_t size = std::filesystem::exists(path + ".top", error) ? std::filesystem::file_size(path + ".top", error) : 0;
+					if (size > 0 && rng() % 2)
+						std::filesystem::resize_file(path + ".top", rng() % size, error);
+					else if (size > 0) {
+						std::fstream snapshot(path + ".top", std::ios::binary | std::ios::in | std::ios::out);
+						snapshot.seekp((std::streamoff)(rng() % size));
+						snapshot.put((char)rng());
+					}
 					break;
-				case TileState::HeldDown:
-					DrawTexture(tileDownTex, (int)tileRect.x, (int)tileRect.y, { 230,230,230, 255 });
+				}
+				case 2: {
+					//A log replaced by one of the same length with other wins keeps the old snapshot
+					store.close();
+					uint64_t size = std::filesystem::file_size(path, error);
+					std::fstream log(path, std::ios::binary | std::ios::in | std::ios::out);
+					for (auto& games : wins)
+						games.clear();
+					for (uint64_t offset = 8; offset + sizeof(GameRecord) <= size; offset += sizeof(GameRecord)) {
+						uint32_t config = rng() % configs;
+						GameRecord record = makeWin(config, seed++);
+						log.seekp((std::streamoff)offset);
+						log.write(reinterpret_cast<const char*>(&record), sizeof(record));
+						wins[config].push_back(record);
+					}
 					break;
+				}
 				default:
-					DrawTexture(tileUpTex, (int)tileRect.x, (int)tileRect.y, {230,230,230, 255});
+					for (size_t count = rng() % 3 ? 1 + rng() % 50 : RecordStore::snapshotSlack + rng() % 1000; count > 0; count--) {
+						uint32_t config = rng() % configs;
+						GameRecord record = makeWin(config, seed++);
+						store.add(record);
+						record.checksum = RecordStore::checksum(record);
+						wins[config].push_back(record);
+					}
 					break;
 				}
 			}
 		}
-		void drawBombCounter(Game const& game)const {
-			float centerX = (sizeConfig.screenWidth - sizeConfig.boardWidth) / 2;
-			float centerY = (sizeConfig.screenHeight - sizeConfig.boardHeight) / 2;
-			float counterWidth = sizeConfig.screenWidth * 0.125f;
-			float counterHeight = sizeConfig.screenHeight * 0.075f;
-			Vector2 innerPad{ 0.1f * counterWidth, 0.2f * counterHeight };
-			Font fontDefault{ 0 };
-			Vector2 counterTextPos = { centerX + innerPad.x / 2 , centerY - counterHeight + innerPad.y / 2 };
+		std::filesystem::remove(path, error);
+		std::filesystem::remove(path + ".top", error);
+		printf("records: %zu opens, %zu mismatches\n", opens, bad);
+		return bad == 0;
+	}
 
-			Vector2 measure = MeasureTextEx(Font{}, TextFormat("%i", game.getBombs()), 25.0f, 5.0f);
+	inline int runCheck(const std::string& name) {
+		const std::pair<const char*, bool (*)()> checks[] = {
+			{ "first-click", checkFirstClick },
+			{ "clicks", checkClicks },
+			{ "allocations", checkAllocations },
+			{ "undo", checkUndo },
+			{ "replay-seek", checkReplaySeek },
+			{ "adjacent-flags", checkAdjacentFlags },
+			{ "render", checkRender },
+			{ "measure", checkMeasure },
+			{ "minimap", checkMinimap },
+			{ "snapshot", checkSnapshot },
+			{ "coop", checkCoop },
+			{ "records", checkRecords },
+		};
+		bool found = false, passed = true;
+		for (const auto& [checkName, check] : checks) {
+			if (name != "all" && name != checkName)
+				continue;
+			found = true;
+			passed &= check();
+		}
+		if (!found) {
+			std::cerr << "Unknown check " << name << ", one of: all";
+			for (const auto& check : checks)
+				std::cerr << " " << check.first;
+			std::cerr << std::endl;
+			return 1;
+		}
+		return passed ? 0 : 1;
+	}
 
-			Rectangle counter{ centerX - sizeConfig.boardPadding / 2,(centerY - sizeConfig.boardPadding / 2) - counterHeight,
-								counterWidth, counterHeight };
-			Rectangle counterInner{ (centerX - sizeConfig.boardPadding / 2) + innerPad.x / 2,(centerY - sizeConfig.boardPadding / 2) - counterHeight + innerPad.y / 2,
-								counterWidth - innerPad.x, counterHeight - innerPad.y };
+	// The first click on one side x side board per density: clearing its area with the regions and
+	// metrics patched in place, against labeling the whole board again as it was done before
+	inline int benchmarkFirstClick(size_t side) {
+		using Clock = std::chrono::steady_clock;
+		std::cout << "First click benchmark, " << side << "x" << side << " boards" << std::endl;
+		Board board;
+		for (float density : { 0.05f, 0.1f, 0.2f, 0.3f }) {
+			board.seed(26);
+			board.regenerate(side, side, Board::minesFor(side * side, density));
+			//A click next to a mine, so mines have to move
+			size_t row = side / 2, col = side / 2;
+			while (col + 2 < side && !board[row][col + 1].isBomb())
+				col++;
+			Clock::time_point start = Clock::now();
+			board.clearArea(row, col);
+			board.getRegions();
+			double click = std::chrono::duration<double>(Clock::now() - start).count();
+			bool local = board.wasClearedLocally();
+			start = Clock::now();
+			board.labelRegions();
+			double relabel = std::chrono::duration<double>(Clock::now() - start).count();
+			printf("%2.0f%% mines: first click %9.3f ms (%s), full relabel %9.3f ms\n", density * 100, click * 1e3,
+				local ? "patched" : "relabeled", relabel * 1e3);
+		}
+		return 0;
+	}
 
-			DrawRectangleRec(counter, DARKGRAY);
-			DrawRectangleRounded(counterInner, 0.1f, 0, { 140, 140, 140, 255 });
-			DrawTextEx(fontDefault, TextFormat("%i", game.getBombs()), counterTextPos, 25, 5, RED);
+	// Latency of single chord moves on one side x side medium board, with instant reveal and with
+	// the default reveal budget. Every chord is made on an open number after flagging its mines, the
+	// cascade it starts is finished before the next one and timed apart.
+	inline int benchmarkChords(size_t side) {
+		using Clock = std::chrono::steady_clock;
+		const size_t chords = 2000;
+		std::cout << "Chord benchmark, " << side << "x" << side << " medium board, " << chords << " chords" << std::endl;
+		for (bool sliced : { false, true }) {
+			SizeConfig config;
+			Game game{ config };
+			game.setBoardPool(nullptr);
+			if (sliced)
+				game.setRevealBudget(4096, 0.004);
+			else
+				game.setRevealBudget(0);
+			game.startGame(side, side, Difficulty::Medium);
+			game.openTile(side / 2, side / 2);
+			while (game.isRevealing())
+				game.update();
+
+			std::mt19937 rng{ 30 };
+			std::vector<double> moveMicros, cascadeMicros;
+			size_t opened = 0;
+			for (size_t probe = 0; moveMicros.size() < chords && probe < chords * 10000 && game.getGameState() == GameState::Ongoing; probe++) {
+				size_t row = rng() % side, col = rng() % side;
+				const Tile& tile = game.getTile(row, col);
+				if (game.getTileState(row, col) != TileState::Open || tile.isBomb() || tile.getValue() == 0)
+					continue;
+				bool closedSafe = false;
+				Neighborhood<SquareTopology>::forEach(row, col, side, side, [&](size_t r, size_t c) {
+					closedSafe |= game.getTileState(r, c) == TileState::Closed && !game.getTile(r, c).isBomb();
+					});
+				if (!closedSafe)
+					continue;
+				Neighborhood<SquareTopology>::forEach(row, col, side, side, [&](size_t r, size_t c) {
+					if (game.getTile(r, c).isBomb() && game.getTileState(r, c) == TileState::Closed)
+						game.toggleFlag(r, c);
+					});
+				Move chord{ row, col, MoveType::Chord };
+				Clock::time_point start = Clock::now();
+				opened += game.applyMoves(&chord, 1).opened.size();
+				Clock::time_point moved = Clock::now();
+				while (game.isRevealing())
+					game.update();
+				moveMicros.push_back(std::chrono::duration<double, std::micro>(moved - start).count());
+				cascadeMicros.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+			}
+			auto report = [](const char* what, std::vector<double>& micros) {
+				if (micros.empty())
+					return;
+				std::sort(micros.begin(), micros.end());
+				double sum = 0.0;
+				for (double m : micros)
+					sum += m;
+				printf("  %-9s avg %8.1f us, p50 %8.1f us, p99 %8.1f us, max %8.1f us\n", what, sum / micros.size(),
+					micros[micros.size() / 2], micros[micros.size() * 99 / 100], micros.back());
+			};
+			printf("%s reveal: %zu chords, %zu tiles opened by the moves themselves\n", sliced ? "sliced " : "instant", moveMicros.size(), opened);
+			report("move", moveMicros);
+			report("+cascade", cascadeMicros);
+		}
+		return 0;
+	}
 
+	// Minimap updates on one side x side medium board played by random moves: counting it from
+	// the tiles again against applying the changes of every move, and shading all its pixels with
+	// SSE2 against the scalar code one pixel at a time
+	inline int benchmarkMinimap(size_t side) {
+		using Clock = std::chrono::steady_clock;
+		const size_t moves = 2000, imageSize = 256;
+		std::cout << "Minimap benchmark, " << side << "x" << side << " medium board, " << imageSize << " pixel image" << std::endl;
+		SizeConfig config;
+		Game game{ config };
+		game.setBoardPool(nullptr);
+		game.setRevealBudget(0);
+		game.startGame(side, side, Difficulty::Medium);
+		game.openTile(side / 2, side / 2);
+		Minimap minimap;
+		minimap.resize(side, side, imageSize, imageSize);
+		ChangeSet changes;
+		game.takeChanges(changes);
+		Clock::time_point start = Clock::now();
+		minimap.apply(changes);
+		double firstClick = std::chrono::duration<double>(Clock::now() - start).count();
+		auto state = [&game](size_t row, size_t col) {
+			TileState tileState = game.getTileState(row, col);
+			return tileState == TileState::Open ? 1 : tileState == TileState::Flagged ? 2 : 0;
 		};
-		void drawGameOverMessage(Game const& game)const {
-			if (game.getGameState() == GameState::Ongoing)
-				return;
-			drawMenuButton(game.getHomeButton());
+		start = Clock::now();
+		minimap.rebuild(state);
+		double rebuild = std::chrono::duration<double>(Clock::now() - start).count();
+		printf("first click: %zu tiles applied %9.3f ms, full rebuild %9.3f ms\n", changes.opened.size(), firstClick * 1e3, rebuild * 1e3);
+
+		std::mt19937 rng{ 39 };
+		std::vector<double> micros;
+		size_t tiles = 0;
+		MinimapRect rect;
+		for (size_t probe = 0; micros.size() < moves && probe < moves * 1000 && game.getGameState() == GameState::Ongoing; probe++) {
+			size_t row = rng() % side, col = rng() % side;
+			if (game.getTileState(row, col) != TileState::Closed)
+				continue;
+			Move move{ row, col, game.getTile(row, col).isBomb() ? MoveType::Flag : MoveType::Open };
+			game.applyMoves(&move, 1);
+			game.takeChanges(changes);
+			start = Clock::now();
+			minimap.apply(changes);
+			minimap.takeDirty(rect);
+			micros.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+			tiles += changes.opened.size() + changes.flagged.size();
+		}
+		if (!micros.empty()) {
+			std::sort(micros.begin(), micros.end());
+			double sum = 0.0;
+			for (double m : micros)
+				sum += m;
+			printf("%zu moves, %zu tiles: apply avg %8.2f us, p50 %8.2f us, p99 %8.2f us, max %8.2f us\n", micros.size(), tiles,
+				sum / micros.size(), micros[micros.size() / 2], micros[micros.size() * 99 / 100], micros.back());
+		}
 
-			Vector2 fontPosition = { 0, sizeConfig.screenHeight / 2.0f - GetFontDefault().baseSize / 2.0f - 80.0f };
-			if (game.getGameState() == GameState::Won) {
-				const char winMsg[10] = "YOU WIN!";
-				const char* timeMsg = TextFormat("Time: %ds", (int)game.getGameTime());
-				fontPosition.x = (sizeConfig.screenWidth - MeasureText(winMsg, 50)) / 2.0f;
-				float center = (MeasureTextEx(GetFontDefault(), winMsg, 50.0f, 5.0f).x - MeasureTextEx(GetFontDefault(), timeMsg, 15.0f, 5.0f).x) / 2;
-
-				Vector2 fontPositionTime = { (sizeConfig.screenWidth - MeasureText(winMsg, 50)) / 2.0f + center,
-						  sizeConfig.screenHeight / 2.0f - GetFontDefault().baseSize / 2.0f - 80.0f + 50 };
-				Rectangle msgBackground{ fontPosition.x, fontPosition.y, MeasureTextEx(GetFontDefault(),
-					winMsg, 50.0f,5.0f).x, MeasureTextEx(GetFontDefault(), winMsg, 50.0f, 5.0f).y };
-				Rectangle timeBackground{ fontPositionTime.x, fontPositionTime.y, MeasureTextEx(GetFontDefault(), timeMsg , 15.0f,5.0f).x, MeasureTextEx(GetFontDefault(), timeMsg, 15.0f, 5.0f).y };
-
-				//Draw message
-				DrawRectangleRounded(msgBackground, 0.1f, 0, DARKGRAY);
-				DrawRectangleRounded(timeBackground, 0.1f, 0, DARKGRAY);
-				DrawTextEx(GetFontDefault(), winMsg, fontPosition, 50.0f, 5, BLACK);
-				DrawTextEx(GetFontDefault(), timeMsg, fontPositionTime, 15, 5, BLACK);
-				drawMenuButton(game.getTryAgainButton()); 
+		size_t pixels = minimap.getWidth() * minimap.getHeight();
+		std::vector<BlockSummary> summaries(pixels);
+		std::vector<uint32_t> blockTiles(pixels);
+		std::vector<uint8_t> rgba(pixels * 4);
+		for (size_t i = 0; i < pixels; i++) {
+			summaries[i] = minimap.getSummary(i % minimap.getWidth(), i / minimap.getWidth());
+			blockTiles[i] = (uint32_t)(minimap.getBlockSize() * minimap.getBlockSize());
+		}
+		const int rounds = 200;
+		for (bool vector : { true, false }) {
+			start = Clock::now();
+			for (int round = 0; round < rounds; round++) {
+				if (vector)
+					Minimap::shade(summaries.data(), blockTiles.data(), rgba.data(), pixels, minimap.closedColor, minimap.openedColor, minimap.flaggedColor);
+				else {
+					for (size_t i = 0; i < pixels; i++)
+						Minimap::shade(&summaries[i], &blockTiles[i], &rgba[i * 4], 1, minimap.closedColor, minimap.openedColor, minimap.flaggedColor);
+				}
 			}
-			else if (game.getGameState() == GameState::Lost) {
-				const char loseMsg[10] = "YOU LOSE!";
-				fontPosition.x = (sizeConfig.screenWidth - MeasureText(loseMsg, 50)) / 2.0f;
-				Rectangle msgBackground{ fontPosition.x, fontPosition.y, MeasureTextEx(GetFontDefault(), loseMsg, 50.0f,5.0f).x, MeasureTextEx(GetFontDefault(), loseMsg, 50.0f, 5.0f).y };
-
-				//Draw message
-				DrawRectangleRounded(msgBackground, 0.1f, 0, DARKGRAY);
-				DrawTextEx(GetFontDefault(), loseMsg, fontPosition, 50.0f, 5, BLACK);
-				
-				
-				drawMenuButton(game.getContinueButton());
+			double seconds = std::chrono::duration<double>(Clock::now() - start).count() / rounds;
+			printf("shade %zu pixels %-6s %8.1f us, %7.1f M pixels/s\n", pixels, vector ? "sse2" : "scalar", seconds * 1e6, pixels / seconds / 1e6);
+		}
+		return 0;
+	}
 
+	// Snapshots of one side x side medium board halfway played, at the tile sizes that fit it into
+	// a few image sizes: the banded SSE2 export with deflate on every core against drawing the same
+	// pixels tile by tile on one thread without compressing them
+	inline int benchmarkSnapshot(size_t side) {
+		using Clock = std::chrono::steady_clock;
+		const char* path = "minesweeper-bench-snapshot.png";
+		const int rounds = 5;
+		std::cout << "Snapshot benchmark, " << side << "x" << side << " medium board, " << std::max(1u, std::thread::hardware_concurrency()) << " threads" << std::endl;
+		SizeConfig config;
+		Game game{ config };
+		game.setBoardPool(nullptr);
+		game.setRevealBudget(0);
+		game.startGame(side, side, Difficulty::Medium);
+		std::mt19937 rng{ 47 };
+		for (size_t move = 0; move < side * 4; move++) {
+			size_t row = rng() % side, col = rng() % side;
+			if (game.getTileState(row, col) != TileState::Closed)
+				continue;
+			if (game.getTile(row, col).isBomb())
+				game.toggleFlag(row, col);
+			else
+				game.openTile(row, col);
+		}
+		std::vector<uint8_t> kinds, reference;
+		SnapshotExporter::tileKinds(game, kinds);
+		BoardRasterizer rasterizer;
+		rasterizer.loadArt("resources");
+		for (size_t maxSide : { 1024, 4096, 8192 }) {
+			size_t tileSize = BoardRasterizer::fitTileSize(side, side, maxSide);
+			double pixels = (double)(side * tileSize) * (side * tileSize);
+			double exported = 1e30, draw = 1e30;
+			for (int round = 0; round < rounds; round++) {
+				Clock::time_point start = Clock::now();
+				rasterizer.exportPng(path, kinds.data(), side, side, tileSize);
+				exported = std::min(exported, std::chrono::duration<double>(Clock::now() - start).count());
+				start = Clock::now();
+				rasterizer.drawReference(kinds.data(), side, side, tileSize, reference);
+				draw = std::min(draw, std::chrono::duration<double>(Clock::now() - start).count());
 			}
+			std::ifstream file{ path, std::ios::binary | std::ios::ate };
+			double bytes = (double)file.tellg();
+			printf("%2zu px tiles, %5zux%-5zu: export %8.1f ms, %7.1f M pixels/s, %8.2f MiB (%4.1f%% of raw); tile by tile %8.1f ms, %7.1f M pixels/s\n",
+				tileSize, side * tileSize, side * tileSize, exported * 1e3, pixels / exported / 1e6, bytes / (1 << 20), bytes * 100 / (pixels * 3),
+				draw * 1e3, pixels / draw / 1e6);
 		}
-		void drawMenuButton(Button const& button) const {
-			
-			Rectangle recSource{ 0.f,0.f, (float)menuBtnTex.width, (float)menuBtnTex.height };
-			float centerX = (menuBtnTex.width - MeasureText(button.getText(), 25)) / 2.0f;
-			float centerY = (menuBtnTex.height - 25.0f) / 2;
-			if (button.isHeldDown())
-				DrawTextureRec(menuBtnDownTex, recSource, button.getPosition(), WHITE);
-			else
-				DrawTextureRec(menuBtnTex, recSource, button.getPosition(), WHITE);
+		std::remove(path);
+		return 0;
+	}
 
-			DrawText(button.getText(), (int)button.getPosition().x + (int)centerX, (int)button.getPosition().y + (int)centerY, 25, button.getTextColor());
+	// What a co-op client on the same machine gets: the first click of a side x side board that
+	// opens most of it, then bots playing expert and medium games on the host one move a frame.
+	// Bytes per move are what the host sent to its one client, the host's own moves included.
+	inline int benchmarkCoop(size_t side) {
+		using Clock = std::chrono::steady_clock;
+		std::cout << "Co-op benchmark, one client over a socket pair" << std::endl;
+		ChangeSet changes;
+		{
+			std::pair<CoopConnection, CoopConnection> ends = CoopConnection::pair();
+			SizeConfig config, mirrorConfig;
+			Game game{ config }, mirror{ mirrorConfig };
+			game.setBoardPool(nullptr);
+			game.setRevealBudget(0);
+			game.startGame(side, side, side * side / 500);
+			CoopHost host;
+			CoopClient client;
+			host.addClient(std::move(ends.first), game);
+			client.connect(std::move(ends.second));
+			drainCoop(host, game, client, mirror);
+			uint64_t before = client.getBytesReceived();
+			Clock::time_point start = Clock::now();
+			mirror.openTile(side / 2, side / 2);
+			host.receive(game);
+			game.update();
+			game.takeChanges(changes);
+			host.broadcast(game, changes);
+			drainCoop(host, game, client, mirror);
+			double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+			double bytes = (double)(client.getBytesReceived() - before);
+			printf("first click on %zux%zu: %zu tiles opened, %.0f bytes, %.3f bytes per tile, %.1f bytes per row, client has it after %.1f ms\n",
+				side, side, changes.opened.size(), bytes, bytes / std::max<size_t>(changes.opened.size(), 1), bytes / side, seconds * 1e3);
+		}
 
+		const struct {
+			const char* name;
+			size_t rows, cols;
+			Difficulty difficulty;
+			size_t games;
+		} plays[] = {
+			{ "expert", 16, 30, Difficulty::Hard, 200 },
+			{ "medium", 100, 100, Difficulty::Medium, 50 },
+		};
+		for (const auto& play : plays) {
+			std::pair<CoopConnection, CoopConnection> ends = CoopConnection::pair();
+			SizeConfig config, mirrorConfig;
+			Game game{ config }, mirror{ mirrorConfig };
+			game.setBoardPool(nullptr);
+			game.setRevealBudget(0);
+			game.startGame(play.rows, play.cols, play.difficulty);
+			CoopHost host;
+			CoopClient client;
+			host.addClient(std::move(ends.first), game);
+			client.connect(std::move(ends.second));
+			AutoPlayer bot{ 45 };
+			size_t games = 1, moves = 0, frames = 0;
+			uint64_t before = client.getBytesReceived();
+			Clock::time_point start = Clock::now();
+			while (true) {
+				host.receive(game);
+				if (game.getGameState() != GameState::Ongoing) {
+					moves += game.getClicks();
+					if (games == play.games)
+						break;
+					game.startGame(play.rows, play.cols, play.difficulty);
+					games++;
+				}
+				bot.step(game);
+				game.update();
+				game.takeChanges(changes);
+				bot.observe(game, changes);
+				host.broadcast(game, changes);
+				drainCoop(host, game, client, mirror);
+				mirror.takeChanges(changes);
+				frames++;
+			}
+			double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+			printf("%-6s %3zux%-3zu: %zu games, %zu moves, %6.1f bytes per move, %8.0f bytes the client received, %6.2f us per frame\n",
+				play.name, play.rows, play.cols, games, moves, host.getBytesPerMove(), (double)(client.getBytesReceived() - before),
+				seconds * 1e6 / std::max<size_t>(frames, 1));
 		}
+		return 0;
+	}
 
-		Color getNumberColor(int tileValue)const{
-			switch (tileValue) {
-			case 1:
-				return  {0,0,255,255};
-				break;
-			case 2:
-				return {0, 119, 0, 255};
-				break;
-			case 3:
-				return RED;
-				break;
-			case 4:
-				return { 0,0,128,255 };
-				break;
-			case 5:
-				return { 128, 0, 0, 255 };
-				break;
-			case 6:
-				return {0, 128, 170, 255};
-				break;
-			default:
-				return BLACK;
-				break;
+	// --bench <name> [size], prints the numbers and exits
+	inline int runBenchmark(const std::string& name, size_t size) {
+		if (name == "boards")
+			return benchmarkBoardGrid(size ? size : 64);
+		if (name == "large-board")
+			return benchmarkLargeBoard(size ? size : 8192);
+		if (name == "first-click")
+			return benchmarkFirstClick(size ? size : 4096);
+		if (name == "chords")
+			return benchmarkChords(size ? size : 1024);
+		if (name == "replay")
+			return benchmarkReplay(size ? size : 2048);
+		if (name == "layouts")
+			return benchmarkLayouts(size ? size : 16384);
+		if (name == "densities")
+			return benchmarkDensities(size ? size : 4096);
+		if (name == "neighbors")
+			return benchmarkNeighbors(size ? size : 2048);
+		if (name == "heatmap")
+			return benchmarkHeatmap(size ? size : 256);
+		if (name == "records")
+			return benchmarkRecords(size ? size : 3000000);
+		if (name == "minimap")
+			return benchmarkMinimap(size ? size : 4096);
+		if (name == "snapshot")
+			return benchmarkSnapshot(size ? size : 1000);
+		if (name == "coop")
+			return benchmarkCoop(size ? size : 1000);
+		std::cerr << "Unknown benchmark " << name << ", one of: boards large-board first-click chords replay layouts densities neighbors heatmap records minimap snapshot coop" << std::endl;
+		return 1;
+	}
+
+	// A host without a window for testing clients against: a bot plays 30x16 expert games on it
+	// at about 60 frames a second, a second after one is over the next one starts
+	inline int runCoopServer(const std::string& address, double seconds) {
+		SizeConfig config;
+		Game game{ config };
+		game.setBoardPool(nullptr);
+		CoopHost host;
+		if (!host.listen(CoopAddress::parse(address))) {
+			std::cerr << "Co-op: can't host on " << address << std::endl;
+			return 1;
+		}
+		AutoPlayer bot{ (uint32_t)std::random_device{}() };
+		ChangeSet changes;
+		game.startGame(16, 30, Difficulty::Hard);
+		std::cout << "Co-op server on " << address << " for " << seconds << " s" << std::endl;
+		size_t frames = 0, games = 1, clicks = 0, maxClients = 0;
+		double start = GetTime(), ended = 0.0;
+		for (double now = start; now - start < seconds; now = GetTime()) {
+			host.receive(game);
+			if (game.getGameState() == GameState::Ongoing)
+				ended = 0.0;
+			else if (ended == 0.0)
+				ended = now;
+			else if (now - ended > 1.0) {
+				clicks += game.getClicks();
+				game.startGame(16, 30, Difficulty::Hard);
+				games++;
 			}
+			if (frames % 8 == 0)
+				bot.step(game);
+			game.update();
+			game.takeChanges(changes);
+			bot.observe(game, changes);
+			host.broadcast(game, changes);
+			maxClients = std::max(maxClients, host.getClientCount());
+			frames++;
+			std::this_thread::sleep_until(std::chrono::steady_clock::now() + std::chrono::microseconds(16667));
 		}
-		
-		int framesCounter;
-	
-		SizeConfig const& sizeConfig;
-		Texture2D bombTex, flagTex, tileUpTex, tileDownTex;
-		Texture2D menuBtnTex, menuBtnDownTex;
-	};
+		clicks += game.getClicks();
+		std::cout << frames << " frames, " << games << " games, " << clicks << " clicks, up to " << maxClients
+			<< " clients, " << host.getBytesPerMove() << " bytes per move" << std::endl;
+		return 0;
+	}
 }
 
 class Application {
 public:
 
 	Application(SizeConfig& conf) 
-		: gameState{ conf }, renderer{ conf }, inputHandler{ conf }, menu{ conf }, settings{ conf }
-		, currentScreen{ GameScreen::TITLE } {}
+		: conf{ conf }, gameState{ conf }, renderer{ conf }, inputHandler{ conf }, menu{ conf }, settings{ conf }
+		, currentScreen{ GameScreen::TITLE } {
+		Minesweeper::AllocTracker::trackThisThread();
+		gameState.setReplayFile(replayFile);
+		records.open(recordsFile);
+	}
+
+	// Plays the games of this instance together with others, address is a loopback TCP port or unix:<path>
+	bool hostCoop(const std::string& address) {
+		return coopHost.listen(Minesweeper::CoopAddress::parse(address));
+	}
+
+	// Mirrors the game of a host, its games start here as soon as the host starts them
+	bool joinCoop(const std::string& address) {
+		return coopClient.connect(Minesweeper::CoopAddress::parse(address));
+	}
+
+	// Fills the screen with count boards played by bots, clicking one takes it over. G toggles it.
+	void startBoardGrid(size_t count) {
+		gridBoards = count;
+		if (!taskPool)
+			taskPool = std::make_unique<Minesweeper::TaskPool>();
+		boardGrid.start(count, Difficulty::Easy, { 20.0f, 60.0f, conf.screenWidth - 40.0f, conf.screenHeight - 80.0f });
+	}
+
+	// Lets bots in other processes read the board in place and send moves, name is a shared memory name
+	void shareBoard(const std::string& name) {
+		botBridge.share(name);
+	}
 
 	void update() {
+		allocTracker.beginFrame();
+		if (coopClient.receive(gameState))
+			currentScreen = GameScreen::GAMEPLAY;
+		if (IsKeyPressed(KEY_F3))
+			showAllocOverlay = !showAllocOverlay;
+		if (IsKeyPressed(KEY_M))
+			renderer.toggleMinimap();
+		if (IsKeyPressed(KEY_P)) {
+			showHeatmap = !showHeatmap;
+			heatmap.setEnabled(showHeatmap);
+		}
+		if (IsKeyPressed(KEY_G) && (boardGrid.isActive() || currentScreen == GameScreen::TITLE)) {
+			if (boardGrid.isActive())
+				boardGrid.stop();
+			else
+				startBoardGrid(gridBoards);
+		}
+		if (boardGrid.isActive()) {
+			updateBoardGrid();
+			allocTracker.endPhase(Minesweeper::AllocPhase::Update);
+			return;
+		}
+
 		inputHandler.updateMousePosition(); 
 		switch (currentScreen) {
 		case GameScreen::TITLE:
@@ -1070,13 +5445,45 @@ public:
 		case GameScreen::HOW_TO:
 			break;
 		case GameScreen::GAMEPLAY:
-			currentScreen = inputHandler.handleGameInput(gameState);
+			if (updateReplay()) {
+				allocTracker.endPhase(Minesweeper::AllocPhase::Input);
+			}
+			else {
+				if (coopHost.isActive())
+					coopHost.receive(gameState);
+				if (botBridge.isActive())
+					botBridge.receive(gameState);
+				currentScreen = inputHandler.handleGameInput(gameState);
+				//U takes back the last move, a losing one too
+				if (IsKeyPressed(KEY_U))
+					gameState.undo();
+				allocTracker.endPhase(Minesweeper::AllocPhase::Input);
+				gameState.update();
+			}
+			if (IsKeyPressed(KEY_F12) && snapshot.exportPng(gameState, snapshotFile))
+				std::cerr << "Saved the board to " << snapshotFile << std::endl;
+			gameState.takeChanges(frameChanges);
+			recordWin();
+			if (coopHost.isActive())
+				coopHost.broadcast(gameState, frameChanges);
+			if (botBridge.isActive())
+				botBridge.publish(gameState, frameChanges);
+			renderer.updateMinimap(frameChanges);
+			heatmap.apply(frameChanges, gameState.getRows(), gameState.getCols(), gameState.getBombTotal(), [this](size_t index) {
+				const Tile& tile = gameState.getTile(index / gameState.getCols(), index % gameState.getCols());
+				return tile.isBomb() ? -1 : tile.getValue();
+				});
+			heatmap.poll();
 			break;
 		}
+		allocTracker.endPhase(Minesweeper::AllocPhase::Update);
 	}
 
 	void draw() {
-		switch (currentScreen) { 
+		renderer.beginFrame();
+		if (boardGrid.isActive())
+			renderer.drawBoardGrid(boardGrid);
+		else switch (currentScreen) { 
 		case GameScreen::TITLE: 
 			renderer.drawMenu(menu); 
 			break;
@@ -1084,18 +5491,100 @@ public:
 			renderer.drawSettings(settings); 
 			break;
 		case GameScreen::HOW_TO: 
-			DrawText(TextFormat("MINESWEEPER"), 0, 0, 50, BLUE); 
+			renderer.drawHowTo();
 			break;
 		case GameScreen::GAMEPLAY: 
-		{ 
 			renderer.drawGame(gameState); 
-			DrawFPS(1720, 10); 
-		}
+			if (showHeatmap)
+				renderer.drawHeatmap(gameState, heatmap);
+			if (replayViewer.isActive())
+				renderer.drawReplayBar(replayViewer.getPosition(), replayViewer.getMoveCount());
+			if (coopHost.isActive() || coopClient.isActive())
+				renderer.drawCoopStatus(coopHost, coopClient);
+			break;
 		}
+		if (showAllocOverlay)
+			renderer.drawAllocOverlay(allocTracker);
+		renderer.endFrame();
+		if (currentScreen == GameScreen::GAMEPLAY || boardGrid.isActive())
+			DrawFPS(1720, 10); 
+		allocTracker.endPhase(Minesweeper::AllocPhase::Draw);
 	}
 	
 
 private:
+	// Clicks go to the board under the mouse, then every board runs its frame on the task pool
+	void updateBoardGrid() {
+		Vector2 mouse = GetMousePosition();
+		if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT))
+			boardGrid.click(mouse, Minesweeper::MoveType::Open);
+		if (IsMouseButtonPressed(MOUSE_BUTTON_RIGHT))
+			boardGrid.click(mouse, Minesweeper::MoveType::Flag);
+		allocTracker.endPhase(Minesweeper::AllocPhase::Input);
+		boardGrid.update(*taskPool, GetTime());
+	}
+
+	// Adds a win that just happened to the records and shows where it ranks. Replays and co-op
+	// mirrors show games played elsewhere, a continued game was lost once.
+	void recordWin() {
+		GameState state = gameState.getGameState();
+		bool won = state == GameState::Won && lastGameState != GameState::Won;
+		lastGameState = state;
+		if (!won)
+			return;
+		if (replayViewer.isActive() || gameState.isMirror() || gameState.wasContinued()) {
+			renderer.hideRecord();
+			return;
+		}
+		Minesweeper::GameRecord record;
+		record.rows = (uint32_t)gameState.getRows();
+		record.cols = (uint32_t)gameState.getCols();
+		record.mines = (uint32_t)gameState.getBombTotal();
+		record.seed = gameState.getSeed();
+		record.millis = (uint32_t)(gameState.getGameTime() * 1000.0);
+		record.bbbv = (uint32_t)gameState.getBoardMetrics().bbbv;
+		record.clicks = (uint32_t)gameState.getClicks();
+		record.finishedAt = (uint32_t)std::time(nullptr);
+		for (Difficulty difficulty : { Difficulty::Easy, Difficulty::Medium, Difficulty::Hard })
+			if (Minesweeper::Board::minesFor(record.rows * (size_t)record.cols, difficulty) == record.mines)
+				record.difficulty = (uint8_t)difficulty;
+		size_t rank = records.add(record);
+		const std::vector<Minesweeper::GameRecord>& best = records.best({ record.rows, record.cols, record.mines });
+		renderer.showRecord(rank, best.empty() ? record.millis : best.front().millis);
+	}
+
+	// R opens the replay of a finished game and closes it again. Left and right step one move,
+	// page up and down jump a keyframe interval, home and end go to the start and the end.
+	bool updateReplay() {
+		//A co-op game is never replayed, the host's game would go to every client
+		if (coopHost.isActive() || coopClient.isActive())
+			return false;
+		if (IsKeyPressed(KEY_R)) {
+			if (replayViewer.isActive())
+				replayViewer.close(gameState);
+			else if (gameState.getGameState() != GameState::Ongoing && !replayViewer.open(replayFile, gameState))
+				std::cerr << "No replay to show" << std::endl;
+		}
+		if (!replayViewer.isActive())
+			return false;
+
+		int64_t jump = replayViewer.getKeyframeInterval();
+		if (IsKeyPressed(KEY_RIGHT) || IsKeyPressedRepeat(KEY_RIGHT))
+			replayViewer.step(gameState, 1);
+		if (IsKeyPressed(KEY_LEFT) || IsKeyPressedRepeat(KEY_LEFT))
+			replayViewer.step(gameState, -1);
+		if (IsKeyPressed(KEY_PAGE_DOWN))
+			replayViewer.step(gameState, jump);
+		if (IsKeyPressed(KEY_PAGE_UP))
+			replayViewer.step(gameState, -jump);
+		if (IsKeyPressed(KEY_HOME))
+			replayViewer.seek(gameState, 0);
+		if (IsKeyPressed(KEY_END))
+			replayViewer.seek(gameState, replayViewer.getMoveCount());
+		return true;
+	}
+
+	SizeConfig& conf;
 	GameScreen currentScreen;
 
 	Minesweeper::Renderer renderer;
@@ -1104,18 +5593,85 @@ private:
 	Minesweeper::Game gameState;
 	Minesweeper::Menu menu;
 	Minesweeper::Settings settings;
+
+	Minesweeper::ChangeSet frameChanges;
+	Minesweeper::MineProbability heatmap;
+	bool showHeatmap = false;
+	Minesweeper::ReplayViewer replayViewer;
+	static constexpr const char* replayFile = "last_game.msrp";
+	Minesweeper::CoopHost coopHost;
+	Minesweeper::CoopClient coopClient;
+	Minesweeper::BotBridge botBridge;
+	Minesweeper::SnapshotExporter snapshot;
+	static constexpr const char* snapshotFile = "board_snapshot.png";
+	Minesweeper::RecordStore records;
+	static constexpr const char* recordsFile = "records.msrl";
+	GameState lastGameState = GameState::Ongoing;
+	Minesweeper::BoardGrid<Minesweeper::BeginnerBoard> boardGrid;
+	std::unique_ptr<Minesweeper::TaskPool> taskPool;
+	size_t gridBoards = 16;
+	Minesweeper::AllocTracker allocTracker;
+	bool showAllocOverlay = false;
 };
 //------------------------------------------------------------------------------------
 // Program main entry point
 //------------------------------------------------------------------------------------
-int main(void)
+int main(int argc, char** argv)
 {
 	SizeConfig sizeConfig{ };
+
+	// --bench-boards <count> times the grid mode without a window and exits
+	if (argc == 3 && std::string(argv[1]) == "--bench-boards")
+		return Minesweeper::benchmarkBoardGrid((size_t)std::max(1, atoi(argv[2])));
+
+	// --check <name|all> runs the headless self checks, --bench <name> [size] one of the benchmarks
+	if (argc == 3 && std::string(argv[1]) == "--check")
+		return Minesweeper::runCheck(argv[2]);
+	if ((argc == 3 || argc == 4) && std::string(argv[1]) == "--bench")
+		return Minesweeper::runBenchmark(argv[2], argc == 4 ? (size_t)std::max(0LL, atoll(argv[3])) : 0);
+
+	// --bot-agent <name> [seconds] plays the game another instance shares with --bots <name>
+	if ((argc == 3 || argc == 4) && std::string(argv[1]) == "--bot-agent") {
+		Minesweeper::BotAgent agent{ (uint32_t)std::random_device{}() };
+		return agent.run(argv[2], argc == 4 ? atof(argv[3]) : 10.0);
+	}
+
+	// --coop-server <port|unix:path> [seconds] hosts games a bot plays without a window
+	if ((argc == 3 || argc == 4) && std::string(argv[1]) == "--coop-server")
+		return Minesweeper::runCoopServer(argv[2], argc == 4 ? atof(argv[3]) : 60.0);
+
+	// --snapshot <replay> <png> draws the end of a replay to a PNG and exits, it needs no window
+	if (argc == 4 && std::string(argv[1]) == "--snapshot") {
+		Minesweeper::Game game{ sizeConfig };
+		Minesweeper::ReplayViewer viewer;
+		if (!viewer.open(argv[2], game)) {
+			std::cerr << "Snapshot: can't read " << argv[2] << std::endl;
+			return 1;
+		}
+		viewer.seek(game, viewer.getMoveCount());
+		Minesweeper::SnapshotExporter exporter;
+		return exporter.exportPng(game, argv[3]) ? 0 : 1;
+	}
+
 	InitWindow(sizeConfig.screenWidth, sizeConfig.screenHeight, "Minesweeper");
 	SetTargetFPS(60);
 
 	Application app{ sizeConfig };
 
+	// --host <port|unix:path> shares the games of this instance, --join <port|unix:path> plays them,
+	// --bots <name> shows them to bots through shared memory, --boards <count> starts the board grid
+	for (int i = 1; i + 1 < argc; i++) {
+		std::string option = argv[i];
+		if (option == "--bots")
+			app.shareBoard(argv[i + 1]);
+		if (option == "--boards")
+			app.startBoardGrid((size_t)std::max(1, atoi(argv[i + 1])));
+		if (option == "--host" && !app.hostCoop(argv[i + 1]))
+			std::cerr << "Co-op: can't host on " << argv[i + 1] << std::endl;
+		if (option == "--join" && !app.joinCoop(argv[i + 1]))
+			std::cerr << "Co-op: can't join " << argv[i + 1] << std::endl;
+	}
+
 
 	while (!WindowShouldClose())
 	{